@@ -426,24 +426,7 @@ static int BeautifulAnalyzer_init(BeautifulAnalyzerObject *self, PyObject *args,
 
   else if (PyObject_IsInstance(text_input, (PyObject *)&BStringType))
   {
-    BStringObject *bstring_input = (BStringObject *)text_input;
-
-    PyObject *temp_list = PyList_New(bstring_input->size);
-    if (!temp_list)
-      return -1;
-
-    BStringNode *current = bstring_input->head;
-    for (Py_ssize_t i = 0; i < bstring_input->size; ++i)
-    {
-      Py_INCREF(current->str);
-      PyList_SET_ITEM(temp_list, i, current->str); 
-      current = current->next;
-    }
-
-    PyObject *separator = PyUnicode_FromString(" ");
-    self->text_blob = PyUnicode_Join(separator, temp_list);
-    Py_DECREF(separator);
-    Py_DECREF(temp_list);
+    self->text_blob = PyObject_CallMethod(text_input, "join", "s", " ");
     if (!self->text_blob)
       return -1;
   }
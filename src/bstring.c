@@ -7,108 +7,434 @@ Email: juha.a.sinisalo@gmail.com
 #define PY_SSIZE_T_CLEAN
 #include "bstring.h"
 #include "Python.h"
+#include "bstring_csv.h"
+#include "bstring_expr.h"
+#include "bstring_kernels.h"
+#include "bstring_patterns.h"
+#include "bstring_search.h"
+#include "bstring_storage.h"
+#include "bstring_threads.h"
+#include "bstring_view.h"
+#include "fastargs.h"
 #include "library.h"
 
-static PyObject *BString_unique(BStringObject *self, PyObject *Py_UNUSED(args))
+static void BString_dealloc(BStringObject *self);
+static PyObject *BString_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+static int BString_init(BStringObject *self, PyObject *args, PyObject *kwds);
+static PyObject *BString_repr(BStringObject *self);
+static PyObject *BString_call(BStringObject *self, PyObject *args, PyObject *kwds);
+static PyObject *BString_iter(BStringObject *self);
+static PyObject *BString_unique(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_find_all(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_grep(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_find_any(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static Py_ssize_t BString_length(BStringObject *self);
+static PyObject *BString_getitem(BStringObject *self, PyObject *key);
+static PyObject *BString_view(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_compact(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_expand(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_enable_index(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_disable_index(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_index(BStringObject *self, PyObject *const *args, Py_ssize_t nargs);
+static PyObject *BString_count(BStringObject *self, PyObject *value);
+static int BString_sq_contains(BStringObject *self, PyObject *value);
+static PyObject *BString_extend(BStringObject *self, PyObject *args);
+static PyObject *BString_append(BStringObject *self, PyObject *obj);
+static PyObject *BString_transform_chars(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_repeat(BStringObject *self, Py_ssize_t n);
+static PyObject *BString_filter(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_filter_expr(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_from_file(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_from_list(PyObject *type, PyObject *sequence);
+static PyObject *BString_from_iterable(PyObject *type, PyObject *iterable);
+static PyObject *BString_to_file(BStringObject *self, PyObject *const *args, Py_ssize_t nargs);
+static PyObject *BString_from_csv(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_iter_csv(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_to_csv(PyObject *type, PyObject *args, PyObject *kwds);
+static PyObject *BString_map(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *BString_get_head(BStringObject *self, void *closure);
+static PyObject *BString_get_tail(BStringObject *self, void *closure);
+static PyObject *BString_move_next(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_move_prev(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_move_to_head(BStringObject *self, PyObject *Py_UNUSED(args));
+static PyObject *BString_move_to_tail(BStringObject *self, PyObject *Py_UNUSED(args));
+
+// Keeps the first or last occurrence of every string, in sequence order. The
+// duplicates are found with a BStringSet of borrowed references, and the
+// kept items are collected into one array and appended in bulk.
+static PyObject *BString_unique(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
+  const char *keep = "first";
+  int inplace = 0;
+  static char *kwlist[] = {"keep", "inplace", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "|sp:unique", kwlist, &keep, &inplace))
+  {
+    return NULL;
+  }
+  int keep_last = strcmp(keep, "last") == 0;
+  if (!keep_last && strcmp(keep, "first") != 0)
+  {
+    PyErr_SetString(PyExc_ValueError, "keep must be 'first' or 'last'");
+    return NULL;
+  }
+  if (BString_expand_arena(self) < 0)
+    return NULL;
 
-  BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
-  if (!result)
+  BStringSet seen;
+  if (BStringSet_init(&seen) < 0)
     return NULL;
+  PyObject **kept = PyMem_Malloc((self->size > 0 ? self->size : 1) * sizeof(PyObject *));
+  if (!kept)
+  {
+    BStringSet_clear(&seen);
+    return PyErr_NoMemory();
+  }
 
-  PyObject *seen_set = PySet_New(NULL);
-  if (!seen_set)
+  Py_ssize_t num_kept = 0;
+  if (!keep_last)
   {
-    Py_DECREF(result);
-    return NULL;
+    BStringWalk walk;
+    PyObject *item;
+    BString_walk_init(&walk, self, 0);
+    while ((item = BString_walk_next(&walk)))
+    {
+      int added = BStringSet_add(&seen, item);
+      if (added < 0)
+        goto error;
+      if (added)
+        kept[num_kept++] = item;
+    }
   }
-  BStringNode *current = self->head;
-  while (current)
+  else
   {
+    // Walk backwards so that the last occurrence is the one seen first,
+    // then restore sequence order.
+    for (Py_ssize_t i = self->size - 1; i >= 0; --i)
+    {
+      PyObject *item = BString_item_at(self, i);
+      int added = BStringSet_add(&seen, item);
+      if (added < 0)
+        goto error;
+      if (added)
+        kept[num_kept++] = item;
+    }
+    for (Py_ssize_t i = 0, j = num_kept - 1; i < j; ++i, --j)
+    {
+      PyObject *tmp = kept[i];
+      kept[i] = kept[j];
+      kept[j] = tmp;
+    }
+  }
+  BStringSet_clear(&seen);
 
-    int contains = PySet_Contains(seen_set, current->str);
-    if (contains < 0)
-    { 
-      Py_DECREF(result);
-      Py_DECREF(seen_set);
-      return NULL;
+  if (!inplace)
+  {
+    BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+    if (!result || BString_push_array(result, kept, num_kept) != 0)
+    {
+      Py_XDECREF(result);
+      goto error;
     }
+    PyMem_Free(kept);
+    return (PyObject *)result;
+  }
 
-    if (contains == 0)
+  if (num_kept < self->size)
+  {
+    for (Py_ssize_t i = 0; i < num_kept; ++i)
     {
+      Py_INCREF(kept[i]);
+    }
+    BString_clear_storage(self);
+    int status = BString_push_array(self, kept, num_kept);
+    for (Py_ssize_t i = 0; i < num_kept; ++i)
+    {
+      Py_DECREF(kept[i]);
+    }
+    if (status != 0)
+      goto error;
+  }
+  PyMem_Free(kept);
+  Py_RETURN_NONE;
+
+error:
+  BStringSet_clear(&seen);
+  PyMem_Free(kept);
+  return NULL;
+}
 
-      if (PySet_Add(seen_set, current->str) != 0)
+PyObject *BString_contains_walk(BStringWalk *walk, const char *substring_cstr, int case_sensitive)
+{
+  PyObject *substring_obj = PyUnicode_FromString(substring_cstr);
+  if (!substring_obj)
+    return NULL;
+  BStringNeedle needle;
+  int status = BStringNeedle_init(&needle, substring_obj, case_sensitive);
+  Py_DECREF(substring_obj);
+  if (status < 0)
+    return NULL;
+  PyObject *item;
+  int found = 0;
+  while (!found && (item = BString_walk_next(walk)))
+  {
+    found = BStringNeedle_search(&needle, item);
+  }
+  BStringNeedle_clear(&needle);
+  if (found < 0)
+    return NULL;
+  return PyBool_FromLong(found);
+}
+
+// Searches every element for the needle and appends to *indices the indices
+// of the elements that contain it, or with invert of those that do not. When
+// indices is NULL the scan stops at the first such element. Returns the number
+// of elements found, or -1 on error.
+static Py_ssize_t BString_match(BStringObject *self, BStringNeedle *needle, int invert, long long **indices)
+{
+  Py_ssize_t count = 0;
+  Py_ssize_t capacity = 0;
+  int found = 0;
+  BStringWalk walk;
+  if (!self->arena)
+    BString_walk_init(&walk, self, 0);
+  for (Py_ssize_t i = 0; i < self->size; ++i)
+  {
+    if (self->arena)
+    {
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(self->arena, i, &length);
+      found = BStringNeedle_search_utf8(needle, bytes, length);
+    }
+    else
+    {
+      found = BStringNeedle_search(needle, BString_walk_next(&walk));
+    }
+    if (found < 0)
+      return -1;
+    if (found == invert)
+      continue;
+    if (!indices)
+      return 1;
+    if (count == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 64;
+      long long *grown = PyMem_Realloc(*indices, capacity * sizeof(long long));
+      if (!grown)
       {
-        Py_DECREF(result);
-        Py_DECREF(seen_set);
-        return NULL;
+        PyErr_NoMemory();
+        return -1;
       }
-
-      BString_append(result, current->str);
+      *indices = grown;
     }
-    current = current->next;
+    (*indices)[count++] = i;
   }
-  Py_DECREF(seen_set); 
-  return (PyObject *)result;
+  return count;
 }
 
-static PyObject *BString_contains(BStringObject *self, PyObject *args, PyObject *kwds)
+// Parses the (substring, case_sensitive=True[, invert=False]) arguments shared
+// by contains(), find_all() and grep() into a needle.
+static int BString_parse_needle(PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames, const char *format, BStringNeedle *needle, int *invert)
 {
   const char *substring_cstr;
-  int case_sensitive = 1; 
-  static char *kwlist[] = {"substring", "case_sensitive", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|p", kwlist, &substring_cstr, &case_sensitive))
+  int case_sensitive = 1;
+  static char *kwlist[] = {"substring", "case_sensitive", "invert", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, format, kwlist, &substring_cstr, &case_sensitive, invert))
   {
-    return NULL;
+    return -1;
   }
-
   PyObject *substring_obj = PyUnicode_FromString(substring_cstr);
   if (!substring_obj)
-    return NULL;
+    return -1;
+  int status = BStringNeedle_init(needle, substring_obj, case_sensitive);
+  Py_DECREF(substring_obj);
+  return status;
+}
 
-  BStringNode *current = self->head;
-  while (current)
+// Wraps indices into an array.array('q'), copying them once.
+static PyObject *BString_index_array(const long long *indices, Py_ssize_t count)
+{
+  static PyObject *array_type = NULL;
+  if (!array_type)
+  {
+    PyObject *module = PyImport_ImportModule("array");
+    if (!module)
+      return NULL;
+    array_type = PyObject_GetAttrString(module, "array");
+    Py_DECREF(module);
+    if (!array_type)
+      return NULL;
+  }
+  PyObject *result = PyObject_CallFunction(array_type, "s", "q");
+  if (!result || count == 0)
+    return result;
+  PyObject *view = PyMemoryView_FromMemory((char *)indices, count * (Py_ssize_t)sizeof(long long), PyBUF_READ);
+  PyObject *status = view ? PyObject_CallMethod(result, "frombytes", "O", view) : NULL;
+  Py_XDECREF(view);
+  if (!status)
   {
-    PyObject *target_str = current->str;
-    PyObject *target_substr = substring_obj;
-    int found = 0;
+    Py_DECREF(result);
+    return NULL;
+  }
+  Py_DECREF(status);
+  return result;
+}
+
+static PyObject *BString_find_all(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  BStringNeedle needle;
+  int invert = 0;
+  if (BString_parse_needle(args, nargs, kwnames, "s|pp:find_all", &needle, &invert) < 0)
+    return NULL;
+  long long *indices = NULL;
+  Py_ssize_t count = BString_match(self, &needle, invert, &indices);
+  BStringNeedle_clear(&needle);
+  PyObject *result = count < 0 ? NULL : BString_index_array(indices, count);
+  PyMem_Free(indices);
+  return result;
+}
 
-    if (!case_sensitive)
+// Like find_all(), but returns the matching strings as a new BString in the
+// same storage mode.
+static PyObject *BString_grep(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  BStringNeedle needle;
+  int invert = 0;
+  if (BString_parse_needle(args, nargs, kwnames, "s|pp:grep", &needle, &invert) < 0)
+    return NULL;
+  long long *indices = NULL;
+  Py_ssize_t count = BString_match(self, &needle, invert, &indices);
+  BStringNeedle_clear(&needle);
+  BStringObject *result = count < 0 ? NULL : (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (!result)
+    goto error;
+
+  if (self->arena)
+  {
+    if (BString_compact_storage(result) < 0)
+      goto error;
+    for (Py_ssize_t i = 0; i < count; ++i)
     {
-      target_str = PyObject_CallMethod(current->str, "lower", NULL);
-      target_substr = PyObject_CallMethod(substring_obj, "lower", NULL);
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(self->arena, (Py_ssize_t)indices[i], &length);
+      if (BStringArena_append(result->arena, bytes, length) != 0)
+        goto error;
+      result->size++;
     }
-
-    if (target_str && target_substr)
+  }
+  else if (count > 0)
+  {
+    // Reuse the index buffer for the borrowed items; a pointer is never
+    // wider than a long long.
+    PyObject **items = (PyObject **)indices;
+    for (Py_ssize_t i = 0; i < count; ++i)
     {
-      if (PyUnicode_Find(target_str, target_substr, 0, PyUnicode_GET_LENGTH(target_str), 1) != -1)
-      {
-        found = 1;
-      }
+      items[i] = BString_item_at(self, (Py_ssize_t)indices[i]);
     }
+    if (BString_push_array(result, items, count) != 0)
+      goto error;
+  }
+  PyMem_Free(indices);
+  return (PyObject *)result;
+
+error:
+  Py_XDECREF(result);
+  PyMem_Free(indices);
+  return NULL;
+}
+
+// Scans every element once for all patterns. patterns is a BStringPatterns,
+// which keeps its own case sensitivity, or an iterable of strings compiled
+// for this call.
+static PyObject *BString_find_any(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  PyObject *patterns;
+  int case_sensitive = 1;
+  int positions = 0;
+  static char *kwlist[] = {"patterns", "case_sensitive", "positions", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "O|pp:find_any", kwlist, &patterns, &case_sensitive, &positions))
+  {
+    return NULL;
+  }
+
+  BStringPatternsObject *compiled;
+  if (PyObject_TypeCheck(patterns, &BStringPatterns_Type))
+  {
+    Py_INCREF(patterns);
+    compiled = (BStringPatternsObject *)patterns;
+  }
+  else
+  {
+    compiled = (BStringPatternsObject *)BStringPatterns_compile(patterns, case_sensitive);
+    if (!compiled)
+      return NULL;
+  }
 
-    if (!case_sensitive)
+  PyObject *result = PyList_New(0);
+  int status = result ? 0 : -1;
+  if (self->arena)
+  {
+    for (Py_ssize_t i = 0; status == 0 && i < self->arena->count; ++i)
     {
-      Py_XDECREF(target_str);
-      Py_XDECREF(target_substr);
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(self->arena, i, &length);
+      status = BStringPatterns_scan_utf8(compiled, bytes, length, i, result, positions);
     }
-
-    if (found || PyErr_Occurred())
+  }
+  else if (result)
+  {
+    BStringWalk walk;
+    BString_walk_init(&walk, self, 0);
+    PyObject *item;
+    for (Py_ssize_t i = 0; status == 0 && (item = BString_walk_next(&walk)); ++i)
     {
-      Py_DECREF(substring_obj);
-      if (PyErr_Occurred())
-        return NULL;
-      Py_RETURN_TRUE;
+      status = BStringPatterns_scan(compiled, item, i, result, positions);
     }
-
-    current = current->next;
   }
-  Py_DECREF(substring_obj);
-  Py_RETURN_FALSE;
+  Py_DECREF(compiled);
+  if (status < 0)
+  {
+    Py_XDECREF(result);
+    return NULL;
+  }
+  return result;
 }
 
+static PyObject *BString_contains(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  BStringNeedle needle;
+  int invert = 0;
+  if (BString_parse_needle(args, nargs, kwnames, "s|p:contains", &needle, &invert) < 0)
+    return NULL;
+  Py_ssize_t found = BString_match(self, &needle, 0, NULL);
+  BStringNeedle_clear(&needle);
+  if (found < 0)
+    return NULL;
+  return PyBool_FromLong(found);
+}
 
-static PyObject *BString_join(BStringObject *self, PyObject *separator)
+
+// Copies all of src into dest, a new str wide enough for it, at position at.
+static inline void BString_copy_text(PyObject *dest, Py_ssize_t at, PyObject *src)
+{
+  int kind = PyUnicode_KIND(dest);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(src);
+  if (PyUnicode_KIND(src) == kind)
+  {
+    memcpy((char *)PyUnicode_DATA(dest) + at * kind, PyUnicode_DATA(src), length * kind);
+    return;
+  }
+  int src_kind = PyUnicode_KIND(src);
+  const void *src_data = PyUnicode_DATA(src);
+  void *data = PyUnicode_DATA(dest);
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    PyUnicode_WRITE(kind, data, at + i, PyUnicode_READ(src_kind, src_data, i));
+  }
+}
+
+// Joins in two passes over the walk: the first sums the lengths and finds
+// the widest character, the second copies the items into one new str.
+PyObject *BString_join_walk(BStringWalk *walk, PyObject *separator)
 {
   if (!PyUnicode_Check(separator))
   {
@@ -116,122 +442,525 @@ static PyObject *BString_join(BStringObject *self, PyObject *separator)
     return NULL;
   }
 
-  PyObject *list = PyList_New(self->size);
-  if (!list)
-    return NULL;
+  BStringWalk sizing = *walk;
+  PyObject *item;
+  Py_ssize_t count = 0;
+  Py_ssize_t total = 0;
+  Py_ssize_t sep_len = PyUnicode_GET_LENGTH(separator);
+  Py_UCS4 max_char = PyUnicode_MAX_CHAR_VALUE(separator);
+  PyObject *last = NULL;
+  while ((item = BString_walk_next(&sizing)))
+  {
+    Py_ssize_t length = PyUnicode_GET_LENGTH(item) + (count > 0 ? sep_len : 0);
+    if (total > PY_SSIZE_T_MAX - length)
+    {
+      PyErr_SetString(PyExc_OverflowError, "join() result is too long");
+      return NULL;
+    }
+    total += length;
+    if (PyUnicode_MAX_CHAR_VALUE(item) > max_char)
+      max_char = PyUnicode_MAX_CHAR_VALUE(item);
+    last = item;
+    count++;
+  }
+  if (count == 1 && PyUnicode_CheckExact(last))
+  {
+    Py_INCREF(last);
+    return last;
+  }
+  if (count < 2)
+    max_char = count ? PyUnicode_MAX_CHAR_VALUE(last) : 0;
 
-  BStringNode *current = self->head;
-  for (Py_ssize_t i = 0; i < self->size; ++i)
+  PyObject *result = PyUnicode_New(total, max_char);
+  if (!result)
+    return NULL;
+  int kind = PyUnicode_KIND(result);
+  void *data = PyUnicode_DATA(result);
+  Py_UCS4 sep_char = sep_len == 1 ? PyUnicode_READ_CHAR(separator, 0) : 0;
+  Py_ssize_t at = 0;
+  for (Py_ssize_t i = 0; i < count; ++i)
   {
-    Py_INCREF(current->str);
-    PyList_SET_ITEM(list, i, current->str);
-    current = current->next;
+    item = BString_walk_next(walk);
+    if (i > 0 && sep_len == 1)
+    {
+      PyUnicode_WRITE(kind, data, at++, sep_char);
+    }
+    else if (i > 0 && sep_len > 0)
+    {
+      BString_copy_text(result, at, separator);
+      at += sep_len;
+    }
+    BString_copy_text(result, at, item);
+    at += PyUnicode_GET_LENGTH(item);
   }
+  return result;
+}
 
-  PyObject *result = PyUnicode_Join(separator, list);
-  Py_DECREF(list); 
+// join() over compact storage: copies the arena bytes and separators into
+// one buffer and decodes it once.
+static PyObject *BString_join_arena(BStringArena *arena, PyObject *separator)
+{
+  if (!PyUnicode_Check(separator))
+  {
+    PyErr_SetString(PyExc_TypeError, "separator must be a string");
+    return NULL;
+  }
+  Py_ssize_t sep_len;
+  const char *sep = PyUnicode_AsUTF8AndSize(separator, &sep_len);
+  if (!sep)
+    return NULL;
+  if (arena->count == 0)
+    return PyUnicode_FromString("");
+  if (sep_len == 0)
+    return PyUnicode_DecodeUTF8(arena->data, arena->used, "strict");
+
+  Py_ssize_t total = arena->used + sep_len * (arena->count - 1);
+  char *buffer = PyMem_Malloc(total);
+  if (!buffer)
+    return PyErr_NoMemory();
+  char *out = buffer;
+  for (Py_ssize_t i = 0; i < arena->count; ++i)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringArena_bytes(arena, i, &length);
+    if (i > 0)
+    {
+      memcpy(out, sep, sep_len);
+      out += sep_len;
+    }
+    memcpy(out, bytes, length);
+    out += length;
+  }
+  PyObject *result = PyUnicode_DecodeUTF8(buffer, total, "strict");
+  PyMem_Free(buffer);
   return result;
 }
 
-static PyObject *BString_split(PyObject *type, PyObject *args, PyObject *kwds)
+static PyObject *BString_join(BStringObject *self, PyObject *separator)
 {
-  PyObject *string_to_split;
-  const char *delimiter = NULL;
-  static char *kwlist[] = {"string", "delimiter", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "U|s", kwlist, &string_to_split, &delimiter))
+  if (self->arena)
+    return BString_join_arena(self->arena, separator);
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  return BString_join_walk(&walk, separator);
+}
+
+// Raises TypeError with message unless all n items are strings.
+static int BString_check_strings(PyObject *const *items, Py_ssize_t n, const char *message)
+{
+  for (Py_ssize_t i = 0; i < n; ++i)
+  {
+    if (!PyUnicode_Check(items[i]))
+    {
+      PyErr_SetString(PyExc_TypeError, message);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Appends every string produced by iterable. BStrings, lists and tuples are
+// appended in bulk; other iterables reserve storage from their length hint
+// and are then appended one item at a time.
+static int BString_extend_from_iterable(BStringObject *self, PyObject *iterable, const char *name)
+{
+  if (PyObject_TypeCheck(iterable, &BStringType))
+  {
+    return BString_push_shared(self, (BStringObject *)iterable);
+  }
+  if (PyList_Check(iterable) || PyTuple_Check(iterable))
+  {
+    PyObject *items = PySequence_Fast(iterable, "");
+    if (!items)
+      return -1;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+    PyObject **values = PySequence_Fast_ITEMS(items);
+    int status = BString_check_strings(values, count, "BString can only extend with an iterable of strings");
+    if (status == 0)
+      status = BString_push_array(self, values, count);
+    Py_DECREF(items);
+    return status;
+  }
+
+  PyObject *iterator = PyObject_GetIter(iterable);
+  if (!iterator)
+  {
+    PyErr_Format(PyExc_TypeError, "%s() argument must be an iterable", name);
+    return -1;
+  }
+  Py_ssize_t hint = PyObject_LengthHint(iterable, 0);
+  if (hint < 0 || BString_reserve(self, hint) < 0)
+  {
+    Py_DECREF(iterator);
+    return -1;
+  }
+
+  PyObject *item;
+  while ((item = PyIter_Next(iterator)))
+  {
+    if (!PyUnicode_Check(item))
+    {
+      PyErr_SetString(PyExc_TypeError, "BString can only extend with an iterable of strings");
+      Py_DECREF(item);
+      Py_DECREF(iterator);
+      return -1;
+    }
+
+    if (BString_push(self, item) != 0)
+    {
+      Py_DECREF(item);
+      Py_DECREF(iterator);
+      return -1;
+    }
+
+    Py_DECREF(item);
+  }
+
+  Py_DECREF(iterator);
+  return PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject *BString_from_list(PyObject *type, PyObject *sequence)
+{
+  PyObject *items = PySequence_Fast(sequence, "from_list() argument must be a list, tuple or other sequence");
+  if (!items)
+    return NULL;
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+  PyObject **values = PySequence_Fast_ITEMS(items);
+  if (BString_check_strings(values, count, "All items must be strings.") < 0)
   {
+    Py_DECREF(items);
     return NULL;
   }
 
-  PyObject *split_list = PyObject_CallMethod(string_to_split, "split", "z", delimiter);
-  if (!split_list)
+  BStringObject *new_bstring = (BStringObject *)((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
+  if (!new_bstring || BString_push_array(new_bstring, values, count) != 0)
+  {
+    Py_XDECREF(new_bstring);
+    Py_DECREF(items);
     return NULL;
+  }
+  Py_DECREF(items);
+  return (PyObject *)new_bstring;
+}
 
-  PyObject *args_tuple = PyList_AsTuple(split_list);
-  Py_DECREF(split_list); 
-  if (!args_tuple)
+static PyObject *BString_from_iterable(PyObject *type, PyObject *iterable)
+{
+  BStringObject *new_bstring = (BStringObject *)((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
+  if (!new_bstring)
+    return NULL;
+  if (BString_extend_from_iterable(new_bstring, iterable, "from_iterable") != 0)
   {
-    return NULL; 
+    Py_DECREF(new_bstring);
+    return NULL;
   }
+  return (PyObject *)new_bstring;
+}
 
-  PyObject *result_bstring = PyObject_CallObject(type, args_tuple);
-  Py_DECREF(args_tuple); 
-  return result_bstring;
+// Appends string[start:end] to self, unless it is empty and keep_empty is
+// not set.
+static int BString_push_piece(BStringObject *self, PyObject *string, Py_ssize_t start, Py_ssize_t end, int keep_empty)
+{
+  if (start == end && !keep_empty)
+    return 0;
+  PyObject *piece = PyUnicode_Substring(string, start, end);
+  if (!piece)
+    return -1;
+  int status = BString_push(self, piece);
+  Py_DECREF(piece);
+  return status;
 }
 
-static PyObject *_BString_render_as_csv_string(BStringObject *self, const char *delimiter, const char *quotechar, int quoting)
+// Position of delimiter in string[start:], or -1. Single-byte text is
+// searched with the SIMD byte search (memchr() for one character), wider
+// text by the first character with PyUnicode_FindChar(), which needs no
+// widened copy of the delimiter.
+static Py_ssize_t BString_find_delimiter(PyObject *string, PyObject *delimiter, Py_ssize_t start)
 {
-  if (strlen(delimiter) != 1 || strlen(quotechar) != 1)
+  int kind = PyUnicode_KIND(string);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(string);
+  Py_ssize_t sep_len = PyUnicode_GET_LENGTH(delimiter);
+  if (PyUnicode_KIND(delimiter) > kind)
+    return -1;
+  if (kind == PyUnicode_1BYTE_KIND)
+  {
+    Py_ssize_t found = BStringSearch_bytes((const char *)PyUnicode_DATA(string) + start, length - start,
+                                           (const char *)PyUnicode_DATA(delimiter), sep_len);
+    return found < 0 ? -1 : start + found;
+  }
+
+  const void *data = PyUnicode_DATA(string);
+  int sep_kind = PyUnicode_KIND(delimiter);
+  const void *sep_data = PyUnicode_DATA(delimiter);
+  Py_UCS4 first = PyUnicode_READ(sep_kind, sep_data, 0);
+  while (start <= length - sep_len)
+  {
+    Py_ssize_t found = PyUnicode_FindChar(string, first, start, length - sep_len + 1, 1);
+    if (found < 0)
+      return found;
+    Py_ssize_t i = 1;
+    while (i < sep_len && PyUnicode_READ(kind, data, found + i) == PyUnicode_READ(sep_kind, sep_data, i))
+      i++;
+    if (i == sep_len)
+      return found;
+    start = found + 1;
+  }
+  return -1;
+}
+
+// str.split(delimiter, maxsplit), appending the pieces as they are found.
+static int BString_split_on(BStringObject *self, PyObject *string, PyObject *delimiter, Py_ssize_t maxsplit, int keep_empty)
+{
+  Py_ssize_t length = PyUnicode_GET_LENGTH(string);
+  Py_ssize_t sep_len = PyUnicode_GET_LENGTH(delimiter);
+  Py_ssize_t start = 0;
+  for (Py_ssize_t splits = 0; splits < maxsplit; ++splits)
+  {
+    Py_ssize_t found = BString_find_delimiter(string, delimiter, start);
+    if (found == -2)
+      return -1;
+    if (found < 0)
+      break;
+    if (BString_push_piece(self, string, start, found, keep_empty) < 0)
+      return -1;
+    start = found + sep_len;
+  }
+  return BString_push_piece(self, string, start, length, keep_empty);
+}
+
+// str.split(None, maxsplit): pieces are separated by runs of whitespace and
+// the remainder after maxsplit splits only loses its leading whitespace.
+static int BString_split_whitespace(BStringObject *self, PyObject *string, Py_ssize_t maxsplit)
+{
+  int kind = PyUnicode_KIND(string);
+  const void *data = PyUnicode_DATA(string);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(string);
+  Py_ssize_t i = 0;
+  for (Py_ssize_t splits = 0;; ++splits)
+  {
+    while (i < length && Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, i)))
+      i++;
+    if (i == length)
+      return 0;
+    Py_ssize_t start = i;
+    if (splits == maxsplit)
+      return BString_push_piece(self, string, start, length, 1);
+    while (i < length && !Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, i)))
+      i++;
+    if (BString_push_piece(self, string, start, i, 1) < 0)
+      return -1;
+  }
+}
+
+// Splits a string natively, like str.split(delimiter, maxsplit), linking the
+// pieces into the new BString as they are found. keep_empty=False drops the
+// empty pieces an explicit delimiter produces.
+static PyObject *BString_split(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  PyObject *string_to_split;
+  PyObject *delimiter = Py_None;
+  Py_ssize_t maxsplit = -1;
+  int keep_empty = 1;
+  static char *kwlist[] = {"string", "delimiter", "maxsplit", "keep_empty", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "O!|Onp:split", kwlist, &PyUnicode_Type, &string_to_split, &delimiter, &maxsplit, &keep_empty))
   {
-    PyErr_SetString(PyExc_ValueError, "delimiter and quotechar must be single characters");
     return NULL;
   }
-  PyObject *processed_fields = PyList_New(0);
-  if (!processed_fields)
+  if (delimiter != Py_None && !PyUnicode_Check(delimiter))
+  {
+    PyErr_SetString(PyExc_TypeError, "delimiter must be a string or None");
+    return NULL;
+  }
+  if (delimiter != Py_None && PyUnicode_GET_LENGTH(delimiter) == 0)
+  {
+    PyErr_SetString(PyExc_ValueError, "empty separator");
     return NULL;
+  }
+  if (maxsplit < 0)
+    maxsplit = PY_SSIZE_T_MAX;
 
-  BStringNode *current = self->head;
-  while (current)
+  BStringObject *result_bstring = (BStringObject *)((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
+  if (!result_bstring)
+    return NULL;
+  int status = delimiter == Py_None ? BString_split_whitespace(result_bstring, string_to_split, maxsplit)
+                                    : BString_split_on(result_bstring, string_to_split, delimiter, maxsplit, keep_empty);
+  if (status != 0)
   {
-    int needs_quoting = 0;
-    PyObject *field = current->str;
+    Py_DECREF(result_bstring);
+    return NULL;
+  }
+  return (PyObject *)result_bstring;
+}
 
-    if (quoting == BSTRING_QUOTE_ALL)
-    {
-      needs_quoting = 1;
-    }
-    else if (quoting == BSTRING_QUOTE_MINIMAL)
+// CSV rendering over compact storage. The delimiter and quote character are
+// single ASCII bytes, so fields can be scanned and escaped as raw UTF-8.
+static PyObject *BString_render_arena_as_csv(BStringArena *arena, char delimiter, char quotechar, int quoting)
+{
+  Py_ssize_t total = arena->count > 0 ? arena->count - 1 : 0;
+  for (Py_ssize_t i = 0; i < arena->count; ++i)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringArena_bytes(arena, i, &length);
+    total += length;
+    if (quoting == BSTRING_QUOTE_ALL || quoting == BSTRING_QUOTE_MINIMAL)
     {
-      PyObject *delim_obj = PyUnicode_FromString(delimiter);
-      PyObject *qc_obj = PyUnicode_FromString(quotechar);
-      if (delim_obj && qc_obj &&
-          (PyUnicode_Find(field, delim_obj, 0, PyUnicode_GET_LENGTH(field), 1) != -1 || PyUnicode_Find(field, qc_obj, 0, PyUnicode_GET_LENGTH(field), 1) != -1))
+      // Room for the surrounding quotes and a doubled quote per quote byte.
+      total += 2;
+      for (Py_ssize_t j = 0; j < length; ++j)
       {
-        needs_quoting = 1;
+        if (bytes[j] == quotechar)
+          total++;
       }
-      Py_XDECREF(delim_obj);
-      Py_XDECREF(qc_obj);
     }
+  }
+
+  char *buffer = PyMem_Malloc(total > 0 ? total : 1);
+  if (!buffer)
+    return PyErr_NoMemory();
+  char *out = buffer;
+  for (Py_ssize_t i = 0; i < arena->count; ++i)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringArena_bytes(arena, i, &length);
+    if (i > 0)
+      *out++ = delimiter;
 
-    PyObject *final_field;
-    if (needs_quoting)
+    int needs_quoting = quoting == BSTRING_QUOTE_ALL;
+    if (quoting == BSTRING_QUOTE_MINIMAL)
+    {
+      needs_quoting = memchr(bytes, delimiter, length) || memchr(bytes, quotechar, length);
+    }
+    if (!needs_quoting)
     {
-      PyObject *qc_obj = PyUnicode_FromString(quotechar);
-      PyObject *doubled_qc_obj = PyUnicode_FromFormat("%s%s", quotechar, quotechar);
-      PyObject *escaped_field = PyUnicode_Replace(field, qc_obj, doubled_qc_obj, -1);
+      memcpy(out, bytes, length);
+      out += length;
+      continue;
+    }
+    *out++ = quotechar;
+    for (Py_ssize_t j = 0; j < length; ++j)
+    {
+      if (bytes[j] == quotechar)
+        *out++ = quotechar;
+      *out++ = bytes[j];
+    }
+    *out++ = quotechar;
+  }
+  PyObject *result = PyUnicode_DecodeUTF8(buffer, out - buffer, "strict");
+  PyMem_Free(buffer);
+  return result;
+}
 
-      if (escaped_field)
-      {
-        final_field = PyUnicode_FromFormat("%s%s%s", quotechar, PyUnicode_AsUTF8(escaped_field), quotechar);
-        Py_DECREF(escaped_field);
-      }
-      else
-      {
-        final_field = NULL; 
-      }
-      Py_DECREF(qc_obj);
-      Py_DECREF(doubled_qc_obj);
+// Counts the quote characters of a CSV field and reports whether it holds
+// the delimiter.
+static Py_ssize_t BString_csv_scan(PyObject *field, Py_UCS4 delimiter, Py_UCS4 quotechar, int *has_delimiter)
+{
+  int kind = PyUnicode_KIND(field);
+  const void *data = PyUnicode_DATA(field);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(field);
+  Py_ssize_t quotes = 0;
+  if (kind == PyUnicode_1BYTE_KIND)
+  {
+    const char *bytes = data;
+    const char *end = bytes + length;
+    *has_delimiter = memchr(bytes, (int)delimiter, length) != NULL;
+    for (const char *at = bytes; (at = memchr(at, (int)quotechar, end - at)); ++at)
+      quotes++;
+    return quotes;
+  }
+  *has_delimiter = 0;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+    quotes += ch == quotechar;
+    *has_delimiter |= ch == delimiter;
+  }
+  return quotes;
+}
+
+static PyObject *_BString_render_as_csv_string(BStringObject *self, const char *delimiter, const char *quotechar, int quoting)
+{
+  if (strlen(delimiter) != 1 || strlen(quotechar) != 1)
+  {
+    PyErr_SetString(PyExc_ValueError, "delimiter and quotechar must be single characters");
+    return NULL;
+  }
+  if (self->arena)
+    return BString_render_arena_as_csv(self->arena, delimiter[0], quotechar[0], quoting);
+
+  // First pass: the exact length, the widest character and which fields are
+  // quoted, then one str is filled with the row.
+  Py_UCS4 delim = (unsigned char)delimiter[0];
+  Py_UCS4 quote = (unsigned char)quotechar[0];
+  Py_ssize_t count = self->size;
+  Py_ssize_t *quotes = PyMem_Malloc((count > 0 ? count : 1) * sizeof(Py_ssize_t));
+  if (!quotes)
+    return PyErr_NoMemory();
+  Py_ssize_t total = count > 0 ? count - 1 : 0;
+  Py_UCS4 max_char = 127;
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  PyObject *field;
+  for (Py_ssize_t i = 0; (field = BString_walk_next(&walk)); ++i)
+  {
+    int has_delimiter;
+    Py_ssize_t num_quotes = BString_csv_scan(field, delim, quote, &has_delimiter);
+    int needs_quoting = quoting == BSTRING_QUOTE_ALL || (quoting == BSTRING_QUOTE_MINIMAL && (has_delimiter || num_quotes > 0));
+    // -1 marks a field written as it is; otherwise the quotes to double.
+    quotes[i] = needs_quoting ? num_quotes : -1;
+    Py_ssize_t length = PyUnicode_GET_LENGTH(field) + (needs_quoting ? num_quotes + 2 : 0);
+    if (total > PY_SSIZE_T_MAX - length)
+    {
+      PyMem_Free(quotes);
+      PyErr_SetString(PyExc_OverflowError, "CSV row is too long");
+      return NULL;
+    }
+    total += length;
+    if (PyUnicode_MAX_CHAR_VALUE(field) > max_char)
+      max_char = PyUnicode_MAX_CHAR_VALUE(field);
+  }
+
+  PyObject *csv_string = PyUnicode_New(total, max_char);
+  if (!csv_string)
+  {
+    PyMem_Free(quotes);
+    return NULL;
+  }
+  int kind = PyUnicode_KIND(csv_string);
+  void *data = PyUnicode_DATA(csv_string);
+  Py_ssize_t at = 0;
+  BString_walk_init(&walk, self, 0);
+  for (Py_ssize_t i = 0; (field = BString_walk_next(&walk)); ++i)
+  {
+    if (i > 0)
+      PyUnicode_WRITE(kind, data, at++, delim);
+    if (quotes[i] < 0)
+    {
+      BString_copy_text(csv_string, at, field);
+      at += PyUnicode_GET_LENGTH(field);
+      continue;
     }
-    else
+    PyUnicode_WRITE(kind, data, at++, quote);
+    if (quotes[i] == 0)
     {
-      Py_INCREF(field);
-      final_field = field;
+      BString_copy_text(csv_string, at, field);
+      at += PyUnicode_GET_LENGTH(field);
     }
-
-    if (!final_field || PyList_Append(processed_fields, final_field) != 0)
+    else
     {
-      Py_XDECREF(final_field);
-      Py_DECREF(processed_fields);
-      return NULL;
+      int field_kind = PyUnicode_KIND(field);
+      const void *field_data = PyUnicode_DATA(field);
+      Py_ssize_t length = PyUnicode_GET_LENGTH(field);
+      for (Py_ssize_t j = 0; j < length; ++j)
+      {
+        Py_UCS4 ch = PyUnicode_READ(field_kind, field_data, j);
+        if (ch == quote)
+          PyUnicode_WRITE(kind, data, at++, quote);
+        PyUnicode_WRITE(kind, data, at++, ch);
+      }
     }
-    Py_DECREF(final_field);
-    current = current->next;
+    PyUnicode_WRITE(kind, data, at++, quote);
   }
-
-  PyObject *delimiter_obj = PyUnicode_FromString(delimiter);
-  PyObject *csv_string = PyUnicode_Join(delimiter_obj, processed_fields);
-  Py_DECREF(delimiter_obj);
-  Py_DECREF(processed_fields);
+  PyMem_Free(quotes);
   return csv_string;
 }
 
@@ -364,353 +1093,697 @@ static PyObject *BString_to_csv(PyObject *type, PyObject *args, PyObject *kwds)
   Py_RETURN_NONE;
 }
 
-static PyObject *BString_from_csv(PyObject *type, PyObject *args, PyObject *kwds)
+// Checks a threads= argument.
+static int BString_check_threads(int threads, const char *fname)
 {
-  const char *filepath;
-  int header = 1;
-  static char *kwlist[] = {"filepath", "header", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|p", kwlist, &filepath, &header))
+  if (threads < 1 || threads > 1024)
   {
-    return NULL;
+    PyErr_Format(PyExc_ValueError, "%s() threads must be between 1 and 1024", fname);
+    return -1;
   }
+  return 0;
+}
 
-  PyObject *builtins = NULL, *open_func = NULL, *file_handle = NULL;
-  PyObject *csv_module = NULL, *reader_func = NULL, *reader_obj = NULL, *reader_iter = NULL;
-  PyObject *header_bstring = NULL, *data_rows_list = NULL, *return_value = NULL;
-
-  builtins = PyImport_ImportModule("builtins");
-  if (!builtins)
-    goto cleanup;
-
-  open_func = PyObject_GetAttrString(builtins, "open");
-
-  if (!open_func)
-    goto cleanup;
-
-  PyObject *open_args = Py_BuildValue("(ss)", filepath, "r");
-  PyObject *open_kwargs = Py_BuildValue("{s:s}", "encoding", "utf-8");
-  file_handle = PyObject_Call(open_func, open_args, open_kwargs);
-  Py_DECREF(open_args);
-  Py_DECREF(open_kwargs);
-
-  if (!file_handle)
-    goto cleanup;
-
-  csv_module = PyImport_ImportModule("csv");
-  if (!csv_module)
-    goto cleanup;
-
-  reader_func = PyObject_GetAttrString(csv_module, "reader");
-
-  if (!reader_func)
-    goto cleanup;
-
-  reader_obj = PyObject_CallFunctionObjArgs(reader_func, file_handle, NULL);
-
-  if (!reader_obj)
-    goto cleanup;
+// A new BString of type holding the fields of parsed record r, or with picks
+// the fields at those offsets in the record, empty past its end.
+static PyObject *BString_csv_row(PyTypeObject *type, BStringCsvRows *rows, Py_ssize_t r, const Py_ssize_t *picks, Py_ssize_t num_picks)
+{
+  BStringObject *row = (BStringObject *)type->tp_new(type, NULL, NULL);
+  if (!row)
+    return NULL;
+  Py_ssize_t first = BStringCsvRows_first_field(rows, r);
+  // An empty line stays a row without fields when columns are picked.
+  Py_ssize_t count = picks && rows->row_ends[r] > first ? num_picks : rows->row_ends[r] - first;
+  for (Py_ssize_t j = 0; j < count; ++j)
+  {
+    Py_ssize_t f = first + (picks ? picks[j] : j);
+    PyObject *field = f < rows->row_ends[r] ? BStringArena_item(rows->fields, f) : PyUnicode_New(0, 0);
+    int status = field ? BString_push(row, field) : -1;
+    Py_XDECREF(field);
+    if (status != 0)
+    {
+      Py_DECREF(row);
+      return NULL;
+    }
+  }
+  return (PyObject *)row;
+}
 
-  reader_iter = PyObject_GetIter(reader_obj);
+// Checks the CSV options of from_csv() and iter_csv() and sets up a parser.
+static int BString_csv_parser(BStringCsvParser *parser, const char *delimiter, const char *quotechar, int threads, const char *fname)
+{
+  if (strlen(delimiter) != 1 || strlen(quotechar) != 1 || delimiter[0] == quotechar[0] ||
+      strchr("\r\n", delimiter[0]) || strchr("\r\n", quotechar[0]))
+  {
+    PyErr_SetString(PyExc_ValueError, "delimiter and quotechar must be two different single characters other than a line break");
+    return -1;
+  }
+  if (BString_check_threads(threads, fname) < 0)
+    return -1;
+  BStringCsvParser_init(parser, delimiter[0], quotechar[0]);
+  return 0;
+}
 
-  if (!reader_iter)
-    goto cleanup;
+// The usecols= and where= options of from_csv() resolved to columns. The
+// parser points into the arrays while the file is read.
+typedef struct {
+    Py_ssize_t *slots;             // The parser's slots.
+    Py_ssize_t *header_picks;      // The columns of usecols, for the header row.
+    Py_ssize_t *picks;             // Their offsets among the kept fields, for the other rows.
+    Py_ssize_t num_picks;
+    BStringCsvMatch *matches;
+    char *values;                  // The UTF-8 bytes of the where= values, which the matches point into.
+} BStringCsvSelection;
+
+static void BString_csv_selection_free(BStringCsvSelection *selection)
+{
+  PyMem_Free(selection->slots);
+  PyMem_Free(selection->header_picks);
+  PyMem_Free(selection->picks);
+  PyMem_Free(selection->matches);
+  PyMem_Free(selection->values);
+}
 
-  if (header)
+// The column key stands for: an index, or a name in the header row, which
+// header_rows holds when the file has one.
+static Py_ssize_t BString_csv_column(PyObject *key, BStringCsvRows *header_rows)
+{
+  if (PyLong_Check(key))
   {
-    PyObject *row_list = PyIter_Next(reader_iter);
-    if (row_list)
-    {
-      PyObject *row_tuple = PyList_AsTuple(row_list);
-      header_bstring = PyObject_CallObject(type, row_tuple);
-      Py_DECREF(row_tuple);
-      Py_DECREF(row_list);
-      if (!header_bstring)
-        goto cleanup;
-    }
-    else if (PyErr_Occurred())
+    Py_ssize_t column = PyLong_AsSsize_t(key);
+    if (column < 0 && !PyErr_Occurred())
+      PyErr_SetString(PyExc_ValueError, "column indexes must not be negative");
+    return column;
+  }
+  if (!PyUnicode_Check(key))
+  {
+    PyErr_Format(PyExc_TypeError, "columns must be given as int or str, not %.50s", Py_TYPE(key)->tp_name);
+    return -1;
+  }
+  if (!header_rows)
+  {
+    PyErr_SetString(PyExc_ValueError, "columns can be named only with header=True");
+    return -1;
+  }
+  Py_ssize_t length;
+  const char *name = PyUnicode_AsUTF8AndSize(key, &length);
+  if (!name)
+    return -1;
+  if (header_rows->num_rows > 0)
+  {
+    for (Py_ssize_t f = 0; f < header_rows->row_ends[0]; ++f)
     {
-      goto cleanup;
+      Py_ssize_t field_length;
+      const char *field = BStringArena_bytes(header_rows->fields, f, &field_length);
+      if (field_length == length && memcmp(field, name, length) == 0)
+        return f;
     }
-    else
+  }
+  PyErr_Format(PyExc_ValueError, "no column named %R", key);
+  return -1;
+}
+
+// Resolves usecols= and where= into selection and points the parser at it.
+// Only the columns they use are kept when usecols is given.
+static int BString_csv_select(BStringCsvSelection *selection, BStringCsvParser *parser, PyObject *usecols, PyObject *where,
+                              BStringCsvRows *header_rows)
+{
+  Py_ssize_t num_matches = where != Py_None ? PyDict_GET_SIZE(where) : 0;
+  if (usecols == Py_None && num_matches == 0)
+    return 0;
+  if (usecols != Py_None)
+  {
+    if (PyUnicode_Check(usecols))
     {
-      header_bstring = PyObject_CallObject(type, PyTuple_New(0));
-      if (!header_bstring)
-        goto cleanup;
+      PyErr_SetString(PyExc_TypeError, "usecols must be a sequence of column indexes or names");
+      return -1;
     }
+    PyObject *columns = PySequence_Fast(usecols, "usecols must be a sequence of column indexes or names");
+    if (!columns)
+      return -1;
+    selection->num_picks = PySequence_Fast_GET_SIZE(columns);
+    selection->header_picks = PyMem_Malloc((selection->num_picks + 1) * sizeof(Py_ssize_t));
+    selection->picks = PyMem_Malloc((selection->num_picks + 1) * sizeof(Py_ssize_t));
+    int status = selection->header_picks && selection->picks ? 0 : -1;
+    if (status < 0)
+      PyErr_NoMemory();
+    for (Py_ssize_t j = 0; status == 0 && j < selection->num_picks; ++j)
+    {
+      selection->header_picks[j] = BString_csv_column(PySequence_Fast_GET_ITEM(columns, j), header_rows);
+      status = selection->header_picks[j] < 0 ? -1 : 0;
+    }
+    Py_DECREF(columns);
+    if (status < 0)
+      return -1;
   }
 
-  data_rows_list = PyList_New(0);
-  if (!data_rows_list)
-    goto cleanup;
-
-  PyObject *row_list;
-  while ((row_list = PyIter_Next(reader_iter)))
+  selection->matches = PyMem_Malloc((num_matches + 1) * sizeof(BStringCsvMatch));
+  if (!selection->matches)
   {
-    PyObject *row_tuple = PyList_AsTuple(row_list);
-    PyObject *row_bstring = PyObject_CallObject(type, row_tuple);
-    Py_DECREF(row_tuple);
-    Py_DECREF(row_list);
-
-    if (!row_bstring)
-      goto cleanup;
-
-    if (PyList_Append(data_rows_list, row_bstring) < 0)
+    PyErr_NoMemory();
+    return -1;
+  }
+  Py_ssize_t position = 0;
+  PyObject *key;
+  PyObject *value;
+  for (Py_ssize_t m = 0; m < num_matches && PyDict_Next(where, &position, &key, &value); ++m)
+  {
+    BStringCsvMatch *match = &selection->matches[m];
+    if (!PyUnicode_Check(value))
     {
-      Py_DECREF(row_bstring);
-      goto cleanup;
+      PyErr_Format(PyExc_TypeError, "where= values must be str, not %.50s", Py_TYPE(value)->tp_name);
+      return -1;
     }
-    Py_DECREF(row_bstring);
+    match->slot = BString_csv_column(key, header_rows);
+    match->value = PyUnicode_AsUTF8AndSize(value, &match->length);
+    if (match->slot < 0 || !match->value)
+      return -1;
   }
-
-  if (header)
+  // The values are copied: the workers compare against them without the GIL,
+  // when the caller's dict may already have dropped its strings.
+  Py_ssize_t values_length = 0;
+  for (Py_ssize_t m = 0; m < num_matches; ++m)
   {
-    return_value = PyTuple_Pack(2, header_bstring, data_rows_list);
-    header_bstring = NULL; 
-    data_rows_list = NULL; 
+    values_length += selection->matches[m].length;
   }
-  else
+  selection->values = PyMem_Malloc(values_length + 1);
+  if (!selection->values)
   {
-    return_value = data_rows_list;
-    data_rows_list = NULL; 
+    PyErr_NoMemory();
+    return -1;
   }
-
-cleanup:
-
-  Py_XDECREF(reader_iter);
-  Py_XDECREF(reader_obj);
-  Py_XDECREF(reader_func);
-  Py_XDECREF(csv_module);
-
-  if (file_handle)
+  values_length = 0;
+  for (Py_ssize_t m = 0; m < num_matches; ++m)
   {
-    PyObject_CallMethod(file_handle, "close", NULL);
-    Py_XDECREF(file_handle);
+    BStringCsvMatch *match = &selection->matches[m];
+    memcpy(selection->values + values_length, match->value, match->length);
+    match->value = selection->values + values_length;
+    values_length += match->length;
   }
 
-  Py_XDECREF(builtins);
-  Py_XDECREF(open_func);
-  Py_XDECREF(header_bstring);
-  Py_XDECREF(data_rows_list);
-
-  if (PyErr_Occurred())
+  if (usecols != Py_None)
   {
-    Py_XDECREF(return_value);
-    return NULL;
+    // Columns get slots in file order, since that is the order the parser
+    // keeps them in.
+    Py_ssize_t num_columns = 0;
+    for (Py_ssize_t j = 0; j < selection->num_picks; ++j)
+    {
+      num_columns = selection->header_picks[j] >= num_columns ? selection->header_picks[j] + 1 : num_columns;
+    }
+    for (Py_ssize_t m = 0; m < num_matches; ++m)
+    {
+      num_columns = selection->matches[m].slot >= num_columns ? selection->matches[m].slot + 1 : num_columns;
+    }
+    selection->slots = PyMem_Malloc((num_columns + 1) * sizeof(Py_ssize_t));
+    if (!selection->slots)
+    {
+      PyErr_NoMemory();
+      return -1;
+    }
+    for (Py_ssize_t c = 0; c < num_columns; ++c)
+    {
+      selection->slots[c] = -1;
+    }
+    for (Py_ssize_t j = 0; j < selection->num_picks; ++j)
+    {
+      selection->slots[selection->header_picks[j]] = 0;
+    }
+    for (Py_ssize_t m = 0; m < num_matches; ++m)
+    {
+      selection->slots[selection->matches[m].slot] = 0;
+    }
+    Py_ssize_t num_kept = 0;
+    for (Py_ssize_t c = 0; c < num_columns; ++c)
+    {
+      if (selection->slots[c] == 0)
+        selection->slots[c] = num_kept++;
+    }
+    for (Py_ssize_t j = 0; j < selection->num_picks; ++j)
+    {
+      selection->picks[j] = selection->slots[selection->header_picks[j]];
+    }
+    for (Py_ssize_t m = 0; m < num_matches; ++m)
+    {
+      selection->matches[m].slot = selection->slots[selection->matches[m].slot];
+    }
+    parser->slots = selection->slots;
+    parser->num_columns = num_columns;
+    parser->num_kept = num_kept;
   }
-  return return_value;
+  parser->matches = selection->matches;
+  parser->num_matches = num_matches;
+  return 0;
 }
 
-static PyObject *BString_to_file(BStringObject *self, PyObject *args)
+// Reads a CSV file with the C parser in bstring_csv.c, a block at a time,
+// building the row BStrings straight from the parsed fields. With threads
+// above 1 each block is parsed by that many threads without the GIL; the
+// BStrings are still built on this thread.
+//
+// usecols, skiprows, nrows and where are applied by the parser: dropped
+// fields are not copied and dropped records never become objects, and
+// reading stops once nrows records are kept.
+static PyObject *BString_from_csv(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *filepath;
-  if (!PyArg_ParseTuple(args, "s", &filepath))
+  int header = 1;
+  const char *delimiter = ",";
+  const char *quotechar = "\"";
+  int threads = 1;
+  PyObject *usecols = Py_None;
+  Py_ssize_t skiprows = 0;
+  PyObject *nrows = Py_None;
+  PyObject *where = Py_None;
+  static char *kwlist[] = {"filepath", "header", "delimiter", "quotechar", "threads", "usecols", "skiprows", "nrows", "where", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "s|pssiOnOO:from_csv", kwlist, &filepath, &header, &delimiter, &quotechar, &threads,
+                      &usecols, &skiprows, &nrows, &where))
   {
     return NULL;
   }
-  FILE *file = fopen(filepath, "w");
-  if (!file)
+  Py_ssize_t limit = nrows == Py_None ? -1 : PyLong_AsSsize_t(nrows);
+  if (limit == -1 && PyErr_Occurred())
+    return NULL;
+  if (skiprows < 0 || (nrows != Py_None && limit < 0))
   {
-    PyErr_SetFromErrnoWithFilename(PyExc_IOError, filepath);
+    PyErr_SetString(PyExc_ValueError, "skiprows and nrows must not be negative");
     return NULL;
   }
-  BStringNode *current = self->head;
-  while (current)
+  if (where != Py_None && !PyDict_Check(where))
   {
-    fprintf(file, "%s\n", PyUnicode_AsUTF8(current->str));
-    current = current->next;
+    PyErr_SetString(PyExc_TypeError, "where must be a dict of column: value");
+    return NULL;
   }
-  fclose(file);
-  Py_RETURN_NONE;
+
+  BStringCsvParser parser;
+  BStringCsvReader reader;
+  BStringCsvRows rows;
+  if (BString_csv_parser(&parser, delimiter, quotechar, threads, "from_csv") < 0)
+    return NULL;
+  if (BStringCsvReader_open(&reader, filepath, &parser, threads) < 0)
+    return NULL;
+  if (BStringCsvRows_init(&rows) < 0)
+  {
+    BStringCsvReader_close(&reader);
+    return NULL;
+  }
+
+  BStringCsvSelection selection = {NULL, NULL, NULL, 0, NULL, NULL};
+  PyObject *header_bstring = NULL;
+  PyObject *data_rows_list = PyList_New(0);
+  PyObject *return_value = NULL;
+  int status = data_rows_list ? 0 : -1;
+  if (status == 0 && header)
+  {
+    // The header is read on its own: usecols and where may name its columns.
+    reader.parser.limit = 1;
+    status = BStringCsvReader_read(&reader, &rows) < 0 ? -1 : 0;
+    reader.parser.limit = -1;
+  }
+  if (status == 0)
+    status = BString_csv_select(&selection, &reader.parser, usecols, where, header ? &rows : NULL);
+  if (status == 0 && header && rows.num_rows > 0)
+  {
+    header_bstring = BString_csv_row((PyTypeObject *)type, &rows, 0, selection.header_picks, selection.num_picks);
+    status = header_bstring ? 0 : -1;
+  }
+  BStringCsvRows_reset(&rows);
+  reader.parser.skip = skiprows;
+  reader.parser.limit = limit;
+  while (status == 0 && (status = BStringCsvReader_read(&reader, &rows)) > 0)
+  {
+    status = 0;
+    for (Py_ssize_t r = 0; status == 0 && r < rows.num_rows; ++r)
+    {
+      PyObject *row = BString_csv_row((PyTypeObject *)type, &rows, r, selection.picks, selection.num_picks);
+      status = row ? PyList_Append(data_rows_list, row) : -1;
+      Py_XDECREF(row);
+    }
+    BStringCsvRows_reset(&rows);
+  }
+  BStringCsvRows_free(&rows);
+  BStringCsvReader_close(&reader);
+  BString_csv_selection_free(&selection);
+
+  if (status == 0 && header && !header_bstring)
+  {
+    header_bstring = ((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
+    if (!header_bstring)
+      status = -1;
+  }
+  if (status == 0)
+  {
+    return_value = header ? PyTuple_Pack(2, header_bstring, data_rows_list) : data_rows_list;
+    if (!header)
+      Py_INCREF(data_rows_list);
+  }
+  Py_XDECREF(header_bstring);
+  Py_XDECREF(data_rows_list);
+  return return_value;
 }
 
-static PyObject *BString_from_file(PyObject *type, PyObject *args)
+// Streams a CSV file as (header, [rows]) batches of at most batch_size rows.
+// Only the current block of the file and one batch are in memory at a time.
+static PyObject *BString_iter_csv(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *filepath;
-  if (!PyArg_ParseTuple(args, "s", &filepath))
+  Py_ssize_t batch_size = 10000;
+  int header = 1;
+  const char *delimiter = ",";
+  const char *quotechar = "\"";
+  int threads = 1;
+  static char *kwlist[] = {"filepath", "batch_size", "header", "delimiter", "quotechar", "threads", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "s|npssi:iter_csv", kwlist, &filepath, &batch_size, &header, &delimiter, &quotechar, &threads))
   {
     return NULL;
   }
-  FILE *file = fopen(filepath, "r");
-  if (!file)
+  if (batch_size < 1)
   {
-    PyErr_SetFromErrnoWithFilename(PyExc_IOError, filepath);
+    PyErr_SetString(PyExc_ValueError, "iter_csv() batch_size must be at least 1");
     return NULL;
   }
+  BStringCsvParser parser;
+  if (BString_csv_parser(&parser, delimiter, quotechar, threads, "iter_csv") < 0)
+    return NULL;
 
-  BStringObject *new_bstring = (BStringObject *)((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
-  if (!new_bstring)
+  BStringCsvIterObject *iter = PyObject_New(BStringCsvIterObject, &BStringCsvIter_Type);
+  if (!iter)
+    return NULL;
+  Py_INCREF(type);
+  iter->row_type = (PyTypeObject *)type;
+  iter->batch_size = batch_size;
+  iter->next_row = 0;
+  iter->header = header ? NULL : Py_None;
+  Py_XINCREF(iter->header);
+  iter->done = 1;
+  iter->rows.fields = NULL;
+  iter->rows.row_ends = NULL;
+  iter->filepath = PyMem_Malloc(strlen(filepath) + 1);
+  if (!iter->filepath)
   {
-    fclose(file);
+    PyErr_NoMemory();
+    Py_DECREF(iter);
     return NULL;
   }
-
-  char buffer[4096]; 
-  while (fgets(buffer, sizeof(buffer), file))
+  strcpy(iter->filepath, filepath);
+  if (BStringCsvRows_init(&iter->rows) < 0 || BStringCsvReader_open(&iter->reader, iter->filepath, &parser, threads) < 0)
   {
+    Py_DECREF(iter);
+    return NULL;
+  }
+  iter->done = 0;
+  return (PyObject *)iter;
+}
+
+static void BStringCsvIter_close(BStringCsvIterObject *iter)
+{
+  if (!iter->done)
+    BStringCsvReader_close(&iter->reader);
+  iter->done = 1;
+}
 
-    buffer[strcspn(buffer, "\r\n")] = 0;
+static void BStringCsvIter_dealloc(BStringCsvIterObject *iter)
+{
+  BStringCsvIter_close(iter);
+  BStringCsvRows_free(&iter->rows);
+  PyMem_Free(iter->filepath);
+  Py_XDECREF(iter->header);
+  Py_XDECREF(iter->row_type);
+  PyObject_Del(iter);
+}
 
-    PyObject *line_str = PyUnicode_FromString(buffer);
-    if (!line_str)
+static PyObject *BStringCsvIter_iternext(BStringCsvIterObject *iter)
+{
+  if (iter->done)
+    return NULL;
+  PyObject *batch = PyList_New(0);
+  if (!batch)
+    return NULL;
+  int status = 0;
+  while (status == 0 && PyList_GET_SIZE(batch) < iter->batch_size)
+  {
+    if (iter->next_row == iter->rows.num_rows)
     {
-      Py_DECREF(new_bstring);
-      fclose(file);
-      return NULL;
+      // The records of the last block are used up: parse the next one into
+      // the same buffers.
+      BStringCsvRows_reset(&iter->rows);
+      iter->next_row = 0;
+      status = BStringCsvReader_read(&iter->reader, &iter->rows);
+      if (status <= 0)
+      {
+        BStringCsvIter_close(iter);
+        break;
+      }
+      status = 0;
     }
-
-    BStringNode *new_node = new_BStringNode(line_str);
-    Py_DECREF(line_str); 
-    if (!new_node)
+    PyObject *row = BString_csv_row(iter->row_type, &iter->rows, iter->next_row++, NULL, 0);
+    if (!row)
     {
-      Py_DECREF(new_bstring);
-      fclose(file);
-      return NULL;
+      status = -1;
     }
-    if (new_bstring->tail == NULL)
+    else if (!iter->header)
     {
-      new_bstring->head = new_bstring->tail = new_bstring->current = new_node;
+      iter->header = row;
     }
     else
     {
-      new_bstring->tail->next = new_node;
-      new_node->prev = new_bstring->tail;
-      new_bstring->tail = new_node;
+      status = PyList_Append(batch, row);
+      Py_DECREF(row);
     }
-    new_bstring->size++;
   }
-  fclose(file);
-  return (PyObject *)new_bstring;
+  PyObject *result = NULL;
+  if (status == 0 && PyList_GET_SIZE(batch) > 0)
+    result = PyTuple_Pack(2, iter->header, batch);
+  Py_DECREF(batch);
+  return result;
 }
 
-static PyObject *BString_transform_chars(BStringObject *self, PyObject *args, PyObject *kwds)
+PyTypeObject BStringCsvIter_Type =
 {
-  const char *characters;
-  const char *mode = "remove";
-  int inplace = 0; 
-  static char *kwlist[] = {"characters", "mode", "inplace", NULL};
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "BStringCsvIter",
+    .tp_basicsize = sizeof(BStringCsvIterObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)BStringCsvIter_dealloc,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)BStringCsvIter_iternext,
+};
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|sp", kwlist, &characters, &mode, &inplace))
+PyObject *BString_to_file_walk(BStringWalk *walk, const char *filepath)
+{
+  FILE *file = fopen(filepath, "w");
+  if (!file)
   {
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, filepath);
     return NULL;
   }
+  PyObject *item;
+  while ((item = BString_walk_next(walk)))
+  {
+    fprintf(file, "%s\n", PyUnicode_AsUTF8(item));
+  }
+  fclose(file);
+  Py_RETURN_NONE;
+}
 
-  int is_remove_mode = (strcmp(mode, "remove") == 0);
-  if (!is_remove_mode && strcmp(mode, "keep") != 0)
+static PyObject *BString_to_file_arena(BStringArena *arena, const char *filepath)
+{
+  FILE *file = fopen(filepath, "w");
+  if (!file)
   {
-    PyErr_SetString(PyExc_ValueError, "mode must be either 'remove' or 'keep'");
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, filepath);
     return NULL;
   }
+  for (Py_ssize_t i = 0; i < arena->count; ++i)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringArena_bytes(arena, i, &length);
+    fwrite(bytes, 1, length, file);
+    fputc('\n', file);
+  }
+  fclose(file);
+  Py_RETURN_NONE;
+}
 
-  PyObject *char_set = PySet_New(PyUnicode_FromString(characters));
-  if (!char_set)
+static PyObject *BString_to_file(BStringObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+  const char *filepath;
+  static char *kwlist[] = {"filepath", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "s:to_file", kwlist, &filepath))
+  {
     return NULL;
-  BStringObject *target_bstring = self;
-  BStringObject *result_bstring = NULL;
-  BStringNode *target_node = NULL;
+  }
 
-  if (!inplace)
+  if (self->arena)
+    return BString_to_file_arena(self->arena, filepath);
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  return BString_to_file_walk(&walk, filepath);
+}
+
+// Reads a text file with the CSV reader in line mode: \n, \r\n and \r all end
+// a line. Lines are appended a block at a time, and with compact=True an
+// ASCII block goes into the arena in one copy. threads works as in
+// from_csv().
+static PyObject *BString_from_file(PyObject *type, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  const char *filepath;
+  int compact = 0;
+  int threads = 1;
+  static char *kwlist[] = {"filepath", "compact", "threads", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "s|pi:from_file", kwlist, &filepath, &compact, &threads))
   {
-    result_bstring = (BStringObject *)BString_new(&BStringType, NULL, NULL);
-    if (!result_bstring)
-    {
-      Py_DECREF(char_set);
-      return NULL;
-    }
-    target_bstring = result_bstring;
+    return NULL;
   }
+  if (BString_check_threads(threads, "from_file") < 0)
+    return NULL;
 
-  BStringNode *source_node = self->head;
-  while (source_node)
+  BStringCsvParser parser;
+  BStringCsvReader reader;
+  BStringCsvRows rows;
+  BStringCsvParser_init_lines(&parser);
+  if (BStringCsvReader_open(&reader, filepath, &parser, threads) < 0)
+    return NULL;
+  if (BStringCsvRows_init(&rows) < 0)
   {
-    PyObject *source_str = source_node->str;
-    PyObject *parts_list = PyList_New(0); 
-    if (!parts_list)
-    {
-      Py_DECREF(char_set);
-      Py_XDECREF(result_bstring);
-      return NULL;
-    }
-    Py_ssize_t len = PyUnicode_GET_LENGTH(source_str);
-    for (Py_ssize_t i = 0; i < len; ++i)
-    {
+    BStringCsvReader_close(&reader);
+    return NULL;
+  }
 
-      PyObject *single_char = PyUnicode_FromOrdinal(PyUnicode_READ_CHAR(source_str, i));
-      if (!single_char)
-      { /* handle error */
-      }
-      int contains = PySet_Contains(char_set, single_char);
-      int keep_char = (is_remove_mode && !contains) || (!is_remove_mode && contains);
-      if (keep_char)
-      {
-        PyList_Append(parts_list, single_char);
-      }
-      Py_DECREF(single_char);
-    }
-    PyObject *empty_str = PyUnicode_FromString("");
-    PyObject *transformed_str = PyUnicode_Join(empty_str, parts_list);
-    Py_DECREF(empty_str);
-    Py_DECREF(parts_list);
-    if (!transformed_str)
-    { /* handle error */
-    }
-    if (inplace)
+  BStringObject *new_bstring = (BStringObject *)((PyTypeObject *)type)->tp_new((PyTypeObject *)type, NULL, NULL);
+  int status = new_bstring ? 0 : -1;
+  if (status == 0 && compact)
+    status = BString_compact_storage(new_bstring);
+  while (status == 0 && (status = BStringCsvReader_read(&reader, &rows)) > 0)
+  {
+    BStringArena *lines = rows.fields;
+    status = 0;
+    if (compact && BStringSearch_is_ascii(lines->data, lines->used))
     {
-      Py_DECREF(source_node->str);        
-      source_node->str = transformed_str; 
+      status = BStringArena_extend(new_bstring->arena, lines);
+      new_bstring->size += status == 0 ? lines->count : 0;
     }
     else
     {
-
-      BString_append((BStringObject *)target_bstring, transformed_str);
-      Py_DECREF(transformed_str);
+      for (Py_ssize_t i = 0; status == 0 && i < lines->count; ++i)
+      {
+        if (compact)
+        {
+          Py_ssize_t length;
+          const char *bytes = BStringArena_bytes(lines, i, &length);
+          status = BStringArena_append_utf8(new_bstring->arena, bytes, length);
+          new_bstring->size += status == 0;
+          continue;
+        }
+        PyObject *line = BStringArena_item(lines, i);
+        status = line ? BString_push(new_bstring, line) : -1;
+        Py_XDECREF(line);
+      }
     }
-    source_node = source_node->next;
-  }
-  Py_DECREF(char_set);
-  if (inplace)
-  {
-    Py_RETURN_NONE;
+    BStringCsvRows_reset(&rows);
   }
-  else
+  BStringCsvRows_free(&rows);
+  BStringCsvReader_close(&reader);
+  if (status != 0)
   {
-    return (PyObject *)result_bstring;
+    Py_XDECREF(new_bstring);
+    return NULL;
   }
+  if (compact)
+    BStringArena_trim(new_bstring->arena);
+  return (PyObject *)new_bstring;
 }
 
-static PyObject *BString_remove_node(BStringObject *self, BStringNode *node_to_remove)
+// Removes or keeps the given characters in every string with the
+// transform_chars() kernel. Compact storage is transformed as UTF-8 bytes and
+// stays compact; inplace then swaps in the new arena. Otherwise inplace only
+// replaces the strings that changed.
+static PyObject *BString_transform_chars(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
-  if (!node_to_remove)
-    return NULL; 
-  BStringNode *node_before = node_to_remove->prev;
-  BStringNode *node_after = node_to_remove->next;
+  const char *characters;
+  const char *mode = "remove";
+  int inplace = 0; 
+  static char *kwlist[] = {"characters", "mode", "inplace", NULL};
 
-  if (node_before)
+  if (!FastArgs_Parse(args, nargs, kwnames, "s|sp:transform_chars", kwlist, &characters, &mode, &inplace))
   {
-    node_before->next = node_after;
+    return NULL;
   }
-  else
+
+  int is_remove_mode = (strcmp(mode, "remove") == 0);
+  if (!is_remove_mode && strcmp(mode, "keep") != 0)
   {
+    PyErr_SetString(PyExc_ValueError, "mode must be either 'remove' or 'keep'");
+    return NULL;
+  }
 
-    self->head = node_after;
+  PyObject *char_str = PyUnicode_FromString(characters);
+  if (!char_str)
+    return NULL;
+  BStringKernel kernel;
+  int status = BStringKernel_init_chars(&kernel, char_str, is_remove_mode);
+  Py_DECREF(char_str);
+  if (status < 0)
+    return NULL;
+  BStringObject *result_bstring = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (!result_bstring)
+  {
+    BStringKernel_clear(&kernel);
+    return NULL;
   }
-  if (node_after)
+
+  if (self->arena)
   {
-    node_after->prev = node_before;
+    BStringArena *arena = self->arena;
+    status = BString_compact_storage(result_bstring);
+    for (Py_ssize_t i = 0; status == 0 && i < arena->count; ++i)
+    {
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(arena, i, &length);
+      status = BStringKernel_apply_utf8(&kernel, bytes, length, result_bstring->arena);
+      result_bstring->size += status == 0;
+    }
+    if (status == 0)
+      BStringArena_trim(result_bstring->arena);
+    if (status == 0 && inplace)
+    {
+      // result_bstring takes the old arena and releases it.
+      self->arena = result_bstring->arena;
+      result_bstring->arena = arena;
+      self->mod_count++;
+      BString_drop_index(self);
+    }
   }
   else
   {
-
-    self->tail = node_before;
+    BStringWalk walk;
+    BString_walk_init(&walk, self, 0);
+    PyObject *source_str;
+    Py_ssize_t position = 0;
+    while (status == 0 && (source_str = BString_walk_next(&walk)))
+    {
+      PyObject *transformed_str = BStringKernel_apply(&kernel, source_str);
+      if (!transformed_str)
+      {
+        status = -1;
+        break;
+      }
+      if (!inplace)
+        status = BString_push(result_bstring, transformed_str);
+      else if (transformed_str != source_str)
+        status = BString_replace_at(self, position, transformed_str);
+      Py_DECREF(transformed_str);
+      position++;
+    }
   }
-
-  if (self->current == node_to_remove)
+  BStringKernel_clear(&kernel);
+  if (status != 0 || inplace)
   {
-    self->current = self->head;
+    Py_DECREF(result_bstring);
+    if (status != 0)
+      return NULL;
+    Py_RETURN_NONE;
   }
-  self->size--;
-  PyObject *returned_str = node_to_remove->str; 
-  PyMem_Free(node_to_remove);                   
-  return returned_str; 
+  return (PyObject *)result_bstring;
 }
 
 static PyObject *BString_append(BStringObject *self, PyObject *obj)
@@ -720,28 +1793,17 @@ static PyObject *BString_append(BStringObject *self, PyObject *obj)
     PyErr_SetString(PyExc_TypeError, "can only append a string");
     return NULL;
   }
-  BStringNode *new_node = new_BStringNode(obj);
-  if (!new_node)
+  if (BString_push(self, obj) != 0)
     return NULL;
-  if (self->tail == NULL)
-  { 
-    self->head = self->tail = self->current = new_node;
-  }
-  else
-  {
-    self->tail->next = new_node;
-    new_node->prev = self->tail;
-    self->tail = new_node;
-  }
-  self->size++;
   Py_RETURN_NONE;
 }
 
-static PyObject *BString_insert(BStringObject *self, PyObject *args)
+static PyObject *BString_insert(BStringObject *self, PyObject *const *args, Py_ssize_t nargs)
 {
   Py_ssize_t index;
   PyObject *obj;
-  if (!PyArg_ParseTuple(args, "nO", &index, &obj))
+  static char *kwlist[] = {"index", "value", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "nO:insert", kwlist, &index, &obj))
   {
     return NULL;
   }
@@ -751,10 +1813,6 @@ static PyObject *BString_insert(BStringObject *self, PyObject *args)
     return NULL;
   }
 
-  if (index >= self->size)
-  {
-    return BString_append(self, obj);
-  }
   if (index < 0)
   {
     index += self->size;
@@ -762,36 +1820,16 @@ static PyObject *BString_insert(BStringObject *self, PyObject *args)
       index = 0;
   }
 
-  BStringNode *node_at_index = self->head;
-  for (Py_ssize_t i = 0; i < index; ++i)
-  {
-    node_at_index = node_at_index->next;
-  }
-  BStringNode *new_node = new_BStringNode(obj);
-  if (!new_node)
+  if (BString_insert_at(self, index, obj) != 0)
     return NULL;
-  BStringNode *node_before = node_at_index->prev;
-
-  new_node->next = node_at_index;
-  new_node->prev = node_before;
-  node_at_index->prev = new_node;
-  if (node_before)
-  {
-    node_before->next = new_node;
-  }
-  else
-  {
-
-    self->head = new_node;
-  }
-  self->size++;
   Py_RETURN_NONE;
 }
 
-static PyObject *BString_pop(BStringObject *self, PyObject *args)
+static PyObject *BString_pop(BStringObject *self, PyObject *const *args, Py_ssize_t nargs)
 {
   Py_ssize_t index = -1;
-  if (!PyArg_ParseTuple(args, "|n", &index))
+  static char *kwlist[] = {"index", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "|n:pop", kwlist, &index))
   {
     return NULL;
   }
@@ -812,12 +1850,7 @@ static PyObject *BString_pop(BStringObject *self, PyObject *args)
     return NULL;
   }
 
-  BStringNode *node_to_pop = self->head;
-  for (Py_ssize_t i = 0; i < index; ++i)
-  {
-    node_to_pop = node_to_pop->next;
-  }
-  return BString_remove_node(self, node_to_pop);
+  return BString_take_at(self, index);
 }
 
 static PyObject *BString_remove(BStringObject *self, PyObject *value)
@@ -827,167 +1860,500 @@ static PyObject *BString_remove(BStringObject *self, PyObject *value)
     PyErr_SetString(PyExc_TypeError, "argument must be a string");
     return NULL;
   }
-  BStringNode *current = self->head;
-  while (current)
+  Py_ssize_t index;
+  int found = BString_find_item(self, value, 0, self->size, &index);
+  if (found < 0)
+    return NULL;
+  if (found == 0)
   {
-    int cmp_res = PyObject_RichCompareBool(current->str, value, Py_EQ);
-    if (cmp_res > 0)
-    { 
-      PyObject *removed_str = BString_remove_node(self, current);
-      Py_DECREF(removed_str); 
-      Py_RETURN_NONE;
-    }
-    if (cmp_res < 0)
-    { 
-      return NULL;
-    }
-    current = current->next;
+    PyErr_SetString(PyExc_ValueError, "BString.remove(x): x not in BString");
+    return NULL;
   }
-  PyErr_SetString(PyExc_ValueError, "BString.remove(x): x not in BString");
-  return NULL;
+  PyObject *removed_str = BString_take_at(self, index);
+  if (!removed_str)
+    return NULL;
+  Py_DECREF(removed_str);
+  Py_RETURN_NONE;
 }
 
 static PyMethodDef BString_methods[] =
 {
-    {"map", (PyCFunction)BString_map, METH_VARARGS, "Apply a string method to all elements..."},
-    {"filter", (PyCFunction)BString_filter, METH_VARARGS, "Filter elements using a string method..."},
+    {"map", (PyCFunction)BString_map, METH_FASTCALL | METH_KEYWORDS, "Apply a string method to all elements: map(method, *args, threads=1). With threads > 1 the built-in kernels (strip, lower, replace, ...) run in parallel without the GIL."},
+    {"filter_expr", (PyCFunction)BString_filter_expr, METH_FASTCALL | METH_KEYWORDS, "Keep the strings matching a filter expression, e.g. filter_expr(\"startswith('ERR') and len > 20 and not contains('debug')\"). The expression may be a precompiled BStringExpr."},
+    {"filter", (PyCFunction)BString_filter, METH_FASTCALL | METH_KEYWORDS, "Filter elements using a string method or a callable: filter(condition, *args, threads=1). With threads > 1 the built-in predicates (startswith, isdigit, ...) run in parallel without the GIL."},
     {"extend", (PyCFunction)BString_extend, METH_O, "Extend with items from a sequence."},
     {"append", (PyCFunction)BString_append, METH_O, "Append string to the end of the BString."},
-    {"insert", (PyCFunction)BString_insert, METH_VARARGS, "Insert string before index."},
-    {"pop", (PyCFunction)BString_pop, METH_VARARGS, "Remove and return string at index (default last)."},
+    {"insert", (PyCFunction)BString_insert, METH_FASTCALL, "Insert string before index."},
+    {"pop", (PyCFunction)BString_pop, METH_FASTCALL, "Remove and return string at index (default last)."},
     {"remove", (PyCFunction)BString_remove, METH_O, "Remove first occurrence of a string."},
-    {"transform_chars", (PyCFunction)BString_transform_chars, METH_VARARGS | METH_KEYWORDS, "Remove or keep a selected set of characters in each string."},
-    {"to_file", (PyCFunction)BString_to_file, METH_VARARGS, "Save the BString contents to a file, one string per line."},
-    {"from_file", (PyCFunction)BString_from_file, METH_VARARGS | METH_CLASS, "Create a new BString from a line-delimited text file."},
-    {"from_csv", (PyCFunction)BString_from_csv, METH_VARARGS | METH_KEYWORDS | METH_CLASS, "Create BString rows from a CSV file."},
+    {"index", (PyCFunction)BString_index, METH_FASTCALL, "Return the position of the first occurrence of a string, optionally within index(value, start, stop)."},
+    {"count", (PyCFunction)BString_count, METH_O, "Return the number of occurrences of a string."},
+    {"transform_chars", (PyCFunction)BString_transform_chars, METH_FASTCALL | METH_KEYWORDS, "Remove or keep a selected set of characters in each string."},
+    {"to_file", (PyCFunction)BString_to_file, METH_FASTCALL, "Save the BString contents to a file, one string per line."},
+    {"from_list", (PyCFunction)BString_from_list, METH_O | METH_CLASS, "Create a new BString from a list, tuple or other sequence of strings in one bulk copy."},
+    {"from_iterable", (PyCFunction)BString_from_iterable, METH_O | METH_CLASS, "Create a new BString from any iterable of strings, preallocating from its length hint."},
+    {"from_file", (PyCFunction)BString_from_file, METH_FASTCALL | METH_KEYWORDS | METH_CLASS, "Create a new BString from a line-delimited text file. Pass compact=True to load it into compact UTF-8 storage and threads=N to split the file between N threads."},
+    {"from_csv", (PyCFunction)BString_from_csv, METH_FASTCALL | METH_KEYWORDS | METH_CLASS, "Create BString rows from a CSV file: from_csv(filepath, header=True, delimiter=',', quotechar='\"', threads=1, usecols=None, skiprows=0, nrows=None, where=None). usecols picks columns by index or header name, skiprows drops the first data rows, where={column: value} keeps the rows whose fields equal the values and nrows limits the rows returned."},
+    {"iter_csv", (PyCFunction)BString_iter_csv, METH_FASTCALL | METH_KEYWORDS | METH_CLASS, "Iterate over a CSV file in (header, [rows]) batches of at most batch_size rows: iter_csv(filepath, batch_size=10000, header=True, delimiter=',', quotechar='\"', threads=1). The header is None when header=False."},
     {"to_csv", (PyCFunction)BString_to_csv, METH_VARARGS | METH_KEYWORDS | METH_CLASS, "Save a list of BString rows to a CSV file."},
     {"move_next", (PyCFunction)BString_move_next, METH_NOARGS, "Move cursor to the next item. Returns False if at the end."},
     {"move_prev", (PyCFunction)BString_move_prev, METH_NOARGS, "Move cursor to the previous item. Returns False if at the beginning."},
     {"move_to_head", (PyCFunction)BString_move_to_head, METH_NOARGS, "Reset the cursor to the first item."},
     {"move_to_tail", (PyCFunction)BString_move_to_tail, METH_NOARGS, "Move the cursor to the last item."},
     {"join", (PyCFunction)BString_join, METH_O, "Join elements into a single string with a separator."},
-    {"split", (PyCFunction)BString_split, METH_VARARGS | METH_KEYWORDS | METH_CLASS, "Create a BString by splitting a string."},
-    {"contains", (PyCFunction)BString_contains, METH_VARARGS | METH_KEYWORDS, "Check if any string in the BString contains a substring."},
-    {"unique", (PyCFunction)BString_unique, METH_NOARGS, "Return a new BString with duplicate strings removed."},
+    {"split", (PyCFunction)BString_split, METH_FASTCALL | METH_KEYWORDS | METH_CLASS, "Create a BString by splitting a string: split(string, delimiter=None, maxsplit=-1, keep_empty=True)."},
+    {"contains", (PyCFunction)BString_contains, METH_FASTCALL | METH_KEYWORDS, "Check if any string in the BString contains a substring."},
+    {"find_any", (PyCFunction)BString_find_any, METH_FASTCALL | METH_KEYWORDS, "Find many patterns in one pass: find_any(patterns, case_sensitive=True, positions=False). Returns the indices of the matching strings, or (index, pattern, offset) tuples for every occurrence when positions is true. patterns may be a precompiled BStringPatterns."},
+    {"find_all", (PyCFunction)BString_find_all, METH_FASTCALL | METH_KEYWORDS, "Indices of the strings containing a substring, as an array('q'): find_all(substring, case_sensitive=True, invert=False)."},
+    {"grep", (PyCFunction)BString_grep, METH_FASTCALL | METH_KEYWORDS, "New BString of the strings containing a substring: grep(substring, case_sensitive=True, invert=False)."},
+    {"unique", (PyCFunction)BString_unique, METH_FASTCALL | METH_KEYWORDS, "Remove duplicate strings, keeping the first or last occurrence: unique(keep='first', inplace=False)."},
+    {"compact", (PyCFunction)BString_compact, METH_NOARGS, "Move the strings into compact UTF-8 storage; string objects are then created on access."},
+    {"expand", (PyCFunction)BString_expand, METH_NOARGS, "Move compact storage back to one string object per element."},
+    {"enable_index", (PyCFunction)BString_enable_index, METH_NOARGS, "Keep a hash index of the strings so that 'in', index(), count() and remove() avoid scanning. The index is built on the first lookup."},
+    {"disable_index", (PyCFunction)BString_disable_index, METH_NOARGS, "Drop the hash index and go back to scanning on lookups."},
+    {"view", (PyCFunction)BString_view, METH_FASTCALL | METH_KEYWORDS, "Return a zero-copy view of view(start, stop, step) that shares this BString's storage."},
     {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
 
-static PyObject *BString_map(BStringObject *self, PyObject *args)
+// Reads the threads= keyword, the only one map() and filter() take.
+static int BString_parse_threads(PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames, const char *fname, int *threads)
+{
+  *threads = 1;
+  Py_ssize_t num_kwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+  for (Py_ssize_t i = 0; i < num_kwargs; ++i)
+  {
+    PyObject *key = PyTuple_GET_ITEM(kwnames, i);
+    if (PyUnicode_CompareWithASCIIString(key, "threads") != 0)
+    {
+      PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'", fname, key);
+      return -1;
+    }
+    long value = PyLong_AsLong(args[nargs + i]);
+    if (value == -1 && PyErr_Occurred())
+      return -1;
+    if (BString_check_threads(value < 1 || value > 1024 ? 0 : (int)value, fname) < 0)
+      return -1;
+    *threads = (int)value;
+  }
+  return 0;
+}
+
+// The str for a worker's result on an ASCII item: the item itself when the
+// kernel left it unchanged.
+static PyObject *BString_kernel_result(PyObject *item, const char *bytes, Py_ssize_t length)
+{
+  if (length == PyUnicode_GET_LENGTH(item) && memcmp(bytes, PyUnicode_DATA(item), length) == 0)
+  {
+    Py_INCREF(item);
+    return item;
+  }
+  if (!BStringSearch_is_ascii(bytes, length))
+    return PyUnicode_DecodeUTF8(bytes, length, "strict");
+  PyObject *result = PyUnicode_New(length, 127);
+  if (result)
+    memcpy(PyUnicode_DATA(result), bytes, length);
+  return result;
+}
+
+// Appends the result for item i of a finished part to result.
+static int BString_finish_item(BStringObject *result, BStringKernelPart *part, Py_ssize_t i, int filter)
+{
+  BStringKernel *kernel = part->kernel;
+  unsigned char mark = part->marks[i - part->start];
+  Py_ssize_t length;
+  const char *bytes = part->source ? BStringArena_bytes(part->source, i, &length) : NULL;
+  if (filter)
+  {
+    int keep = mark;
+    if (keep == BSTRING_KERNEL_UNDECIDED)
+      keep = bytes ? BStringKernel_test_utf8(kernel, bytes, length) : BStringKernel_test(kernel, part->items[i]);
+    if (keep <= 0)
+      return keep;
+    if (!bytes)
+      return BString_push(result, part->items[i]);
+    if (BStringArena_append(result->arena, bytes, length) < 0)
+      return -1;
+    result->size++;
+    return 0;
+  }
+
+  if (bytes)
+  {
+    int status;
+    if (mark)
+    {
+      status = BStringKernel_apply_utf8(kernel, bytes, length, result->arena);
+    }
+    else
+    {
+      const char *mapped = BStringArena_bytes(part->out, i - part->start, &length);
+      status = BStringArena_append(result->arena, mapped, length);
+    }
+    result->size += status == 0;
+    return status;
+  }
+  PyObject *value;
+  if (mark)
+  {
+    value = BStringKernel_apply(kernel, part->items[i]);
+  }
+  else
+  {
+    const char *mapped = BStringArena_bytes(part->out, i - part->start, &length);
+    value = BString_kernel_result(part->items[i], mapped, length);
+  }
+  if (!value)
+    return -1;
+  int status = BString_push(result, value);
+  Py_DECREF(value);
+  return status;
+}
+
+// Runs a map() (filter == 0) or filter() kernel over the items on up to
+// threads threads. Workers read a snapshot, so other Python threads may change
+// self meanwhile: chunks are shared copy-on-write and a compact arena is held
+// by reference, which makes self copy it before appending. The items the
+// workers leave marked are finished here with the GIL. The result keeps the
+// storage mode of self.
+static PyObject *BString_run_kernel(BStringObject *self, BStringKernel *kernel, int filter, int threads)
+{
+  Py_ssize_t count = self->size;
+  Py_ssize_t num_parts = BStringThreads_parts(count, threads);
+  BStringArena *source = self->arena;
+  BStringObject *snapshot = NULL;
+  PyObject **items = NULL;
+  BStringObject *result = NULL;
+  int status = -1;
+  BStringKernelPart *parts = PyMem_Calloc(num_parts, sizeof(BStringKernelPart));
+  unsigned char *marks = PyMem_Malloc(count > 0 ? count : 1);
+  if (source)
+    source->refs++;
+  if (!parts || !marks)
+  {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  if (!source)
+  {
+    snapshot = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+    if (!snapshot || BString_push_shared(snapshot, self) < 0)
+      goto done;
+    items = PyMem_Malloc(count > 0 ? count * sizeof(PyObject *) : 1);
+    if (!items)
+    {
+      PyErr_NoMemory();
+      goto done;
+    }
+    BStringWalk walk;
+    BString_walk_init(&walk, snapshot, 0);
+    for (Py_ssize_t i = 0; i < count; ++i)
+    {
+      items[i] = BString_walk_next(&walk);
+    }
+  }
+  for (Py_ssize_t p = 0; p < num_parts; ++p)
+  {
+    BStringKernelPart *part = &parts[p];
+    part->kernel = kernel;
+    part->source = source;
+    part->items = items;
+    part->start = count * p / num_parts;
+    part->stop = count * (p + 1) / num_parts;
+    part->marks = marks + part->start;
+    if (!filter)
+    {
+      part->out = BStringArena_new();
+      if (!part->out)
+        goto done;
+      part->out->worker = 1;
+    }
+  }
+
+  BStringThreads_run(filter ? BStringKernel_filter_part : BStringKernel_map_part, parts, num_parts);
+  for (Py_ssize_t p = 0; p < num_parts; ++p)
+  {
+    if (parts[p].failed)
+    {
+      PyErr_NoMemory();
+      goto done;
+    }
+  }
+
+  result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (!result || (source && BString_compact_storage(result) < 0))
+    goto done;
+  status = 0;
+  for (Py_ssize_t p = 0; status == 0 && p < num_parts; ++p)
+  {
+    BStringKernelPart *part = &parts[p];
+    Py_ssize_t length = part->stop - part->start;
+    if (source && !filter && !memchr(part->marks, 1, length))
+    {
+      // Every item of the part is done: take its results in one go.
+      status = BStringArena_extend(result->arena, part->out);
+      result->size += status == 0 ? length : 0;
+      continue;
+    }
+    for (Py_ssize_t i = part->start; status == 0 && i < part->stop; ++i)
+    {
+      status = BString_finish_item(result, part, i, filter);
+    }
+  }
+  if (status == 0 && source)
+    BStringArena_trim(result->arena);
+
+done:
+  if (parts)
+  {
+    for (Py_ssize_t p = 0; p < num_parts; ++p)
+    {
+      BStringArena_free(parts[p].out);
+    }
+  }
+  PyMem_Free(parts);
+  PyMem_Free(marks);
+  PyMem_Free(items);
+  Py_XDECREF(snapshot);
+  BStringArena_free(source);
+  if (status != 0)
+  {
+    Py_XDECREF(result);
+    return NULL;
+  }
+  return (PyObject *)result;
+}
+
+static PyObject *BString_map(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   PyObject *method_name_obj;
-  PyObject *method_args_tuple = NULL;
-  Py_ssize_t num_args = PyTuple_Size(args);
-  if (num_args < 1)
+  int threads;
+  if (BString_parse_threads(args, nargs, kwnames, "map", &threads) < 0)
+    return NULL;
+  if (nargs < 1)
   {
     PyErr_SetString(PyExc_TypeError, "map() requires at least one argument (the method name)");
     return NULL;
   }
 
-  method_name_obj = PyTuple_GET_ITEM(args, 0);
+  method_name_obj = args[0];
   if (!PyUnicode_Check(method_name_obj))
   {
     PyErr_SetString(PyExc_TypeError, "first argument to map() must be a string method name");
     return NULL;
   }
 
-  method_args_tuple = PyTuple_New(num_args - 1);
-  if (!method_args_tuple)
+  // Call arguments for PyObject_VectorcallMethod(): the item, then the
+  // extra map() arguments. Avoids a bound method object per item.
+  PyObject **call_args = PyMem_Malloc(nargs * sizeof(PyObject *));
+  if (!call_args)
   {
-    return NULL; 
+    return PyErr_NoMemory(); 
   }
-  for (Py_ssize_t i = 1; i < num_args; ++i)
+  for (Py_ssize_t i = 1; i < nargs; ++i)
   {
-    PyObject *item = PyTuple_GET_ITEM(args, i);
-    Py_INCREF(item); 
-    PyTuple_SET_ITEM(method_args_tuple, i - 1, item);
+    call_args[i] = args[i];
   }
 
-  BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
-  if (!result)
+  // The common str methods run in C without calling the method at all.
+  BStringKernel kernel;
+  int native = BStringKernel_init(&kernel, method_name_obj, args + 1, nargs - 1);
+  if (native > 0 && threads > 1)
+  {
+    PyMem_Free(call_args);
+    PyObject *mapped = BString_run_kernel(self, &kernel, 0, threads);
+    BStringKernel_clear(&kernel);
+    return mapped;
+  }
+  BStringObject *result = native < 0 ? NULL : (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (result && native && self->arena)
+  {
+    // Compact storage maps to compact storage, byte kernel permitting.
+    BStringArena *arena = self->arena;
+    int status = BString_compact_storage(result);
+    for (Py_ssize_t i = 0; status == 0 && i < arena->count; ++i)
+    {
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(arena, i, &length);
+      status = BStringKernel_apply_utf8(&kernel, bytes, length, result->arena);
+      result->size += status == 0;
+    }
+    BStringKernel_clear(&kernel);
+    PyMem_Free(call_args);
+    if (status != 0)
+    {
+      Py_DECREF(result);
+      return NULL;
+    }
+    BStringArena_trim(result->arena);
+    return (PyObject *)result;
+  }
+  if (!result || BString_expand_arena(self) < 0)
   {
-    Py_DECREF(method_args_tuple);
+    Py_XDECREF(result);
+    BStringKernel_clear(&kernel);
+    PyMem_Free(call_args);
     return NULL;
   }
-  BStringNode *current = self->head;
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  PyObject *item;
   int error_occurred = 0;
-  while (current)
+  while ((item = BString_walk_next(&walk)))
   {
-
-    PyObject *method = PyObject_GetAttr(current->str, method_name_obj);
-    if (!method)
+    PyObject *call_result;
+    if (native)
     {
-      error_occurred = 1;
-      break; 
+      call_result = BStringKernel_apply(&kernel, item);
+    }
+    else
+    {
+      call_args[0] = item;
+      call_result = PyObject_VectorcallMethod(method_name_obj, call_args, nargs, NULL);
     }
-
-    PyObject *call_result = PyObject_CallObject(method, method_args_tuple);
-    Py_DECREF(method); 
     if (!call_result)
     {
       error_occurred = 1;
       break; 
     }
 
-    BStringNode *new_node = new_BStringNode(call_result);
+    int status = BString_push(result, call_result);
     Py_DECREF(call_result); 
-    if (!new_node)
+    if (status != 0)
     {
       error_occurred = 1;
       break; 
     }
-    if (!result->head)
+  }
+  BStringKernel_clear(&kernel);
+  PyMem_Free(call_args);
+  if (error_occurred)
+  {
+    Py_DECREF(result); 
+    return NULL;
+  }
+  return (PyObject *)result;
+}
+
+// Keeps the strings matching a filter expression, given as a string or a
+// precompiled BStringExpr. The result keeps the storage mode of self.
+static PyObject *BString_filter_expr(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  PyObject *expression;
+  static char *kwlist[] = {"expression", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "O:filter_expr", kwlist, &expression))
+  {
+    return NULL;
+  }
+
+  BStringExprObject *compiled;
+  if (PyObject_TypeCheck(expression, &BStringExpr_Type))
+  {
+    Py_INCREF(expression);
+    compiled = (BStringExprObject *)expression;
+  }
+  else
+  {
+    compiled = (BStringExprObject *)BStringExpr_compile(expression);
+    if (!compiled)
+      return NULL;
+  }
+
+  BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  int status = result ? 0 : -1;
+  if (status == 0 && self->arena)
+  {
+    BStringArena *arena = self->arena;
+    status = BString_compact_storage(result);
+    for (Py_ssize_t i = 0; status == 0 && i < arena->count; ++i)
     {
-      result->head = result->tail = result->current = new_node;
+      Py_ssize_t length;
+      const char *bytes = BStringArena_bytes(arena, i, &length);
+      int match = BStringExpr_match_utf8(compiled, bytes, length);
+      if (match > 0)
+      {
+        status = BStringArena_append(result->arena, bytes, length);
+        result->size += status == 0;
+      }
+      else if (match < 0)
+      {
+        status = -1;
+      }
     }
-    else
+    if (status == 0)
+      BStringArena_trim(result->arena);
+  }
+  else if (status == 0)
+  {
+    BStringWalk walk;
+    BString_walk_init(&walk, self, 0);
+    PyObject *item;
+    while (status == 0 && (item = BString_walk_next(&walk)))
     {
-      result->tail->next = new_node;
-      new_node->prev = result->tail;
-      result->tail = new_node;
+      int match = BStringExpr_match(compiled, item);
+      status = match > 0 ? BString_push(result, item) : match;
     }
-    result->size++;
-    current = current->next;
   }
-  Py_DECREF(method_args_tuple);
-  if (error_occurred)
+  Py_DECREF(compiled);
+  if (status != 0)
   {
-    Py_DECREF(result); 
+    Py_XDECREF(result);
     return NULL;
   }
   return (PyObject *)result;
 }
 
-static PyObject *BString_filter(BStringObject *self, PyObject *args)
+static PyObject *BString_filter(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   PyObject *filter_condition;
-  Py_ssize_t num_args = PyTuple_Size(args);
-  if (num_args < 1)
+  int threads;
+  if (BString_parse_threads(args, nargs, kwnames, "filter", &threads) < 0)
+    return NULL;
+  if (nargs < 1)
   {
     PyErr_SetString(PyExc_TypeError, "filter() requires at least one argument (a method name or a callable)");
     return NULL;
   }
 
-  filter_condition = PyTuple_GET_ITEM(args, 0);
+  filter_condition = args[0];
+  if (PyUnicode_Check(filter_condition))
+  {
+    // Predicates like startswith() and isdigit() are decided in C.
+    BStringKernel kernel;
+    int native = BStringKernel_init_test(&kernel, filter_condition, args + 1, nargs - 1);
+    if (native < 0)
+      return NULL;
+    if (native)
+    {
+      PyObject *filtered = BString_run_kernel(self, &kernel, 1, threads);
+      BStringKernel_clear(&kernel);
+      return filtered;
+    }
+  }
+  if (BString_expand_arena(self) < 0)
+    return NULL;
 
   BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
   if (!result)
     return NULL;
-  BStringNode *current = self->head;
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  PyObject *item;
   int error_occurred = 0;
 
   if (PyCallable_Check(filter_condition))
   {
-    if (num_args > 1)
+    if (nargs > 1)
     {
       PyErr_SetString(PyExc_TypeError, "when using a callable, filter() takes exactly 1 argument");
       Py_DECREF(result);
       return NULL;
     }
-    while (current)
+    while ((item = BString_walk_next(&walk)))
     {
 
-      PyObject *call_result = PyObject_CallFunctionObjArgs(filter_condition, current->str, NULL);
+      PyObject *call_result = PyObject_CallOneArg(filter_condition, item);
       if (!call_result)
       {
         error_occurred = 1;
@@ -1000,51 +2366,31 @@ static PyObject *BString_filter(BStringObject *self, PyObject *args)
         error_occurred = 1;
         break;
       }
-      if (is_true)
+      if (is_true && BString_push(result, item) != 0)
       {
-
-        BStringNode *new_node = new_BStringNode(current->str);
-        if (!new_node)
-        {
-          error_occurred = 1;
-          break;
-        }
-        if (!result->head)
-        {
-          result->head = result->tail = result->current = new_node;
-        }
-        else
-        {
-          result->tail->next = new_node;
-          new_node->prev = result->tail;
-          result->tail = new_node;
-        }
-        result->size++;
+        error_occurred = 1;
+        break;
       }
-      current = current->next;
     }
   }
 
   else if (PyUnicode_Check(filter_condition))
   {
 
-    PyObject *method_args_tuple = PyTuple_New(num_args - 1);
-    if (!method_args_tuple)
+    PyObject **call_args = PyMem_Malloc(nargs * sizeof(PyObject *));
+    if (!call_args)
     {
       Py_DECREF(result);
-      return NULL;
+      return PyErr_NoMemory();
     }
-    for (Py_ssize_t i = 1; i < num_args; ++i)
+    for (Py_ssize_t i = 1; i < nargs; ++i)
     {
-      PyObject *item = PyTuple_GET_ITEM(args, i);
-      Py_INCREF(item);
-      PyTuple_SET_ITEM(method_args_tuple, i - 1, item);
+      call_args[i] = args[i];
     }
-    while (current)
+    while ((item = BString_walk_next(&walk)))
     {
-      const char *method_name = PyUnicode_AsUTF8(filter_condition);
-
-      PyObject *call_result = PyObject_CallMethod(current->str, method_name, "O", method_args_tuple);
+      call_args[0] = item;
+      PyObject *call_result = PyObject_VectorcallMethod(filter_condition, call_args, nargs, NULL);
       if (!call_result)
       {
         error_occurred = 1;
@@ -1057,30 +2403,13 @@ static PyObject *BString_filter(BStringObject *self, PyObject *args)
         error_occurred = 1;
         break;
       }
-      if (is_true)
+      if (is_true && BString_push(result, item) != 0)
       {
-
-        BStringNode *new_node = new_BStringNode(current->str);
-        if (!new_node)
-        {
-          error_occurred = 1;
-          break;
-        }
-        if (!result->head)
-        {
-          result->head = result->tail = result->current = new_node;
-        }
-        else
-        {
-          result->tail->next = new_node;
-          new_node->prev = result->tail;
-          result->tail = new_node;
-        }
-        result->size++;
+        error_occurred = 1;
+        break;
       }
-      current = current->next;
     }
-    Py_DECREF(method_args_tuple);
+    PyMem_Free(call_args);
   }
 
   else
@@ -1105,6 +2434,11 @@ static PyObject *BString_repeat(BStringObject *self, Py_ssize_t n)
   {
     return NULL;
   }
+  if (self->arena && BString_compact_storage(result) < 0)
+  {
+    Py_DECREF(result);
+    return NULL;
+  }
 
   if (n <= 0)
   {
@@ -1113,55 +2447,15 @@ static PyObject *BString_repeat(BStringObject *self, Py_ssize_t n)
 
   for (Py_ssize_t i = 0; i < n; ++i)
   {
-    BStringNode *current = self->head;
-    while (current)
+    if (BString_push_shared(result, self) != 0)
     {
-      BStringNode *new_node = new_BStringNode(current->str);
-      if (!new_node)
-      {
-        return NULL; 
-      }
-      if (!result->head)
-      {
-        result->head = result->tail = result->current = new_node;
-      }
-      else
-      {
-        result->tail->next = new_node;
-        new_node->prev = result->tail;
-        result->tail = new_node;
-      }
-      result->size++;
-      current = current->next;
+      Py_DECREF(result);
+      return NULL; 
     }
   }
   return (PyObject *)result;
 }
 
-static int BString_append_nodes_from_source(BStringObject *result, BStringObject *source)
-{
-  BStringNode *current = source->head;
-  while (current)
-  {
-    BStringNode *new_node = new_BStringNode(current->str);
-    if (!new_node)
-      return -1; 
-    if (!result->head)
-    {
-      result->head = result->tail = result->current = new_node;
-    }
-    else
-    {
-      result->tail->next = new_node;
-      new_node->prev = result->tail;
-      result->tail = new_node;
-    }
-    result->size++;
-    current = current->next;
-  }
-  return 0; 
-}
-
 static PyObject *BString_concat(BStringObject *self, PyObject *other)
 {
   if (!PyObject_IsInstance((PyObject *)other, (PyObject *)&BStringType))
@@ -1172,12 +2466,12 @@ static PyObject *BString_concat(BStringObject *self, PyObject *other)
   BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
   if (!result)
     return NULL;
-  if (BString_append_nodes_from_source(result, self) != 0)
+  if ((self->arena && BString_compact_storage(result) < 0) || BString_push_shared(result, self) != 0)
   {
     Py_DECREF(result);
     return NULL;
   }
-  if (BString_append_nodes_from_source(result, (BStringObject *)other) != 0)
+  if (BString_push_shared(result, (BStringObject *)other) != 0)
   {
     Py_DECREF(result);
     return NULL;
@@ -1185,35 +2479,17 @@ static PyObject *BString_concat(BStringObject *self, PyObject *other)
   return (PyObject *)result;
 }
 
-static BStringNode *new_BStringNode(PyObject *str_obj)
-{
-  BStringNode *node = PyMem_Malloc(sizeof(BStringNode));
-  if (!node)
-  {
-    PyErr_NoMemory();
-    return NULL;
-  }
-  Py_INCREF(str_obj);
-  node->str = str_obj;
-  node->next = NULL;
-  node->prev = NULL;
-  return node;
-}
-
 static void BStringIter_dealloc(BStringIterObject *iter)
 {
-
+  Py_XDECREF(iter->bstring);
   PyObject_Del(iter);
 }
 
 static PyObject *BStringIter_iternext(BStringIterObject *iter)
 {
-  if (iter->current_node)
+  if (iter->bstring && iter->index < iter->bstring->size)
   {
-    PyObject *str_obj = iter->current_node->str;
-    Py_INCREF(str_obj); 
-    iter->current_node = iter->current_node->next;
-    return str_obj;
+    return BString_fetch_at(iter->bstring, iter->index++);
   }
   else
   {
@@ -1240,41 +2516,55 @@ static PyObject *BString_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
   self = (BStringObject *)type->tp_alloc(type, 0);
   if (self != NULL)
   {
-    self->head = NULL;
-    self->tail = NULL;
-    self->current = NULL;
+    self->chunks = NULL;
+    self->chunk_counts = NULL;
+    self->count_tree = NULL;
+    self->num_chunks = 0;
+    self->chunks_allocated = 0;
+    self->count_tree_valid = 0;
+    self->cached_chunk = -1;
+    self->cached_base = 0;
+    self->current = 0;
+    self->mod_count = 0;
     self->size = 0;
+    self->arena = NULL;
+    self->index = NULL;
+    self->use_index = 0;
     self->weakreflist = NULL;
+    self->slabs = NULL;
+    self->free_chunks = NULL;
+    self->slab_chunks = 0;
   }
   return (PyObject *)self;
 }
 
 static int BString_init(BStringObject *self, PyObject *args, PyObject *kwds)
 {
-  for (int i = 0; i < PyTuple_GET_SIZE(args); ++i)
+  PyObject **items = PySequence_Fast_ITEMS(args);
+  Py_ssize_t count = PyTuple_GET_SIZE(args);
+  if (BString_check_strings(items, count, "All arguments must be strings.") < 0)
+    return -1;
+  return BString_push_array(self, items, count);
+}
+
+// BString(*strings) through vectorcall: the arguments are appended straight
+// from the caller's array, without building an argument tuple. Subclasses do
+// not inherit tp_vectorcall and keep going through tp_new and tp_init.
+static PyObject *BString_vectorcall(PyObject *type, PyObject *const *args, size_t nargsf, PyObject *kwnames)
+{
+  Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+  if (BString_check_strings(args, nargs, "All arguments must be strings.") < 0)
+    return NULL;
+
+  BStringObject *self = (BStringObject *)BString_new((PyTypeObject *)type, NULL, NULL);
+  if (!self)
+    return NULL;
+  if (BString_push_array(self, args, nargs) != 0)
   {
-    PyObject *item = PyTuple_GET_ITEM(args, i);
-    if (!PyUnicode_Check(item))
-    {
-      PyErr_SetString(PyExc_TypeError, "All arguments must be strings.");
-      return -1;
-    }
-    BStringNode *node = new_BStringNode(item);
-    if (!node)
-      return -1;
-    if (!self->head)
-    { 
-      self->head = self->tail = self->current = node;
-    }
-    else
-    {
-      self->tail->next = node;
-      node->prev = self->tail;
-      self->tail = node;
-    }
-    self->size++;
+    Py_DECREF(self);
+    return NULL;
   }
-  return 0;
+  return (PyObject *)self;
 }
 
 static void BString_dealloc(BStringObject *self)
@@ -1283,32 +2573,45 @@ static void BString_dealloc(BStringObject *self)
   {
     PyObject_ClearWeakRefs((PyObject *)self);
   }
-  BStringNode *current = self->head;
-  while (current)
-  {
-    BStringNode *next = current->next;
-    Py_DECREF(current->str); 
-    PyMem_Free(current);     
-    current = next;
-  }
+  BString_clear_storage(self);
   Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static PyObject *BString_repr(BStringObject *self)
+static PyObject *BString_to_list(BStringObject *self)
 {
-  PyObject *list = PyList_New(0);
+  PyObject *list = PyList_New(self->size);
   if (!list)
     return NULL;
-  BStringNode *current = self->head;
-  while (current)
+  if (self->arena)
   {
-    if (PyList_Append(list, current->str) != 0)
+    for (Py_ssize_t i = 0; i < self->size; ++i)
     {
-      Py_DECREF(list);
-      return NULL;
+      PyObject *item = BStringArena_item(self->arena, i);
+      if (!item)
+      {
+        Py_DECREF(list);
+        return NULL;
+      }
+      PyList_SET_ITEM(list, i, item);
     }
-    current = current->next;
+    return list;
+  }
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  for (Py_ssize_t i = 0; i < self->size; ++i)
+  {
+    PyObject *item = BString_walk_next(&walk);
+    Py_INCREF(item);
+    PyList_SET_ITEM(list, i, item);
   }
+  return list;
+}
+
+static PyObject *BString_repr(BStringObject *self)
+{
+  PyObject *list = BString_to_list(self);
+  if (!list)
+    return NULL;
   PyObject *repr = PyObject_Repr(list);
   Py_DECREF(list);
   return repr;
@@ -1330,31 +2633,16 @@ static PyObject *BString_call(BStringObject *self, PyObject *args, PyObject *kwd
 
   if (strcmp(container, "list") == 0)
   {
-    PyObject *list = PyList_New(self->size);
-    if (!list)
-      return NULL;
-    BStringNode *current = self->head;
-    for (Py_ssize_t i = 0; i < self->size; ++i)
-    {
-      Py_INCREF(current->str);
-      PyList_SET_ITEM(list, i, current->str);
-      current = current->next;
-    }
-    return list;
+    return BString_to_list(self);
   }
 
   if (strcmp(container, "tuple") == 0)
   {
-    PyObject *tuple = PyTuple_New(self->size);
-    if (!tuple)
+    PyObject *list = BString_to_list(self);
+    if (!list)
       return NULL;
-    BStringNode *current = self->head;
-    for (Py_ssize_t i = 0; i < self->size; ++i)
-    {
-      Py_INCREF(current->str);
-      PyTuple_SET_ITEM(tuple, i, current->str);
-      current = current->next;
-    }
+    PyObject *tuple = PyList_AsTuple(list);
+    Py_DECREF(list);
     return tuple;
   }
 
@@ -1365,19 +2653,25 @@ static PyObject *BString_call(BStringObject *self, PyObject *args, PyObject *kwd
       PyErr_SetString(PyExc_ValueError, "'keys' must be a list of the same length as the BString.");
       return NULL;
     }
+    PyObject *values = BString_to_list(self);
+    if (!values)
+      return NULL;
     PyObject *dict = PyDict_New();
     if (!dict)
+    {
+      Py_DECREF(values);
       return NULL;
-    BStringNode *current = self->head;
+    }
     for (Py_ssize_t i = 0; i < self->size; ++i)
     {
-      if (PyDict_SetItem(dict, PyList_GET_ITEM(keys, i), current->str) != 0)
+      if (PyDict_SetItem(dict, PyList_GET_ITEM(keys, i), PyList_GET_ITEM(values, i)) != 0)
       {
+        Py_DECREF(values);
         Py_DECREF(dict);
         return NULL;
       }
-      current = current->next;
     }
+    Py_DECREF(values);
     return dict;
   }
 
@@ -1423,75 +2717,172 @@ static PyObject *BString_call(BStringObject *self, PyObject *args, PyObject *kwd
 
 static PyObject *BString_extend(BStringObject *self, PyObject *iterable)
 {
+  if (BString_extend_from_iterable(self, iterable, "extend") != 0)
+    return NULL;
+  Py_RETURN_NONE;
+}
 
-  PyObject *iterator = PyObject_GetIter(iterable);
-  if (!iterator)
+static PyObject *BString_iter(BStringObject *self)
+{
+
+  self->current = 0;
+
+  BStringIterObject *iter = PyObject_New(BStringIterObject, &BStringIter_Type);
+  if (!iter)
   {
-    PyErr_SetString(PyExc_TypeError, "extend() argument must be an iterable");
     return NULL;
   }
-  PyObject *item;
 
-  while ((item = PyIter_Next(iterator)))
-  {
+  Py_INCREF(self);
+  iter->bstring = self;
+  iter->index = 0;
+  return (PyObject *)iter;
+}
 
-    if (!PyUnicode_Check(item))
+static Py_ssize_t BString_length(BStringObject *self)
+{
+  return self->size;
+}
+
+PyObject *BString_from_walk(BStringWalk *walk)
+{
+  BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (!result)
+    return NULL;
+
+  PyObject *item;
+  while ((item = BString_walk_next(walk)))
+  {
+    if (BString_push(result, item) != 0)
     {
-      PyErr_SetString(PyExc_TypeError, "BString can only extend with an iterable of strings");
-      Py_DECREF(item);
-      Py_DECREF(iterator);
+      Py_DECREF(result);
       return NULL;
     }
+  }
+  return (PyObject *)result;
+}
 
-    BStringNode *new_node = new_BStringNode(item);
-    if (!new_node)
+// Copies the selected arena items into a new compact BString.
+static PyObject *BString_slice_arena(BStringArena *arena, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length)
+{
+  BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
+  if (!result)
+    return NULL;
+  if (BString_compact_storage(result) < 0)
+  {
+    Py_DECREF(result);
+    return NULL;
+  }
+  for (Py_ssize_t i = 0, index = start; i < length; ++i, index += step)
+  {
+    Py_ssize_t item_length;
+    const char *bytes = BStringArena_bytes(arena, index, &item_length);
+    if (BStringArena_append(result->arena, bytes, item_length) != 0)
     {
-      Py_DECREF(item);
-      Py_DECREF(iterator);
+      Py_DECREF(result);
       return NULL;
     }
-    if (self->tail == NULL)
-    { 
-      self->head = self->tail = self->current = new_node;
-    }
-    else
-    {
-      self->tail->next = new_node;
-      new_node->prev = self->tail;
-      self->tail = new_node;
-    }
-    self->size++;
-
-    Py_DECREF(item);
+    result->size++;
   }
+  return (PyObject *)result;
+}
 
-  Py_DECREF(iterator);
+static PyObject *BString_compact(BStringObject *self, PyObject *Py_UNUSED(args))
+{
+  if (BString_compact_storage(self) < 0)
+    return NULL;
+  Py_RETURN_NONE;
+}
 
-  if (PyErr_Occurred())
-  {
+static PyObject *BString_expand(BStringObject *self, PyObject *Py_UNUSED(args))
+{
+  if (BString_expand_arena(self) < 0)
     return NULL;
-  }
   Py_RETURN_NONE;
 }
 
-static PyObject *BString_iter(BStringObject *self)
+static PyObject *BString_get_is_compact(BStringObject *self, void *closure)
 {
+  return PyBool_FromLong(self->arena != NULL);
+}
+
+static PyObject *BString_enable_index(BStringObject *self, PyObject *Py_UNUSED(args))
+{
+  self->use_index = 1;
+  Py_RETURN_NONE;
+}
 
-  self->current = self->head;
+static PyObject *BString_disable_index(BStringObject *self, PyObject *Py_UNUSED(args))
+{
+  self->use_index = 0;
+  BString_drop_index(self);
+  Py_RETURN_NONE;
+}
 
-  BStringIterObject *iter = PyObject_New(BStringIterObject, &BStringIter_Type);
-  if (!iter)
+static PyObject *BString_get_is_indexed(BStringObject *self, void *closure)
+{
+  return PyBool_FromLong(self->use_index);
+}
+
+static int BString_sq_contains(BStringObject *self, PyObject *value)
+{
+  Py_ssize_t position;
+  return BString_find_item(self, value, 0, self->size, &position);
+}
+
+static PyObject *BString_index(BStringObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+  PyObject *value;
+  Py_ssize_t start = 0, stop = PY_SSIZE_T_MAX;
+  static char *kwlist[] = {"value", "start", "stop", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "O|nn:index", kwlist, &value, &start, &stop))
   {
     return NULL;
   }
+  if (start < 0)
+    start += self->size;
+  if (stop < 0)
+    stop += self->size;
 
-  iter->current_node = self->head;
-  return (PyObject *)iter;
+  Py_ssize_t position;
+  int found = BString_find_item(self, value, start, stop, &position);
+  if (found < 0)
+    return NULL;
+  if (found == 0)
+  {
+    PyErr_SetString(PyExc_ValueError, "BString.index(x): x not in BString");
+    return NULL;
+  }
+  return PyLong_FromSsize_t(position);
 }
 
-static Py_ssize_t BString_length(BStringObject *self)
+static PyObject *BString_count(BStringObject *self, PyObject *value)
 {
-  return self->size;
+  Py_ssize_t count = BString_count_item(self, value);
+  if (count < 0)
+    return NULL;
+  return PyLong_FromSsize_t(count);
+}
+
+static PyObject *BString_view(BStringObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  PyObject *start = Py_None, *stop = Py_None, *step = Py_None;
+  static char *kwlist[] = {"start", "stop", "step", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "|OOO:view", kwlist, &start, &stop, &step))
+  {
+    return NULL;
+  }
+
+  PyObject *slice = PySlice_New(start, stop, step);
+  if (!slice)
+    return NULL;
+  Py_ssize_t slice_start, slice_stop, slice_step, slicelength;
+  int status = PySlice_GetIndicesEx(slice, self->size, &slice_start, &slice_stop, &slice_step, &slicelength);
+  Py_DECREF(slice);
+  if (status < 0 || BString_expand_arena(self) < 0)
+    return NULL;
+
+  return BStringView_create(self, slice_start, slice_step, slicelength);
 }
 
 static PyObject *BString_getitem(BStringObject *self, PyObject *key)
@@ -1505,51 +2896,20 @@ static PyObject *BString_getitem(BStringObject *self, PyObject *key)
       return NULL; 
     }
 
-    BStringObject *result = (BStringObject *)BString_new(&BStringType, NULL, NULL);
-    if (!result)
-      return NULL;
-    if (slicelength <= 0)
-    {
-      return (PyObject *)result; 
-    }
-
-    BStringNode *current = self->head;
-    for (Py_ssize_t i = 0; i < start; ++i)
-    {
-      current = current->next;
-    }
-
-    for (Py_ssize_t i = 0; i < slicelength; ++i)
-    {
-      BStringNode *new_node = new_BStringNode(current->str);
-      if (!new_node)
-      {
-        BString_dealloc(result);
-        return NULL;
-      }
-      if (!result->head)
-      {
-        result->head = result->tail = result->current = new_node;
-      }
-      else
-      {
-        result->tail->next = new_node;
-        new_node->prev = result->tail;
-        result->tail = new_node;
-      }
-      result->size++;
-
-      for (Py_ssize_t j = 0; j < step && current; ++j)
-      {
-        current = current->next;
-      }
-    }
-    return (PyObject *)result;
+    if (self->arena)
+      return BString_slice_arena(self->arena, start, step, slicelength);
+    BStringWalk walk;
+    BString_walk_init_range(&walk, self, start, step, slicelength);
+    return BString_from_walk(&walk);
   }
 
   else if (PyLong_Check(key))
   {
     Py_ssize_t i = PyLong_AsSsize_t(key);
+    if (i == -1 && PyErr_Occurred())
+    {
+      return NULL;
+    }
     if (i < 0)
     {
       i += self->size;
@@ -1559,13 +2919,7 @@ static PyObject *BString_getitem(BStringObject *self, PyObject *key)
       PyErr_SetString(PyExc_IndexError, "BString index out of range");
       return NULL;
     }
-    BStringNode *current = self->head;
-    for (Py_ssize_t j = 0; j < i; ++j)
-    {
-      current = current->next;
-    }
-    Py_INCREF(current->str);
-    return current->str;
+    return BString_fetch_at(self, i);
   }
   else
   {
@@ -1574,57 +2928,6 @@ static PyObject *BString_getitem(BStringObject *self, PyObject *key)
   }
 }
 
-static int BString_delete_slice_nodes(BStringObject *self, Py_ssize_t start, Py_ssize_t stop)
-{
-  if (start >= stop)
-  {
-    return 0; 
-  }
-
-  BStringNode *current = self->head;
-  for (Py_ssize_t i = 0; i < start && current; ++i)
-  {
-    current = current->next;
-  }
-
-  BStringNode *node_before_slice = (start > 0 && current) ? current->prev : NULL;
-  BStringNode *node_at_stop = current;
-  for (Py_ssize_t i = start; i < stop && node_at_stop; ++i)
-  {
-    node_at_stop = node_at_stop->next;
-  }
-
-  for (Py_ssize_t i = start; i < stop; ++i)
-  {
-    if (!current)
-      break; 
-    BStringNode *next_node = current->next;
-    Py_DECREF(current->str);
-    PyMem_Free(current);
-    current = next_node;
-    self->size--;
-  }
-
-  if (node_before_slice)
-  {
-    node_before_slice->next = node_at_stop;
-  }
-  else
-  {
-    self->head = node_at_stop; 
-  }
-  if (node_at_stop)
-  {
-    node_at_stop->prev = node_before_slice;
-  }
-  else
-  {
-    self->tail = node_before_slice; 
-  }
-  self->current = self->head; 
-  return 0;
-}
-
 static int BString_ass_item(BStringObject *self, PyObject *key, PyObject *value)
 {
 
@@ -1642,62 +2945,42 @@ static int BString_ass_item(BStringObject *self, PyObject *key, PyObject *value)
       return -1;
     }
 
-    if (BString_delete_slice_nodes(self, start, stop) != 0)
-    {
-      return -1; 
-    }
-
+    PyObject *items = NULL;
     if (value)
     {
-
-      BStringNode *insertion_point = self->head;
-      for (Py_ssize_t i = 0; i < start && insertion_point; ++i)
-      {
-        insertion_point = insertion_point->next;
-      }
-
-      PyObject *iterator = PyObject_GetIter(value);
-      if (!iterator)
+      items = PySequence_Fast(value, "can only assign an iterable to a slice");
+      if (!items)
       {
-        PyErr_SetString(PyExc_TypeError, "can only assign an iterable to a slice");
         return -1;
       }
+    }
+
+    // Checked before anything is deleted, so a bad value leaves self as it was.
+    if (items && BString_check_strings(PySequence_Fast_ITEMS(items), PySequence_Fast_GET_SIZE(items),
+                                       "BString items must be strings") < 0)
+    {
+      Py_DECREF(items);
+      return -1;
+    }
+    if (BString_delete_range(self, start, stop) != 0)
+    {
+      Py_XDECREF(items);
+      return -1;
+    }
 
-      PyObject *item;
-      BStringNode *last_inserted_node = insertion_point ? insertion_point->prev : self->tail;
-      while ((item = PyIter_Next(iterator)))
+    if (items)
+    {
+      Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+      PyObject **values = PySequence_Fast_ITEMS(items);
+      for (Py_ssize_t i = 0; i < count; ++i)
       {
-        BStringNode *new_node = new_BStringNode(item);
-        Py_DECREF(item);
-        if (!new_node)
+        if (BString_insert_at(self, start + i, values[i]) != 0)
         {
-          Py_DECREF(iterator);
+          Py_DECREF(items);
           return -1;
         }
-        new_node->prev = last_inserted_node;
-        new_node->next = insertion_point;
-        if (last_inserted_node)
-        {
-          last_inserted_node->next = new_node;
-        }
-        else
-        {
-          self->head = new_node;
-        }
-        last_inserted_node = new_node;
-        self->size++;
-      }
-      Py_DECREF(iterator);
-      if (insertion_point)
-      {
-        insertion_point->prev = last_inserted_node;
-      }
-      else
-      {
-        self->tail = last_inserted_node;
       }
-      if (PyErr_Occurred())
-        return -1; 
+      Py_DECREF(items);
     }
     return 0; 
   }
@@ -1705,6 +2988,10 @@ static int BString_ass_item(BStringObject *self, PyObject *key, PyObject *value)
   else if (PyLong_Check(key))
   {
     Py_ssize_t i = PyLong_AsSsize_t(key);
+    if (i == -1 && PyErr_Occurred())
+    {
+      return -1;
+    }
     if (i < 0)
     {
       i += self->size;
@@ -1714,16 +3001,13 @@ static int BString_ass_item(BStringObject *self, PyObject *key, PyObject *value)
       PyErr_SetString(PyExc_IndexError, "BString assignment index out of range");
       return -1;
     }
-    BStringNode *target_node = self->head;
-    for (Py_ssize_t j = 0; j < i; ++j)
-    {
-      target_node = target_node->next;
-    }
 
     if (value == NULL)
     {
 
-      PyObject *removed_str = BString_remove_node(self, target_node);
+      PyObject *removed_str = BString_take_at(self, i);
+      if (!removed_str)
+        return -1;
       Py_DECREF(removed_str);
       return 0;
     }
@@ -1733,10 +3017,7 @@ static int BString_ass_item(BStringObject *self, PyObject *key, PyObject *value)
       PyErr_SetString(PyExc_TypeError, "BString items must be strings");
       return -1;
     }
-    Py_DECREF(target_node->str); 
-    Py_INCREF(value);            
-    target_node->str = value;
-    return 0;
+    return BString_replace_at(self, i, value);
   }
   else
   {
@@ -1754,7 +3035,7 @@ static PySequenceMethods BString_as_sequence =
     0,                            
     0,                            
     0,                            
-    0,                            
+    (objobjproc)BString_sq_contains,
 };
 
 static PyMappingMethods BString_as_mapping =
@@ -1766,33 +3047,30 @@ static PyMappingMethods BString_as_mapping =
 
 static PyObject *BString_get_head(BStringObject *self, void *closure)
 {
-  if (!self->head)
+  if (self->size == 0)
     Py_RETURN_NONE;
-  Py_INCREF(self->head->str);
-  return self->head->str;
+  return BString_fetch_at(self, 0);
 }
 
 static PyObject *BString_get_tail(BStringObject *self, void *closure)
 {
-  if (!self->tail)
+  if (self->size == 0)
     Py_RETURN_NONE;
-  Py_INCREF(self->tail->str);
-  return self->tail->str;
+  return BString_fetch_at(self, self->size - 1);
 }
 
 static PyObject *BString_get_current(BStringObject *self, void *closure)
 {
-  if (!self->current)
+  if (self->current < 0 || self->current >= self->size)
     Py_RETURN_NONE;
-  Py_INCREF(self->current->str);
-  return self->current->str;
+  return BString_fetch_at(self, self->current);
 }
 
 static PyObject *BString_move_next(BStringObject *self, PyObject *Py_UNUSED(args))
 {
-  if (self->current && self->current->next)
+  if (self->current + 1 < self->size)
   {
-    self->current = self->current->next;
+    self->current++;
     Py_RETURN_TRUE;
   }
   Py_RETURN_FALSE;
@@ -1800,9 +3078,9 @@ static PyObject *BString_move_next(BStringObject *self, PyObject *Py_UNUSED(args
 
 static PyObject *BString_move_prev(BStringObject *self, PyObject *Py_UNUSED(args))
 {
-  if (self->current && self->current->prev)
+  if (self->current > 0 && self->current < self->size)
   {
-    self->current = self->current->prev;
+    self->current--;
     Py_RETURN_TRUE;
   }
   Py_RETURN_FALSE;
@@ -1810,13 +3088,13 @@ static PyObject *BString_move_prev(BStringObject *self, PyObject *Py_UNUSED(args
 
 static PyObject *BString_move_to_head(BStringObject *self, PyObject *Py_UNUSED(args))
 {
-  self->current = self->head;
+  self->current = 0;
   Py_RETURN_NONE;
 }
 
 static PyObject *BString_move_to_tail(BStringObject *self, PyObject *Py_UNUSED(args))
 {
-  self->current = self->tail;
+  self->current = self->size > 0 ? self->size - 1 : 0;
   Py_RETURN_NONE;
 }
 
@@ -1825,6 +3103,8 @@ static PyGetSetDef BString_getsetters[] =
     {"head", (getter)BString_get_head, NULL, "The first string in the sequence (read-only).", NULL},
     {"tail", (getter)BString_get_tail, NULL, "The last string in the sequence (read-only).", NULL},
     {"current", (getter)BString_get_current, NULL, "The string at the current cursor position (read-only).", NULL},
+    {"is_compact", (getter)BString_get_is_compact, NULL, "True while the strings are held in compact UTF-8 storage (read-only).", NULL},
+    {"is_indexed", (getter)BString_get_is_indexed, NULL, "True while lookups use the hash index enabled by enable_index() (read-only).", NULL},
     {NULL} /* Sentinel */
 };
 
@@ -1837,6 +3117,7 @@ PyTypeObject BStringType =
     .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
     .tp_new = BString_new,
     .tp_init = (initproc)BString_init,
+    .tp_vectorcall = (vectorcallfunc)BString_vectorcall,
     .tp_dealloc = (destructor)BString_dealloc,
     .tp_repr = (reprfunc)BString_repr,
     .tp_as_sequence = &BString_as_sequence,
@@ -1847,57 +3128,3 @@ PyTypeObject BStringType =
     .tp_getset = BString_getsetters,
     .tp_weaklistoffset = offsetof(BStringObject, weakreflist),
 };
-
-static int String_delete_slice_nodes(BStringObject *self, Py_ssize_t start, Py_ssize_t stop)
-{
-  if (start >= stop)
-  {
-    return 0; 
-  }
-
-  BStringNode *current = self->head;
-  for (Py_ssize_t i = 0; i < start && current; ++i)
-  {
-    current = current->next;
-  }
-
-  BStringNode *node_before_slice = (start > 0) ? current->prev : NULL;
-  BStringNode *node_at_stop = current;
-  for (Py_ssize_t i = start; i < stop && node_at_stop; ++i)
-  {
-    node_at_stop = node_at_stop->next;
-  }
-
-  for (Py_ssize_t i = start; i < stop; ++i)
-  {
-    if (!current)
-      break;
-    BStringNode *next_node = current->next;
-    Py_DECREF(current->str);
-    PyMem_Free(current);
-    current = next_node;
-    self->size--;
-  }
-
-  if (node_before_slice)
-  {
-    node_before_slice->next = node_at_stop;
-  }
-  else
-  {
-
-    self->head = node_at_stop;
-  }
-  if (node_at_stop)
-  {
-    node_at_stop->prev = node_before_slice;
-  }
-  else
-  {
-
-    self->tail = node_before_slice;
-  }
-
-  self->current = self->head;
-  return 0;
-}
\ No newline at end of file
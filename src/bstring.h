@@ -20,72 +20,74 @@ Email: juha.a.sinisalo@gmail.com
 
 // Forward declare the main struct to solve circular dependencies
 typedef struct BStringObject BStringObject;
+typedef struct BStringArena BStringArena;
+typedef struct BStringIndex BStringIndex;
 
-// A slab of memory for pre-allocating nodes.
+// Number of string references held by one full-size storage chunk.
+#define BSTRING_CHUNK_CAPACITY 64
+
+// Capacity of the smallest chunk. The first chunk of a BString is sized to
+// the items it gets and doubles up to BSTRING_CHUNK_CAPACITY, so small
+// BStrings do not carry a full chunk.
+#define BSTRING_CHUNK_MIN_CAPACITY 4
+
+// Upper bound on the number of chunks carved out of a single slab.
+#define BSTRING_SLAB_MAX_CHUNKS 64
+
+// A slab of memory for pre-allocating chunks. The chunks follow the header.
 typedef struct Slab {
     struct Slab *next;
+    BStringObject *owner;              // NULL once the owner is gone but shared chunks remain.
+    Py_ssize_t num_chunks;
+    Py_ssize_t live_chunks;            // Chunks currently handed out of this slab.
 } Slab;
 
-// Represents a node in the BString's internal doubly linked list.
-typedef struct BStringNode {
-    PyObject *str;
-    struct BStringNode *next;
-    struct BStringNode *prev;
-} BStringNode;
+// A block of string references. A BString keeps its elements in a directory
+// of these blocks, in sequence order. Chunks can be shared between the
+// directories of several BStrings (see BString_push_shared) and are copied
+// before any of them writes to a shared one. Full-size chunks are carved
+// out of slabs; smaller ones are allocated on their own with room for
+// capacity items only.
+typedef struct BStringChunk {
+    Slab *slab;                        // NULL for a chunk allocated on its own.
+    Py_ssize_t refs;                   // Number of directories referencing this chunk.
+    Py_ssize_t capacity;
+    struct BStringChunk *next_free;    // Link in the owner's free list while unused.
+    PyObject *items[BSTRING_CHUNK_CAPACITY];
+} BStringChunk;
 
 // The structure for the dedicated iterator object.
 typedef struct {
     PyObject_HEAD
-    BStringNode *current_node;
-    BStringObject *bstring;    // A back-reference to the BString being iterated.
+    Py_ssize_t index;          // Position of the next item to yield.
+    BStringObject *bstring;    // A strong reference to the BString being iterated.
 } BStringIterObject;
 
 // The main BString Python object structure.
 struct BStringObject {
     PyObject_HEAD
-    BStringNode *head;
-    BStringNode *tail;
-    BStringNode *current;
+    BStringChunk **chunks;         // Block directory.
+    Py_ssize_t *chunk_counts;      // Number of items used in each chunk, parallel to chunks.
+    Py_ssize_t *count_tree;        // Fenwick tree over chunk_counts (1-based) for order-statistics lookup.
+    Py_ssize_t num_chunks;
+    Py_ssize_t chunks_allocated;
+    Py_ssize_t count_tree_valid;   // count_tree[1 .. count_tree_valid] are up to date.
+    Py_ssize_t cached_chunk;       // Chunk resolved by the last index lookup, or -1.
+    Py_ssize_t cached_base;        // Sequence index of the first item in cached_chunk.
+    Py_ssize_t current;            // Cursor position used by head/next/prev navigation.
+    Py_ssize_t mod_count;          // Bumped whenever existing items move or change; checked by views.
     Py_ssize_t size;
+    BStringArena *arena;           // Compact UTF-8 storage, or NULL when items are held in chunks.
+    BStringIndex *index;           // Hash index for lookups, or NULL until one is needed.
+    int use_index;                 // Set by enable_index(); lookups then build and keep the index.
     PyObject *weakreflist;
 
     // Members for the custom memory pool
     Slab *slabs;
-    BStringNode *free_nodes;
+    BStringChunk *free_chunks;
+    Py_ssize_t slab_chunks;        // Number of chunks carved out of all slabs so far.
 };
 
-static BStringNode *new_BStringNode(PyObject *str_obj);
-static void BString_dealloc(BStringObject *self);
-static PyObject *BString_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
-static int BString_init(BStringObject *self, PyObject *args, PyObject *kwds);
-static PyObject *BString_repr(BStringObject *self);
-static PyObject *BString_call(BStringObject *self, PyObject *args, PyObject *kwds);
-static PyObject *BString_iter(BStringObject *self);
-static PyObject *BString_iternext(BStringObject *self);
-static Py_ssize_t BString_length(BStringObject *self);
-static PyObject *BString_getitem(BStringObject *self, PyObject *key);
-static PyObject *BString_from_node(BStringNode *node);
-static PyObject *BString_extend(BStringObject *self, PyObject *args);
-static PyObject *BString_append(BStringObject *self, PyObject *obj);
-static PyObject *BString_transform_chars(BStringObject *self, PyObject *args, PyObject *kwds);
-static PyObject *BString_repeat(BStringObject *self, Py_ssize_t n);
-static PyObject *BString_filter(BStringObject *self, PyObject *args);
-static PyObject *BString_from_file(PyObject *type, PyObject *args);
-static PyObject *BString_to_file(BStringObject *self, PyObject *args);
-static PyObject *BString_from_csv(PyObject *type, PyObject *args, PyObject *kwds);
-static PyObject *BString_to_csv(PyObject *type, PyObject *args, PyObject *kwds);
-static PyObject *BString_render_as_csv_string(BStringObject *self, const char *delimiter, const char *quotechar, int quoting);
-static PyObject *BString_map(BStringObject *self, PyObject *args);
-static PyObject *BString_get_head(BStringObject *self, void *closure);
-static PyObject *BString_get_tail(BStringObject *self, void *closure);
-static PyObject *BString_get_next(BStringObject *self, void *closure);
-static PyObject *BString_get_prev(BStringObject *self, void *closure);
-static PyObject *BString_move_next(BStringObject *self, PyObject *Py_UNUSED(args));
-static PyObject *BString_move_prev(BStringObject *self, PyObject *Py_UNUSED(args));
-static PyObject *BString_move_to_head(BStringObject *self, PyObject *Py_UNUSED(args));
-static PyObject *BString_move_to_tail(BStringObject *self, PyObject *Py_UNUSED(args));
-
-
 // Forward declarations of the type objects.
 extern PyTypeObject BStringType;
 extern PyTypeObject BStringIter_Type;
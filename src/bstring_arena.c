@@ -0,0 +1,258 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_arena.h"
+#include <string.h>
+
+BStringArena *BStringArena_new(void)
+{
+  BStringArena *arena = PyMem_RawMalloc(sizeof(BStringArena));
+  if (!arena)
+  {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  arena->offsets = PyMem_RawMalloc(16 * sizeof(Py_ssize_t));
+  if (!arena->offsets)
+  {
+    PyMem_RawFree(arena);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  arena->data = PyMem_RawMalloc(64);
+  if (!arena->data)
+  {
+    PyMem_RawFree(arena->offsets);
+    PyMem_RawFree(arena);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  arena->offsets[0] = 0;
+  arena->offsets_allocated = 16;
+  arena->count = 0;
+  arena->used = 0;
+  arena->allocated = 64;
+  arena->refs = 1;
+  arena->worker = 0;
+  return arena;
+}
+
+// Returns a private copy of arena, for a BString about to change an arena
+// that is still shared.
+BStringArena *BStringArena_copy(BStringArena *arena)
+{
+  BStringArena *copy = PyMem_RawMalloc(sizeof(BStringArena));
+  if (!copy)
+  {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  copy->allocated = arena->used > 64 ? arena->used : 64;
+  copy->offsets_allocated = arena->count + 2 > 16 ? arena->count + 2 : 16;
+  copy->data = PyMem_RawMalloc(copy->allocated);
+  copy->offsets = PyMem_RawMalloc(copy->offsets_allocated * sizeof(Py_ssize_t));
+  if (!copy->data || !copy->offsets)
+  {
+    PyMem_RawFree(copy->data);
+    PyMem_RawFree(copy->offsets);
+    PyMem_RawFree(copy);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  memcpy(copy->data, arena->data, arena->used);
+  memcpy(copy->offsets, arena->offsets, (arena->count + 1) * sizeof(Py_ssize_t));
+  copy->used = arena->used;
+  copy->count = arena->count;
+  copy->refs = 1;
+  copy->worker = 0;
+  return copy;
+}
+
+// Drops one reference and frees the arena with the last one.
+void BStringArena_free(BStringArena *arena)
+{
+  if (!arena || --arena->refs > 0)
+    return;
+  PyMem_RawFree(arena->data);
+  PyMem_RawFree(arena->offsets);
+  PyMem_RawFree(arena);
+}
+
+static int BStringArena_no_memory(BStringArena *arena)
+{
+  // Worker threads do not hold the GIL; their owner raises afterwards.
+  if (!arena->worker)
+    PyErr_NoMemory();
+  return -1;
+}
+
+// Makes room for one more item of length bytes. *bytes, when it points into
+// this arena (appending a BString to itself), is moved along with the data.
+static int BStringArena_reserve(BStringArena *arena, Py_ssize_t length, const char **bytes)
+{
+  if (arena->count + 2 > arena->offsets_allocated)
+  {
+    Py_ssize_t new_allocated = arena->offsets_allocated * 2;
+    Py_ssize_t *offsets = PyMem_RawRealloc(arena->offsets, new_allocated * sizeof(Py_ssize_t));
+    if (!offsets)
+      return BStringArena_no_memory(arena);
+    arena->offsets = offsets;
+    arena->offsets_allocated = new_allocated;
+  }
+  if (arena->used + length > arena->allocated)
+  {
+    int aliased = bytes && *bytes >= arena->data && *bytes < arena->data + arena->used;
+    Py_ssize_t alias_offset = aliased ? *bytes - arena->data : 0;
+    Py_ssize_t new_allocated = arena->allocated * 2;
+    while (new_allocated < arena->used + length)
+      new_allocated *= 2;
+    char *data = PyMem_RawRealloc(arena->data, new_allocated);
+    if (!data)
+      return BStringArena_no_memory(arena);
+    arena->data = data;
+    arena->allocated = new_allocated;
+    if (aliased)
+      *bytes = data + alias_offset;
+  }
+  return 0;
+}
+
+// Appends length bytes that are already known to be valid UTF-8.
+int BStringArena_append(BStringArena *arena, const char *bytes, Py_ssize_t length)
+{
+  if (BStringArena_reserve(arena, length, &bytes) < 0)
+    return -1;
+  memcpy(arena->data + arena->used, bytes, length);
+  arena->used += length;
+  arena->count++;
+  arena->offsets[arena->count] = arena->used;
+  return 0;
+}
+
+// Appends an item of length bytes and returns where to write them, or NULL.
+// The caller must fill in valid UTF-8 before the arena is used again.
+char *BStringArena_append_raw(BStringArena *arena, Py_ssize_t length)
+{
+  if (BStringArena_reserve(arena, length, NULL) < 0)
+    return NULL;
+  char *bytes = arena->data + arena->used;
+  arena->used += length;
+  arena->count++;
+  arena->offsets[arena->count] = arena->used;
+  return bytes;
+}
+
+// Shortens the last item to length bytes, for when BStringArena_append_raw()
+// reserved more than was written.
+void BStringArena_truncate_last(BStringArena *arena, Py_ssize_t length)
+{
+  arena->used = arena->offsets[arena->count - 1] + length;
+  arena->offsets[arena->count] = arena->used;
+}
+
+// Drops the items from count on, keeping the buffers.
+void BStringArena_truncate(BStringArena *arena, Py_ssize_t count)
+{
+  arena->count = count;
+  arena->used = arena->offsets[count];
+}
+
+// Appends all items of other, which must be a different arena.
+int BStringArena_extend(BStringArena *arena, BStringArena *other)
+{
+  if (other->count == 0)
+    return 0;
+  Py_ssize_t needed = arena->count + other->count + 1;
+  if (needed > arena->offsets_allocated)
+  {
+    Py_ssize_t *offsets = PyMem_RawRealloc(arena->offsets, needed * sizeof(Py_ssize_t));
+    if (!offsets)
+      return BStringArena_no_memory(arena);
+    arena->offsets = offsets;
+    arena->offsets_allocated = needed;
+  }
+  if (arena->used + other->used > arena->allocated)
+  {
+    char *data = PyMem_RawRealloc(arena->data, arena->used + other->used);
+    if (!data)
+      return BStringArena_no_memory(arena);
+    arena->data = data;
+    arena->allocated = arena->used + other->used;
+  }
+  memcpy(arena->data + arena->used, other->data, other->used);
+  for (Py_ssize_t i = 1; i <= other->count; ++i)
+  {
+    arena->offsets[arena->count + i] = arena->used + other->offsets[i];
+  }
+  arena->used += other->used;
+  arena->count += other->count;
+  return 0;
+}
+
+// Appends bytes from an untrusted source, raising UnicodeDecodeError if they
+// are not valid UTF-8. Pure ASCII input is accepted without decoding.
+int BStringArena_append_utf8(BStringArena *arena, const char *bytes, Py_ssize_t length)
+{
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    if ((unsigned char)bytes[i] & 0x80)
+    {
+      PyObject *check = PyUnicode_DecodeUTF8(bytes, length, "strict");
+      if (!check)
+        return -1;
+      Py_DECREF(check);
+      break;
+    }
+  }
+  return BStringArena_append(arena, bytes, length);
+}
+
+int BStringArena_append_object(BStringArena *arena, PyObject *item)
+{
+  if (PyUnicode_IS_ASCII(item))
+    return BStringArena_append(arena, (const char *)PyUnicode_DATA(item), PyUnicode_GET_LENGTH(item));
+
+  // Encode through a temporary so the item does not keep a cached UTF-8 copy.
+  PyObject *encoded = PyUnicode_AsUTF8String(item);
+  if (!encoded)
+    return -1;
+  int status = BStringArena_append(arena, PyBytes_AS_STRING(encoded), PyBytes_GET_SIZE(encoded));
+  Py_DECREF(encoded);
+  return status;
+}
+
+// Gives back the unused tails of both buffers once loading is finished.
+void BStringArena_trim(BStringArena *arena)
+{
+  if (arena->used > 0 && arena->used < arena->allocated)
+  {
+    char *data = PyMem_RawRealloc(arena->data, arena->used);
+    if (data)
+    {
+      arena->data = data;
+      arena->allocated = arena->used;
+    }
+  }
+  if (arena->count + 2 < arena->offsets_allocated)
+  {
+    Py_ssize_t *offsets = PyMem_RawRealloc(arena->offsets, (arena->count + 2) * sizeof(Py_ssize_t));
+    if (offsets)
+    {
+      arena->offsets = offsets;
+      arena->offsets_allocated = arena->count + 2;
+    }
+  }
+}
+
+// Returns a new reference to item index decoded into a Python string.
+PyObject *BStringArena_item(BStringArena *arena, Py_ssize_t index)
+{
+  Py_ssize_t length;
+  const char *bytes = BStringArena_bytes(arena, index, &length);
+  return PyUnicode_DecodeUTF8(bytes, length, "strict");
+}
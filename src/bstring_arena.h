@@ -0,0 +1,49 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_ARENA_H
+#define BSTRING_ARENA_H
+
+#include "bstring.h"
+
+// Compact storage for a BString: the UTF-8 bytes of all strings back to back
+// in one buffer, plus an offsets array. Item i occupies
+// data[offsets[i] .. offsets[i + 1]). Python strings are created on access.
+// The buffers come from the raw allocator so that worker threads can build
+// arenas without the GIL.
+struct BStringArena {
+    char *data;
+    Py_ssize_t used;
+    Py_ssize_t allocated;
+    Py_ssize_t *offsets;           // count + 1 entries, offsets[0] == 0.
+    Py_ssize_t count;
+    Py_ssize_t offsets_allocated;
+    Py_ssize_t refs;               // Holders; a BString copies a shared arena before changing it.
+    int worker;                    // Filled by a thread without the GIL: failures do not raise.
+};
+
+BStringArena *BStringArena_new(void);
+BStringArena *BStringArena_copy(BStringArena *arena);
+void BStringArena_free(BStringArena *arena);
+int BStringArena_append(BStringArena *arena, const char *bytes, Py_ssize_t length);
+char *BStringArena_append_raw(BStringArena *arena, Py_ssize_t length);
+void BStringArena_truncate_last(BStringArena *arena, Py_ssize_t length);
+void BStringArena_truncate(BStringArena *arena, Py_ssize_t count);
+int BStringArena_extend(BStringArena *arena, BStringArena *other);
+int BStringArena_append_utf8(BStringArena *arena, const char *bytes, Py_ssize_t length);
+int BStringArena_append_object(BStringArena *arena, PyObject *item);
+void BStringArena_trim(BStringArena *arena);
+PyObject *BStringArena_item(BStringArena *arena, Py_ssize_t index);
+
+static inline const char *BStringArena_bytes(BStringArena *arena, Py_ssize_t index, Py_ssize_t *length)
+{
+  *length = arena->offsets[index + 1] - arena->offsets[index];
+  return arena->data + arena->offsets[index];
+}
+
+#endif // BSTRING_ARENA_H
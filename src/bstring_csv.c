@@ -0,0 +1,727 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_csv.h"
+#include "bstring_search.h"
+#include "bstring_threads.h"
+#include <errno.h>
+#include <string.h>
+
+// Bytes read from a file at a time. A record longer than the buffer grows it.
+#define BSTRING_CSV_BLOCK (1 << 20)
+// Bytes read per thread when parsing is split between threads, for at most
+// BSTRING_CSV_MAX_BLOCKS threads' worth, and the smallest byte range given a
+// thread of its own.
+#define BSTRING_CSV_THREAD_BLOCK (4 << 20)
+#define BSTRING_CSV_MAX_BLOCKS 64
+#define BSTRING_CSV_PART_MIN (1 << 16)
+
+void BStringCsvParser_init(BStringCsvParser *parser, char delimiter, char quotechar)
+{
+  parser->delimiter = delimiter;
+  parser->quotechar = quotechar;
+  parser->pending_cr = 0;
+  parser->lines = 0;
+  parser->slots = NULL;
+  parser->num_columns = 0;
+  parser->num_kept = 0;
+  parser->matches = NULL;
+  parser->num_matches = 0;
+  parser->skip = 0;
+  parser->limit = -1;
+}
+
+// A parser that only looks for line breaks. The delimiter and quote
+// character are set to line break characters so that the scanner marks
+// nothing else.
+void BStringCsvParser_init_lines(BStringCsvParser *parser)
+{
+  BStringCsvParser_init(parser, '\n', '\r');
+  parser->lines = 1;
+}
+
+int BStringCsvRows_init(BStringCsvRows *rows)
+{
+  rows->num_rows = 0;
+  rows->rows_allocated = 0;
+  rows->row_ends = NULL;
+  rows->fields = BStringArena_new();
+  if (!rows->fields)
+    return -1;
+  // The reader raises when parsing runs out of memory, with or without threads.
+  rows->fields->worker = 1;
+  return 0;
+}
+
+// Empties rows, keeping the buffers for the next block.
+void BStringCsvRows_reset(BStringCsvRows *rows)
+{
+  BStringArena_truncate(rows->fields, 0);
+  rows->num_rows = 0;
+}
+
+void BStringCsvRows_free(BStringCsvRows *rows)
+{
+  BStringArena_free(rows->fields);
+  PyMem_RawFree(rows->row_ends);
+  rows->fields = NULL;
+  rows->row_ends = NULL;
+}
+
+static int BStringCsvRows_add_row(BStringCsvRows *rows, Py_ssize_t row_end)
+{
+  if (rows->num_rows == rows->rows_allocated)
+  {
+    Py_ssize_t allocated = rows->rows_allocated ? rows->rows_allocated * 2 : 256;
+    Py_ssize_t *row_ends = PyMem_RawRealloc(rows->row_ends, allocated * sizeof(Py_ssize_t));
+    if (!row_ends)
+      return -1;
+    rows->row_ends = row_ends;
+    rows->rows_allocated = allocated;
+  }
+  rows->row_ends[rows->num_rows++] = row_end;
+  return 0;
+}
+
+static int BStringCsvRows_end_row(BStringCsvRows *rows)
+{
+  return BStringCsvRows_add_row(rows, rows->fields->count);
+}
+
+// Appends the records of other.
+static int BStringCsvRows_extend(BStringCsvRows *rows, BStringCsvRows *other)
+{
+  Py_ssize_t offset = rows->fields->count;
+  if (BStringArena_extend(rows->fields, other->fields) < 0)
+    return -1;
+  for (Py_ssize_t r = 0; r < other->num_rows; ++r)
+  {
+    if (BStringCsvRows_add_row(rows, offset + other->row_ends[r]) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// --- Parsing ---
+
+// Structural scanning. The bytes that can change the parser state are
+// found 64 at a time: one mask marks the delimiters and line breaks that end
+// an unquoted field, the other the quotes and \r that matter inside quotes.
+// The parser then jumps from mark to mark. Quotes are only special at the
+// start of a field in this dialect, so which regions are quoted is left to
+// the parser rather than derived from the quote mask alone.
+typedef struct {
+    const char *data;
+    Py_ssize_t length;
+    Py_ssize_t base;               // Start of the classified block, or -1.
+    unsigned long long field_marks;
+    unsigned long long quote_marks;
+} BStringCsvScan;
+
+#if defined(BSTRING_RUNTIME_AVX2)
+// Picked by BStringCsv_init() from what the CPU supports.
+static int BStringCsv_avx2 = 0;
+
+static inline BSTRING_TARGET_AVX2 unsigned long long BStringCsv_mask_avx2(__m256i low, __m256i high, char c)
+{
+  __m256i target = _mm256_set1_epi8(c);
+  unsigned int lo = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, target));
+  unsigned int hi = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, target));
+  return lo | ((unsigned long long)hi << 32);
+}
+
+static BSTRING_TARGET_AVX2 void BStringCsv_classify_avx2(BStringCsvScan *scan, BStringCsvParser *parser, const char *block)
+{
+  __m256i low = _mm256_loadu_si256((const __m256i *)block);
+  __m256i high = _mm256_loadu_si256((const __m256i *)(block + 32));
+  unsigned long long cr = BStringCsv_mask_avx2(low, high, '\r');
+  scan->field_marks = BStringCsv_mask_avx2(low, high, parser->delimiter) | BStringCsv_mask_avx2(low, high, '\n') | cr;
+  scan->quote_marks = BStringCsv_mask_avx2(low, high, parser->quotechar) | cr;
+}
+#endif
+
+void BStringCsv_init(void)
+{
+#if defined(BSTRING_RUNTIME_AVX2)
+  BStringCsv_avx2 = BStringSearch_cpu_has_avx2();
+#endif
+}
+
+#if defined(BSTRING_HAVE_SSE2)
+static inline unsigned long long BStringCsv_mask(const __m128i *blocks, char c)
+{
+  __m128i target = _mm_set1_epi8(c);
+  unsigned long long mask = 0;
+  for (int k = 0; k < 4; ++k)
+  {
+    mask |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(blocks[k], target)) << (16 * k);
+  }
+  return mask;
+}
+#endif
+
+static void BStringCsv_classify(BStringCsvScan *scan, BStringCsvParser *parser, Py_ssize_t base)
+{
+  const char *block = scan->data + base;
+  Py_ssize_t size = scan->length - base < 64 ? scan->length - base : 64;
+  scan->base = base;
+#if defined(BSTRING_RUNTIME_AVX2)
+  if (size == 64 && BStringCsv_avx2)
+  {
+    BStringCsv_classify_avx2(scan, parser, block);
+    return;
+  }
+#endif
+#if defined(BSTRING_HAVE_SSE2)
+  if (size == 64)
+  {
+    __m128i blocks[4];
+    for (int k = 0; k < 4; ++k)
+    {
+      blocks[k] = _mm_loadu_si128((const __m128i *)(block + 16 * k));
+    }
+    unsigned long long cr = BStringCsv_mask(blocks, '\r');
+    scan->field_marks = BStringCsv_mask(blocks, parser->delimiter) | BStringCsv_mask(blocks, '\n') | cr;
+    scan->quote_marks = BStringCsv_mask(blocks, parser->quotechar) | cr;
+    return;
+  }
+#endif
+  scan->field_marks = 0;
+  scan->quote_marks = 0;
+  for (Py_ssize_t k = 0; k < size; ++k)
+  {
+    char c = block[k];
+    unsigned long long bit = 1ULL << k;
+    if (c == parser->delimiter || c == '\n' || c == '\r')
+      scan->field_marks |= bit;
+    if (c == parser->quotechar || c == '\r')
+      scan->quote_marks |= bit;
+  }
+}
+
+// The first mark at or after i, or length: a delimiter or line break when
+// quoted is 0, a quote or \r when it is 1.
+static inline Py_ssize_t BStringCsv_next(BStringCsvScan *scan, BStringCsvParser *parser, Py_ssize_t i, int quoted)
+{
+  while (i < scan->length)
+  {
+    Py_ssize_t base = i & ~(Py_ssize_t)63;
+    if (scan->base != base)
+      BStringCsv_classify(scan, parser, base);
+    unsigned long long marks = (quoted ? scan->quote_marks : scan->field_marks) & (~0ULL << (i - base));
+    if (marks)
+      return base + BStringSearch_lowest_bit64(marks);
+    i = base + 64;
+  }
+  return scan->length;
+}
+
+// Appends the quoted field data[start:end) without its quotes: doubled
+// quotes become one and line breaks inside the quotes become \n. Text after
+// the closing quote is kept as it is. The runs between marks are copied
+// whole.
+static int BStringCsv_unquote(BStringCsvScan *scan, BStringCsvParser *parser, BStringArena *fields, Py_ssize_t start, Py_ssize_t end)
+{
+  const char *data = scan->data;
+  char quotechar = parser->quotechar;
+  char *out = BStringArena_append_raw(fields, end - start);
+  if (!out)
+    return -1;
+  Py_ssize_t n = 0;
+  Py_ssize_t k = start + 1;
+  while (k < end)
+  {
+    Py_ssize_t mark = BStringCsv_next(scan, parser, k, 1);
+    if (mark > end)
+      mark = end;
+    memcpy(out + n, data + k, mark - k);
+    n += mark - k;
+    k = mark;
+    if (k == end)
+      break;
+    if (data[k] == '\r')
+    {
+      out[n++] = '\n';
+      k += k + 1 < end && data[k + 1] == '\n' ? 2 : 1;
+    }
+    else if (k + 1 < end && data[k + 1] == quotechar)
+    {
+      out[n++] = quotechar;
+      k += 2;
+    }
+    else
+    {
+      // The closing quote: the rest is kept as it is.
+      memcpy(out + n, data + k + 1, end - k - 1);
+      n += end - k - 1;
+      break;
+    }
+  }
+  BStringArena_truncate_last(fields, n);
+  return 0;
+}
+
+// The position after the line break at end, which ends a record; a \r at the
+// end of the data may be followed by a \n in the next block.
+static inline Py_ssize_t BStringCsv_end_record(BStringCsvParser *parser, BStringCsvScan *scan, Py_ssize_t end)
+{
+  if (end == scan->length)
+    return end;
+  if (scan->data[end] == '\r')
+  {
+    if (end + 1 < scan->length)
+      end += scan->data[end + 1] == '\n';
+    else
+      parser->pending_cr = 1;
+  }
+  return end + 1;
+}
+
+static inline int BStringCsv_keeps(BStringCsvParser *parser, Py_ssize_t column)
+{
+  return !parser->slots || (column < parser->num_columns && parser->slots[column] >= 0);
+}
+
+// Pads a record that ended before its last kept column, and decides whether
+// it is kept: 1 when it is, 0 when it is skipped or fails a condition, -1
+// when memory runs out. A record without fields (an empty line) is neither
+// padded nor matched by any condition.
+static int BStringCsv_accept(BStringCsvParser *parser, BStringArena *fields, Py_ssize_t first_field, int empty)
+{
+  while (parser->slots && !empty && fields->count - first_field < parser->num_kept)
+  {
+    if (BStringArena_append(fields, "", 0) < 0)
+      return -1;
+  }
+  if (parser->skip > 0)
+  {
+    parser->skip--;
+    return 0;
+  }
+  if (empty && parser->num_matches > 0)
+    return 0;
+  for (Py_ssize_t m = 0; m < parser->num_matches; ++m)
+  {
+    const BStringCsvMatch *match = &parser->matches[m];
+    Py_ssize_t length = 0;
+    const char *bytes = "";
+    if (first_field + match->slot < fields->count)
+      bytes = BStringArena_bytes(fields, first_field + match->slot, &length);
+    if (length != match->length || memcmp(bytes, match->value, length) != 0)
+      return 0;
+  }
+  if (parser->limit > 0)
+    parser->limit--;
+  return 1;
+}
+
+// Parses one record from *position. Returns 1 when it is complete, with
+// *position after its line break, 0 when data ends before it does and -1
+// when memory runs out.
+static int BStringCsv_record(BStringCsvParser *parser, BStringCsvScan *scan, int final, Py_ssize_t *position, BStringCsvRows *rows)
+{
+  BStringArena *fields = rows->fields;
+  const char *data = scan->data;
+  Py_ssize_t length = scan->length;
+  char delimiter = parser->delimiter;
+  char quotechar = parser->quotechar;
+  Py_ssize_t i = *position;
+  for (Py_ssize_t column = 0;; ++column)
+  {
+    int keep = BStringCsv_keeps(parser, column);
+    if (i == length)
+    {
+      // The record ends with a delimiter: one more empty field.
+      if (!final)
+        return 0;
+      if (keep && BStringArena_append(fields, "", 0) < 0)
+        return -1;
+      *position = i;
+      return 1;
+    }
+
+    Py_ssize_t end;
+    if (data[i] == quotechar)
+    {
+      Py_ssize_t close = -1;
+      int escaped = 0;
+      Py_ssize_t k = i + 1;
+      for (;;)
+      {
+        k = BStringCsv_next(scan, parser, k, 1);
+        if (k == length)
+        {
+          // An unterminated quote runs to the end of the file.
+          if (!final)
+            return 0;
+          break;
+        }
+        if (data[k] == '\r')
+        {
+          escaped = 1;
+          k++;
+          continue;
+        }
+        if (k + 1 == length && !final)
+          return 0;
+        if (k + 1 < length && data[k + 1] == quotechar)
+        {
+          escaped = 1;
+          k += 2;
+          continue;
+        }
+        close = k;
+        break;
+      }
+      end = close < 0 ? length : BStringCsv_next(scan, parser, close + 1, 0);
+      if (end == length && close >= 0 && !final)
+        return 0;
+      int status = 0;
+      if (keep && close >= 0 && !escaped && end == close + 1)
+        status = BStringArena_append(fields, data + i + 1, close - i - 1);
+      else if (keep)
+        status = BStringCsv_unquote(scan, parser, fields, i, end);
+      if (status < 0)
+        return -1;
+    }
+    else
+    {
+      end = BStringCsv_next(scan, parser, i, 0);
+      if (end == length && !final)
+        return 0;
+      if (keep && BStringArena_append(fields, data + i, end - i) < 0)
+        return -1;
+    }
+
+    if (end < length && data[end] == delimiter)
+    {
+      i = end + 1;
+      continue;
+    }
+    *position = BStringCsv_end_record(parser, scan, end);
+    return 1;
+  }
+}
+
+// Parses one line from *position as a record with one field, like
+// BStringCsv_record().
+static int BStringCsv_line(BStringCsvParser *parser, BStringCsvScan *scan, int final, Py_ssize_t *position, BStringCsvRows *rows)
+{
+  Py_ssize_t end = BStringCsv_next(scan, parser, *position, 0);
+  if (end == scan->length && !final)
+    return 0;
+  if (BStringArena_append(rows->fields, scan->data + *position, end - *position) < 0)
+    return -1;
+  *position = BStringCsv_end_record(parser, scan, end);
+  return 1;
+}
+
+// Parses the records of data that start in [start, stop). Returns where
+// parsing stopped: at or after stop, or at the start of a record that data
+// ends before, or -1 when memory runs out.
+static Py_ssize_t BStringCsv_parse_range(BStringCsvParser *parser, const char *data, Py_ssize_t start, Py_ssize_t stop,
+                                         Py_ssize_t length, int final, BStringCsvRows *rows)
+{
+  BStringCsvScan scan = {data, length, -1, 0, 0};
+  Py_ssize_t i = start;
+  while (i < stop && parser->limit != 0)
+  {
+    if (parser->pending_cr)
+    {
+      parser->pending_cr = 0;
+      if (data[i] == '\n')
+      {
+        i++;
+        continue;
+      }
+    }
+    Py_ssize_t record_start = i;
+    Py_ssize_t first_field = rows->fields->count;
+    int empty = 0;
+    int status;
+    if (parser->lines)
+    {
+      status = BStringCsv_line(parser, &scan, final, &i, rows);
+    }
+    else if (data[i] == '\n' || data[i] == '\r')
+    {
+      // An empty line: a record without fields.
+      if (data[i] == '\r')
+      {
+        if (i + 1 < length)
+          i += data[i + 1] == '\n';
+        else
+          parser->pending_cr = 1;
+      }
+      i++;
+      empty = 1;
+      status = 1;
+    }
+    else
+    {
+      status = BStringCsv_record(parser, &scan, final, &i, rows);
+    }
+    if (status > 0)
+    {
+      int kept = BStringCsv_accept(parser, rows->fields, first_field, empty);
+      if (kept > 0)
+        status = BStringCsvRows_end_row(rows) < 0 ? -1 : 1;
+      else if (kept == 0)
+        BStringArena_truncate(rows->fields, first_field);
+      else
+        status = -1;
+    }
+    if (status < 0)
+      return -1;
+    if (status == 0)
+    {
+      // Parsed again once more data has been read.
+      BStringArena_truncate(rows->fields, first_field);
+      return record_start;
+    }
+  }
+  return i;
+}
+
+Py_ssize_t BStringCsv_parse(BStringCsvParser *parser, const char *data, Py_ssize_t length, int final, BStringCsvRows *rows)
+{
+  return BStringCsv_parse_range(parser, data, 0, length, length, final, rows);
+}
+
+// --- Parsing in parallel ---
+
+// One byte range of a block, parsed by one thread. The ranges after the
+// first start after a line break, which is only a guess for CSV: the line
+// break may be inside quotes. A range is kept when the range before it ended
+// exactly where it starts, and parsed again from there otherwise.
+typedef struct {
+    BStringCsvParser parser;
+    const char *data;
+    Py_ssize_t length;
+    int final;
+    Py_ssize_t start;
+    Py_ssize_t stop;               // Records from here on belong to the next range.
+    Py_ssize_t end;                // Where parsing stopped, or -1.
+    BStringCsvRows *rows;
+} BStringCsvPart;
+
+static void BStringCsv_parse_part(void *arg, Py_ssize_t p)
+{
+  BStringCsvPart *part = (BStringCsvPart *)arg + p;
+  part->end = BStringCsv_parse_range(&part->parser, part->data, part->start, part->stop, part->length, part->final, part->rows);
+}
+
+// The position after the first line break at or after i, or length.
+static Py_ssize_t BStringCsv_line_start(const char *data, Py_ssize_t length, Py_ssize_t i)
+{
+  for (; i < length; ++i)
+  {
+    if (data[i] == '\n')
+      return i + 1;
+    if (data[i] == '\r')
+      return i + 1 < length && data[i + 1] == '\n' ? i + 2 : i + 1;
+  }
+  return length;
+}
+
+// Parses data into rows with up to threads threads and returns the bytes the
+// complete records take, or -1 when memory runs out. The ranges are parsed
+// without the GIL and their records appended to rows in order.
+static Py_ssize_t BStringCsv_parse_parallel(BStringCsvParser *parser, const char *data, Py_ssize_t length, int final,
+                                            BStringCsvRows *rows, BStringCsvRows *part_rows, int threads)
+{
+  Py_ssize_t num_parts = length / BSTRING_CSV_PART_MIN;
+  if (num_parts > threads)
+    num_parts = threads;
+  // Skipping and limits count records in file order, so they are applied
+  // on one thread.
+  if (num_parts <= 1 || parser->skip > 0 || parser->limit >= 0)
+    return BStringCsv_parse(parser, data, length, final, rows);
+  BStringCsvPart *parts = PyMem_Malloc(num_parts * sizeof(BStringCsvPart));
+  if (!parts)
+    return -1;
+
+  Py_ssize_t start = 0;
+  for (Py_ssize_t p = 0; p < num_parts; ++p)
+  {
+    BStringCsvPart *part = &parts[p];
+    part->parser = *parser;
+    part->data = data;
+    part->length = length;
+    part->rows = p == 0 ? rows : &part_rows[p - 1];
+    if (p > 0)
+    {
+      Py_ssize_t guess = BStringCsv_line_start(data, length, length * p / num_parts);
+      start = guess > start ? guess : start;
+      part->parser.pending_cr = 0;
+      BStringCsvRows_reset(part->rows);
+    }
+    part->start = start;
+  }
+  for (Py_ssize_t p = 0; p < num_parts; ++p)
+  {
+    parts[p].stop = p + 1 < num_parts ? parts[p + 1].start : length;
+    parts[p].final = final && parts[p].stop == length;
+  }
+  BStringThreads_run(BStringCsv_parse_part, parts, num_parts);
+
+  Py_ssize_t consumed = parts[0].end;
+  BStringCsvParser *state = &parts[0].parser;
+  for (Py_ssize_t p = 1; consumed >= 0 && p < num_parts; ++p)
+  {
+    BStringCsvPart *part = &parts[p];
+    // A range that ends with an incomplete record ends the block.
+    if (consumed < parts[p - 1].stop)
+      break;
+    if (part->start != consumed)
+    {
+      BStringCsvRows_reset(part->rows);
+      part->parser = *state;
+      part->start = consumed;
+      BStringThreads_run(BStringCsv_parse_part, part, 1);
+    }
+    consumed = part->end;
+    state = &part->parser;
+    if (consumed >= 0 && BStringCsvRows_extend(rows, part->rows) < 0)
+      consumed = -1;
+  }
+  if (consumed >= 0)
+    *parser = *state;
+  PyMem_Free(parts);
+  return consumed;
+}
+
+// --- Reading files ---
+
+int BStringCsvReader_open(BStringCsvReader *reader, const char *filepath, BStringCsvParser *parser, int threads)
+{
+  reader->filepath = filepath;
+  reader->start = 0;
+  reader->end = 0;
+  reader->eof = 0;
+  reader->parser = *parser;
+  reader->threads = threads;
+  reader->part_rows = NULL;
+  reader->file = NULL;
+  if (threads > 1)
+    reader->allocated = (Py_ssize_t)BSTRING_CSV_THREAD_BLOCK * (threads < BSTRING_CSV_MAX_BLOCKS ? threads : BSTRING_CSV_MAX_BLOCKS);
+  else
+    reader->allocated = BSTRING_CSV_BLOCK;
+  reader->buffer = PyMem_Malloc(reader->allocated);
+  if (!reader->buffer)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  if (threads > 1)
+  {
+    reader->part_rows = PyMem_Calloc(threads - 1, sizeof(BStringCsvRows));
+    if (!reader->part_rows)
+    {
+      PyErr_NoMemory();
+      BStringCsvReader_close(reader);
+      return -1;
+    }
+    for (int p = 0; p < threads - 1; ++p)
+    {
+      if (BStringCsvRows_init(&reader->part_rows[p]) < 0)
+      {
+        BStringCsvReader_close(reader);
+        return -1;
+      }
+    }
+  }
+  reader->file = fopen(filepath, "rb");
+  if (!reader->file)
+  {
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, filepath);
+    BStringCsvReader_close(reader);
+    return -1;
+  }
+  return 0;
+}
+
+void BStringCsvReader_close(BStringCsvReader *reader)
+{
+  if (reader->file)
+    fclose(reader->file);
+  PyMem_Free(reader->buffer);
+  if (reader->part_rows)
+  {
+    for (int p = 0; p < reader->threads - 1; ++p)
+    {
+      BStringCsvRows_free(&reader->part_rows[p]);
+    }
+    PyMem_Free(reader->part_rows);
+  }
+  reader->file = NULL;
+  reader->buffer = NULL;
+  reader->part_rows = NULL;
+}
+
+// Moves the unparsed bytes to the front of the buffer, grows it when they
+// fill it, and reads more after them.
+static int BStringCsvReader_fill(BStringCsvReader *reader)
+{
+  Py_ssize_t pending = reader->end - reader->start;
+  memmove(reader->buffer, reader->buffer + reader->start, pending);
+  reader->start = 0;
+  reader->end = pending;
+  if (pending > reader->allocated / 2)
+  {
+    char *buffer = PyMem_Realloc(reader->buffer, reader->allocated * 2);
+    if (!buffer)
+    {
+      PyErr_NoMemory();
+      return -1;
+    }
+    reader->buffer = buffer;
+    reader->allocated *= 2;
+  }
+  size_t wanted = (size_t)(reader->allocated - reader->end);
+  size_t got = fread(reader->buffer + reader->end, 1, wanted, reader->file);
+  reader->end += got;
+  if (got < wanted)
+  {
+    if (ferror(reader->file))
+    {
+      errno = errno ? errno : EIO;
+      PyErr_SetFromErrnoWithFilename(PyExc_IOError, reader->filepath);
+      return -1;
+    }
+    reader->eof = 1;
+  }
+  return 0;
+}
+
+int BStringCsvReader_read(BStringCsvReader *reader, BStringCsvRows *rows)
+{
+  for (;;)
+  {
+    if (reader->parser.limit == 0)
+      return 0;
+    if (reader->start < reader->end)
+    {
+      Py_ssize_t consumed = BStringCsv_parse_parallel(&reader->parser, reader->buffer + reader->start,
+                                                      reader->end - reader->start, reader->eof, rows,
+                                                      reader->part_rows, reader->threads);
+      if (consumed < 0)
+      {
+        PyErr_NoMemory();
+        return -1;
+      }
+      reader->start += consumed;
+      if (rows->num_rows > 0)
+        return 1;
+    }
+    if (reader->eof)
+      return 0;
+    if (BStringCsvReader_fill(reader) < 0)
+      return -1;
+  }
+}
@@ -0,0 +1,124 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_CSV_H
+#define BSTRING_CSV_H
+
+#include "bstring.h"
+#include "bstring_arena.h"
+#include <stdio.h>
+
+// CSV reading in C. The dialect is the one the csv module reads from a file
+// opened in text mode: fields are separated by the delimiter, and a field
+// that starts with the quote character may hold delimiters, line breaks and
+// doubled quotes. \r\n, \r and \n all end a record, and a line break inside
+// quotes is read as \n. A quote anywhere else is an ordinary character, and
+// so is text after a closing quote. An unterminated quote runs to the end of
+// the file. An empty line is a record without fields.
+//
+// The same parser splits plain text files into lines: every line, empty ones
+// included, is a record with one field.
+
+// A where= condition: the field at offset slot of a record must equal value.
+typedef struct {
+    Py_ssize_t slot;
+    const char *value;             // UTF-8, owned by the caller.
+    Py_ssize_t length;
+} BStringCsvMatch;
+
+// Parser settings and the state carried from one block to the next.
+typedef struct {
+    char delimiter;
+    char quotechar;
+    int pending_cr;                // The last record ended with \r: a \n that follows belongs to it.
+    int lines;                     // Plain lines: no delimiter and no quotes.
+    // Which fields and records are kept, set by the caller; the arrays are
+    // owned by the caller. Without slots every field is kept. With them
+    // only the columns that have a slot are, in column order, and a record
+    // that ends before one of them gets an empty field for it. An empty
+    // line stays a record without fields and meets no condition.
+    const Py_ssize_t *slots;       // slots[c]: offset of column c among the kept fields, or -1.
+    Py_ssize_t num_columns;        // Entries in slots; later columns are dropped.
+    Py_ssize_t num_kept;
+    const BStringCsvMatch *matches;  // Conditions every kept record meets. A missing field is empty.
+    Py_ssize_t num_matches;
+    Py_ssize_t skip;               // Records still to drop before the conditions are checked.
+    Py_ssize_t limit;              // Records still to keep, or -1 without a limit.
+} BStringCsvParser;
+
+// Parsed records: the unescaped UTF-8 bytes of every field, one arena item
+// per field, and where each record ends. The buffers come from the raw
+// allocator, so that worker threads can fill them without the GIL.
+typedef struct {
+    BStringArena *fields;
+    Py_ssize_t *row_ends;          // row_ends[r]: index one past the last field of record r.
+    Py_ssize_t num_rows;
+    Py_ssize_t rows_allocated;
+} BStringCsvRows;
+
+// Picks the structural scanning kernel for this CPU. Called once when the
+// module is loaded.
+void BStringCsv_init(void);
+
+void BStringCsvParser_init(BStringCsvParser *parser, char delimiter, char quotechar);
+void BStringCsvParser_init_lines(BStringCsvParser *parser);
+
+int BStringCsvRows_init(BStringCsvRows *rows);
+void BStringCsvRows_reset(BStringCsvRows *rows);
+void BStringCsvRows_free(BStringCsvRows *rows);
+
+static inline Py_ssize_t BStringCsvRows_first_field(BStringCsvRows *rows, Py_ssize_t row)
+{
+  return row > 0 ? rows->row_ends[row - 1] : 0;
+}
+
+// Parses the complete records at the start of data into rows and returns the
+// number of bytes they take, or -1 when memory runs out. With final set the
+// end of data also ends the last record.
+Py_ssize_t BStringCsv_parse(BStringCsvParser *parser, const char *data, Py_ssize_t length, int final, BStringCsvRows *rows);
+
+// Reads a CSV file in large blocks. With more than one thread a block is
+// split into byte ranges that are parsed at the same time without the GIL.
+typedef struct {
+    FILE *file;
+    const char *filepath;
+    char *buffer;
+    Py_ssize_t start;              // First byte not parsed yet.
+    Py_ssize_t end;                // End of the bytes read so far.
+    Py_ssize_t allocated;
+    int eof;
+    BStringCsvParser parser;
+    int threads;
+    BStringCsvRows *part_rows;     // Records of the byte ranges after the first, threads - 1 of them.
+} BStringCsvReader;
+
+int BStringCsvReader_open(BStringCsvReader *reader, const char *filepath, BStringCsvParser *parser, int threads);
+void BStringCsvReader_close(BStringCsvReader *reader);
+
+// Parses the records of the next block into rows: 1 when there are some, 0 at
+// the end of the file or once parser.limit records are kept, -1 with an
+// exception set.
+int BStringCsvReader_read(BStringCsvReader *reader, BStringCsvRows *rows);
+
+// The iterator BString.iter_csv() returns. It reads the file through one
+// reader and one set of row buffers, a batch of rows at a time.
+typedef struct {
+    PyObject_HEAD
+    PyTypeObject *row_type;        // The class the rows are created as.
+    char *filepath;                // A copy that reader.filepath points to.
+    BStringCsvReader reader;
+    BStringCsvRows rows;
+    Py_ssize_t next_row;           // First record in rows not yielded yet.
+    Py_ssize_t batch_size;
+    PyObject *header;              // The header row, NULL until it is read, or None.
+    int done;                      // The file is closed.
+} BStringCsvIterObject;
+
+extern PyTypeObject BStringCsvIter_Type;
+
+#endif // BSTRING_CSV_H
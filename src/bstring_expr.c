@@ -0,0 +1,540 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_expr.h"
+#include <string.h>
+
+enum {
+  BSTRING_EXPR_AND,
+  BSTRING_EXPR_OR,
+  BSTRING_EXPR_NOT,
+  BSTRING_EXPR_LENGTH,
+  BSTRING_EXPR_CONTAINS,
+  BSTRING_EXPR_EQUALS,
+  BSTRING_EXPR_KERNEL
+};
+
+enum {
+  BSTRING_EXPR_LT,
+  BSTRING_EXPR_LE,
+  BSTRING_EXPR_GT,
+  BSTRING_EXPR_GE,
+  BSTRING_EXPR_EQ,
+  BSTRING_EXPR_NE
+};
+
+// Nesting allowed in parentheses and not chains before the parser gives up.
+#define BSTRING_EXPR_MAX_DEPTH 200
+
+typedef struct {
+    BStringExprObject *expr;
+    const char *text;
+    Py_ssize_t length;
+    Py_ssize_t pos;
+    int depth;
+} BStringExprParser;
+
+static Py_ssize_t BStringExpr_parse_or(BStringExprParser *parser);
+
+static Py_ssize_t BStringExpr_error(BStringExprParser *parser, const char *message)
+{
+  PyErr_Format(PyExc_ValueError, "filter expression: %s at position %zd", message, parser->pos);
+  return -1;
+}
+
+static void BStringExpr_skip_space(BStringExprParser *parser)
+{
+  while (parser->pos < parser->length && Py_ISSPACE(parser->text[parser->pos]))
+    parser->pos++;
+}
+
+// Consumes token when it comes next. Words must not run on into a name.
+static int BStringExpr_accept(BStringExprParser *parser, const char *token)
+{
+  BStringExpr_skip_space(parser);
+  size_t length = strlen(token);
+  if (parser->pos + (Py_ssize_t)length > parser->length || memcmp(parser->text + parser->pos, token, length) != 0)
+    return 0;
+  if (Py_ISALPHA(token[0]))
+  {
+    char next = parser->pos + (Py_ssize_t)length < parser->length ? parser->text[parser->pos + length] : 0;
+    if (Py_ISALNUM(next) || next == '_')
+      return 0;
+  }
+  parser->pos += length;
+  return 1;
+}
+
+static Py_ssize_t BStringExpr_add_node(BStringExprParser *parser, int op)
+{
+  BStringExprObject *expr = parser->expr;
+  if (expr->num_nodes == expr->nodes_allocated)
+  {
+    Py_ssize_t allocated = expr->nodes_allocated ? expr->nodes_allocated * 2 : 8;
+    BStringExprNode *nodes = PyMem_Realloc(expr->nodes, allocated * sizeof(BStringExprNode));
+    if (!nodes)
+    {
+      PyErr_NoMemory();
+      return -1;
+    }
+    expr->nodes = nodes;
+    expr->nodes_allocated = allocated;
+  }
+  BStringExprNode *node = &expr->nodes[expr->num_nodes];
+  memset(node, 0, sizeof(*node));
+  node->op = op;
+  node->left = node->right = -1;
+  return expr->num_nodes++;
+}
+
+static Py_ssize_t BStringExpr_add_operator(BStringExprParser *parser, int op, Py_ssize_t left, Py_ssize_t right)
+{
+  Py_ssize_t index = BStringExpr_add_node(parser, op);
+  if (index >= 0)
+  {
+    parser->expr->nodes[index].left = left;
+    parser->expr->nodes[index].right = right;
+  }
+  return index;
+}
+
+// Reads a quoted string literal into a new str.
+static PyObject *BStringExpr_parse_string(BStringExprParser *parser)
+{
+  BStringExpr_skip_space(parser);
+  if (parser->pos >= parser->length || (parser->text[parser->pos] != '\'' && parser->text[parser->pos] != '"'))
+  {
+    BStringExpr_error(parser, "expected a quoted string");
+    return NULL;
+  }
+  char quote = parser->text[parser->pos++];
+  char *buffer = PyMem_Malloc(parser->length - parser->pos + 1);
+  if (!buffer)
+    return PyErr_NoMemory();
+  Py_ssize_t used = 0;
+  while (parser->pos < parser->length && parser->text[parser->pos] != quote)
+  {
+    char ch = parser->text[parser->pos++];
+    if (ch == '\\' && parser->pos < parser->length)
+    {
+      ch = parser->text[parser->pos++];
+      if (ch == 'n')
+        ch = '\n';
+      else if (ch == 't')
+        ch = '\t';
+      else if (ch == 'r')
+        ch = '\r';
+    }
+    buffer[used++] = ch;
+  }
+  if (parser->pos >= parser->length)
+  {
+    PyMem_Free(buffer);
+    BStringExpr_error(parser, "unterminated string");
+    return NULL;
+  }
+  parser->pos++;
+  PyObject *text = PyUnicode_DecodeUTF8(buffer, used, "strict");
+  PyMem_Free(buffer);
+  return text;
+}
+
+static Py_ssize_t BStringExpr_parse_length(BStringExprParser *parser)
+{
+  static const struct {
+    const char *token;
+    int compare;
+  } operators[] = {
+      {"<=", BSTRING_EXPR_LE}, {">=", BSTRING_EXPR_GE}, {"==", BSTRING_EXPR_EQ},
+      {"!=", BSTRING_EXPR_NE}, {"<", BSTRING_EXPR_LT}, {">", BSTRING_EXPR_GT},
+  };
+  int compare = -1;
+  for (size_t i = 0; compare < 0 && i < sizeof(operators) / sizeof(operators[0]); ++i)
+  {
+    if (BStringExpr_accept(parser, operators[i].token))
+      compare = operators[i].compare;
+  }
+  if (compare < 0)
+    return BStringExpr_error(parser, "expected a comparison after len");
+
+  BStringExpr_skip_space(parser);
+  Py_ssize_t start = parser->pos;
+  Py_ssize_t number = 0;
+  while (parser->pos < parser->length && Py_ISDIGIT(parser->text[parser->pos]))
+  {
+    if (number > (PY_SSIZE_T_MAX - 9) / 10)
+      return BStringExpr_error(parser, "number too large");
+    number = number * 10 + (parser->text[parser->pos++] - '0');
+  }
+  if (parser->pos == start)
+    return BStringExpr_error(parser, "expected a number");
+
+  Py_ssize_t index = BStringExpr_add_node(parser, BSTRING_EXPR_LENGTH);
+  if (index >= 0)
+  {
+    parser->expr->nodes[index].compare = compare;
+    parser->expr->nodes[index].number = number;
+  }
+  return index;
+}
+
+// A named test, with its string argument when it takes one.
+static Py_ssize_t BStringExpr_parse_test(BStringExprParser *parser)
+{
+  BStringExpr_skip_space(parser);
+  Py_ssize_t start = parser->pos;
+  while (parser->pos < parser->length && (Py_ISALNUM(parser->text[parser->pos]) || parser->text[parser->pos] == '_'))
+    parser->pos++;
+  if (parser->pos == start)
+    return BStringExpr_error(parser, "expected a test");
+  PyObject *name = PyUnicode_FromStringAndSize(parser->text + start, parser->pos - start);
+  if (!name)
+    return -1;
+
+  static const char *const string_tests[] = {"contains", "icontains", "startswith", "endswith", "equals"};
+  int takes_string = 0;
+  for (size_t i = 0; i < sizeof(string_tests) / sizeof(string_tests[0]); ++i)
+  {
+    takes_string |= PyUnicode_CompareWithASCIIString(name, string_tests[i]) == 0;
+  }
+  PyObject *text = NULL;
+  if (takes_string)
+  {
+    if (!BStringExpr_accept(parser, "("))
+    {
+      Py_DECREF(name);
+      return BStringExpr_error(parser, "expected '('");
+    }
+    text = BStringExpr_parse_string(parser);
+    if (!text || !BStringExpr_accept(parser, ")"))
+    {
+      Py_DECREF(name);
+      if (!text)
+        return -1;
+      Py_DECREF(text);
+      return BStringExpr_error(parser, "expected ')'");
+    }
+  }
+  else if (BStringExpr_accept(parser, "(") && !BStringExpr_accept(parser, ")"))
+  {
+    Py_DECREF(name);
+    return BStringExpr_error(parser, "expected ')'");
+  }
+
+  int op = BSTRING_EXPR_KERNEL;
+  if (PyUnicode_CompareWithASCIIString(name, "contains") == 0 || PyUnicode_CompareWithASCIIString(name, "icontains") == 0)
+    op = BSTRING_EXPR_CONTAINS;
+  else if (PyUnicode_CompareWithASCIIString(name, "equals") == 0)
+    op = BSTRING_EXPR_EQUALS;
+  Py_ssize_t index = BStringExpr_add_node(parser, op);
+  if (index < 0)
+  {
+    Py_DECREF(name);
+    Py_XDECREF(text);
+    return -1;
+  }
+  BStringExprNode *node = &parser->expr->nodes[index];
+  node->name = name;
+  node->text = text;
+
+  int status = 0;
+  if (op == BSTRING_EXPR_CONTAINS)
+  {
+    status = BStringNeedle_init(&node->needle, text, PyUnicode_READ_CHAR(name, 0) != 'i');
+  }
+  else if (op == BSTRING_EXPR_EQUALS)
+  {
+    node->utf8 = PyUnicode_AsUTF8AndSize(text, &node->utf8_length);
+    status = node->utf8 ? 0 : -1;
+  }
+  else
+  {
+    status = BStringKernel_init_test(&node->kernel, name, text ? &node->text : NULL, text ? 1 : 0);
+    if (status == 0)
+    {
+      PyErr_Format(PyExc_ValueError, "filter expression: unknown test '%U' at position %zd", name, start);
+      status = -1;
+    }
+    else if (status > 0)
+    {
+      status = 0;
+    }
+  }
+  return status < 0 ? -1 : index;
+}
+
+static Py_ssize_t BStringExpr_parse_not(BStringExprParser *parser)
+{
+  if (++parser->depth > BSTRING_EXPR_MAX_DEPTH)
+    return BStringExpr_error(parser, "expression nested too deeply");
+  Py_ssize_t index;
+  if (BStringExpr_accept(parser, "not"))
+  {
+    Py_ssize_t operand = BStringExpr_parse_not(parser);
+    index = operand < 0 ? -1 : BStringExpr_add_operator(parser, BSTRING_EXPR_NOT, operand, -1);
+  }
+  else if (BStringExpr_accept(parser, "("))
+  {
+    index = BStringExpr_parse_or(parser);
+    if (index >= 0 && !BStringExpr_accept(parser, ")"))
+      index = BStringExpr_error(parser, "expected ')'");
+  }
+  else if (BStringExpr_accept(parser, "len"))
+  {
+    index = BStringExpr_parse_length(parser);
+  }
+  else
+  {
+    index = BStringExpr_parse_test(parser);
+  }
+  parser->depth--;
+  return index;
+}
+
+// Parses operand (keyword operand)* into a right-leaning chain, so that the
+// evaluator walks long chains in a loop rather than by recursion.
+static Py_ssize_t BStringExpr_parse_chain(BStringExprParser *parser, int op, const char *keyword, Py_ssize_t (*parse_operand)(BStringExprParser *))
+{
+  Py_ssize_t first = parse_operand(parser);
+  if (first < 0 || !BStringExpr_accept(parser, keyword))
+    return first;
+
+  Py_ssize_t num_operands = 1;
+  Py_ssize_t allocated = 8;
+  Py_ssize_t *operands = PyMem_Malloc(allocated * sizeof(Py_ssize_t));
+  if (!operands)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  operands[0] = first;
+  Py_ssize_t chain = 0;
+  do
+  {
+    if (num_operands == allocated)
+    {
+      allocated *= 2;
+      Py_ssize_t *grown = PyMem_Realloc(operands, allocated * sizeof(Py_ssize_t));
+      if (!grown)
+      {
+        PyErr_NoMemory();
+        chain = -1;
+        break;
+      }
+      operands = grown;
+    }
+    operands[num_operands] = parse_operand(parser);
+    if (operands[num_operands++] < 0)
+    {
+      chain = -1;
+      break;
+    }
+  } while (BStringExpr_accept(parser, keyword));
+
+  if (chain == 0)
+  {
+    chain = operands[num_operands - 1];
+    for (Py_ssize_t i = num_operands - 2; chain >= 0 && i >= 0; --i)
+    {
+      chain = BStringExpr_add_operator(parser, op, operands[i], chain);
+    }
+  }
+  PyMem_Free(operands);
+  return chain;
+}
+
+static Py_ssize_t BStringExpr_parse_and(BStringExprParser *parser)
+{
+  return BStringExpr_parse_chain(parser, BSTRING_EXPR_AND, "and", BStringExpr_parse_not);
+}
+
+static Py_ssize_t BStringExpr_parse_or(BStringExprParser *parser)
+{
+  return BStringExpr_parse_chain(parser, BSTRING_EXPR_OR, "or", BStringExpr_parse_and);
+}
+
+PyObject *BStringExpr_compile(PyObject *source)
+{
+  if (!PyUnicode_Check(source))
+  {
+    PyErr_SetString(PyExc_TypeError, "filter expression must be a string");
+    return NULL;
+  }
+  Py_ssize_t length;
+  const char *text = PyUnicode_AsUTF8AndSize(source, &length);
+  if (!text)
+    return NULL;
+
+  BStringExprObject *self = PyObject_New(BStringExprObject, &BStringExpr_Type);
+  if (!self)
+    return NULL;
+  Py_INCREF(source);
+  self->source = source;
+  self->nodes = NULL;
+  self->num_nodes = 0;
+  self->nodes_allocated = 0;
+
+  BStringExprParser parser = {self, text, length, 0, 0};
+  self->root = BStringExpr_parse_or(&parser);
+  if (self->root >= 0)
+  {
+    BStringExpr_skip_space(&parser);
+    if (parser.pos < parser.length)
+      self->root = BStringExpr_error(&parser, "unexpected text");
+  }
+  if (self->root < 0)
+  {
+    Py_DECREF(self);
+    return NULL;
+  }
+  return (PyObject *)self;
+}
+
+// Length of UTF-8 text in code points: the bytes that do not continue one.
+static Py_ssize_t BStringExpr_count_characters(const char *bytes, Py_ssize_t length)
+{
+  Py_ssize_t characters = 0;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    characters += ((unsigned char)bytes[i] & 0xC0) != 0x80;
+  }
+  return characters;
+}
+
+// characters is the length in code points, or -1 until a len test needs it.
+// The right operands of and/or are followed in a loop (see parse_chain).
+static int BStringExpr_eval(BStringExprObject *self, Py_ssize_t index, const char *bytes, Py_ssize_t length, Py_ssize_t *characters)
+{
+  for (;;)
+  {
+    BStringExprNode *node = &self->nodes[index];
+    int result;
+    switch (node->op)
+    {
+    case BSTRING_EXPR_AND:
+      result = BStringExpr_eval(self, node->left, bytes, length, characters);
+      if (result <= 0)
+        return result;
+      index = node->right;
+      break;
+    case BSTRING_EXPR_OR:
+      result = BStringExpr_eval(self, node->left, bytes, length, characters);
+      if (result != 0)
+        return result;
+      index = node->right;
+      break;
+    case BSTRING_EXPR_NOT:
+      result = BStringExpr_eval(self, node->left, bytes, length, characters);
+      return result < 0 ? result : !result;
+    case BSTRING_EXPR_LENGTH:
+      if (*characters < 0)
+        *characters = BStringExpr_count_characters(bytes, length);
+      switch (node->compare)
+      {
+      case BSTRING_EXPR_LT:
+        return *characters < node->number;
+      case BSTRING_EXPR_LE:
+        return *characters <= node->number;
+      case BSTRING_EXPR_GT:
+        return *characters > node->number;
+      case BSTRING_EXPR_GE:
+        return *characters >= node->number;
+      case BSTRING_EXPR_EQ:
+        return *characters == node->number;
+      default:
+        return *characters != node->number;
+      }
+    case BSTRING_EXPR_CONTAINS:
+      return BStringNeedle_search_utf8(&node->needle, bytes, length);
+    case BSTRING_EXPR_EQUALS:
+      return length == node->utf8_length && memcmp(bytes, node->utf8, length) == 0;
+    default:
+      return BStringKernel_test_utf8(&node->kernel, bytes, length);
+    }
+  }
+}
+
+int BStringExpr_match_utf8(BStringExprObject *self, const char *bytes, Py_ssize_t length)
+{
+  Py_ssize_t characters = -1;
+  return BStringExpr_eval(self, self->root, bytes, length, &characters);
+}
+
+// ASCII strings are evaluated in place; others through a temporary UTF-8
+// copy, so that the item does not keep a cached one.
+int BStringExpr_match(BStringExprObject *self, PyObject *item)
+{
+  Py_ssize_t characters = PyUnicode_GET_LENGTH(item);
+  if (PyUnicode_IS_ASCII(item))
+    return BStringExpr_eval(self, self->root, (const char *)PyUnicode_DATA(item), characters, &characters);
+  PyObject *encoded = PyUnicode_AsUTF8String(item);
+  if (!encoded)
+    return -1;
+  int result = BStringExpr_eval(self, self->root, PyBytes_AS_STRING(encoded), PyBytes_GET_SIZE(encoded), &characters);
+  Py_DECREF(encoded);
+  return result;
+}
+
+static PyObject *BStringExpr_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  PyObject *source;
+  static char *kwlist[] = {"expression", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "U", kwlist, &source))
+  {
+    return NULL;
+  }
+  return BStringExpr_compile(source);
+}
+
+static void BStringExpr_dealloc(BStringExprObject *self)
+{
+  for (Py_ssize_t i = 0; i < self->num_nodes; ++i)
+  {
+    BStringExprNode *node = &self->nodes[i];
+    if (node->op == BSTRING_EXPR_CONTAINS)
+      BStringNeedle_clear(&node->needle);
+    else if (node->op == BSTRING_EXPR_KERNEL)
+      BStringKernel_clear(&node->kernel);
+    Py_XDECREF(node->name);
+    Py_XDECREF(node->text);
+  }
+  PyMem_Free(self->nodes);
+  Py_XDECREF(self->source);
+  PyObject_Del(self);
+}
+
+static PyObject *BStringExpr_get_expression(BStringExprObject *self, void *closure)
+{
+  Py_INCREF(self->source);
+  return self->source;
+}
+
+static PyObject *BStringExpr_repr(BStringExprObject *self)
+{
+  return PyUnicode_FromFormat("BStringExpr(%R)", self->source);
+}
+
+static PyGetSetDef BStringExpr_getsetters[] =
+{
+    {"expression", (getter)BStringExpr_get_expression, NULL, "The expression as written (read-only).", NULL},
+    {NULL} /* Sentinel */
+};
+
+PyTypeObject BStringExpr_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "BeautifulString.BStringExpr",
+    .tp_doc = "BStringExpr(expression)\n\nA filter expression compiled once for BString.filter_expr(), e.g.\n"
+              "\"startswith('ERR') and len > 20 and not contains('debug')\".",
+    .tp_basicsize = sizeof(BStringExprObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = BStringExpr_new,
+    .tp_dealloc = (destructor)BStringExpr_dealloc,
+    .tp_repr = (reprfunc)BStringExpr_repr,
+    .tp_getset = BStringExpr_getsetters,
+};
@@ -0,0 +1,59 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_EXPR_H
+#define BSTRING_EXPR_H
+
+#include "bstring.h"
+#include "bstring_kernels.h"
+#include "bstring_search.h"
+
+// A filter expression compiled into a tree of nodes that is evaluated on the
+// UTF-8 bytes of each string:
+//
+//   expr   := term ('or' term)*
+//   term   := factor ('and' factor)*
+//   factor := 'not' factor | '(' expr ')' | 'len' op NUMBER | test
+//   test   := contains(S) | icontains(S) | startswith(S) | endswith(S)
+//           | equals(S) | isdigit | isalpha | ... (optionally followed by '()')
+//   op     := '<' | '<=' | '>' | '>=' | '==' | '!='
+//
+// S is a string literal in single or double quotes with backslash escapes.
+typedef struct {
+    int op;                        // BSTRING_EXPR_* in bstring_expr.c.
+    Py_ssize_t left;               // Operands of and, or, not.
+    Py_ssize_t right;
+    int compare;                   // len comparison operator.
+    Py_ssize_t number;             // len comparison operand.
+    PyObject *name;                // Test name and string argument (strong references).
+    PyObject *text;
+    const char *utf8;              // text as UTF-8, for equals().
+    Py_ssize_t utf8_length;
+    BStringNeedle needle;          // contains(), icontains().
+    BStringKernel kernel;          // startswith(), endswith() and the is*() tests.
+} BStringExprNode;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *source;              // The expression as written.
+    BStringExprNode *nodes;
+    Py_ssize_t num_nodes;
+    Py_ssize_t nodes_allocated;
+    Py_ssize_t root;
+} BStringExprObject;
+
+PyObject *BStringExpr_compile(PyObject *source);
+
+// Evaluate the expression on one string: 1 when it matches, 0 when it does
+// not, -1 on error.
+int BStringExpr_match(BStringExprObject *self, PyObject *item);
+int BStringExpr_match_utf8(BStringExprObject *self, const char *bytes, Py_ssize_t length);
+
+extern PyTypeObject BStringExpr_Type;
+
+#endif // BSTRING_EXPR_H
@@ -0,0 +1,289 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_index.h"
+
+static Py_ssize_t BStringIndex_slots_for(Py_ssize_t count)
+{
+  // Keep the table at most two thirds full.
+  Py_ssize_t slots = 8;
+  while (slots * 2 <= count * 3)
+    slots *= 2;
+  return slots;
+}
+
+static BStringIndexEntry *BStringIndex_probe(BStringIndexEntry *entries, Py_ssize_t mask, PyObject *key, Py_hash_t hash)
+{
+  Py_ssize_t slot = (Py_ssize_t)((size_t)hash & (size_t)mask);
+  while (entries[slot].key)
+  {
+    if (entries[slot].hash == hash && BStringIndex_equal(entries[slot].key, key))
+      break;
+    slot = (slot + 1) & mask;
+  }
+  return &entries[slot];
+}
+
+static int BStringIndex_resize(BStringIndex *index, Py_ssize_t slots)
+{
+  BStringIndexEntry *entries = PyMem_Calloc(slots, sizeof(BStringIndexEntry));
+  if (!entries)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  Py_ssize_t mask = slots - 1;
+  if (index->entries)
+  {
+    for (Py_ssize_t i = 0; i <= index->mask; ++i)
+    {
+      BStringIndexEntry *entry = &index->entries[i];
+      if (entry->key)
+        *BStringIndex_probe(entries, mask, entry->key, entry->hash) = *entry;
+    }
+    PyMem_Free(index->entries);
+  }
+  index->entries = entries;
+  index->mask = mask;
+  return 0;
+}
+
+BStringIndex *BStringIndex_new(Py_ssize_t expected)
+{
+  BStringIndex *index = PyMem_Malloc(sizeof(BStringIndex));
+  if (!index)
+  {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  index->entries = NULL;
+  index->mask = -1;
+  index->used = 0;
+  index->num_shifts = 0;
+  index->overflowed = 0;
+  if (BStringIndex_resize(index, BStringIndex_slots_for(expected)) < 0)
+  {
+    PyMem_Free(index);
+    return NULL;
+  }
+  return index;
+}
+
+void BStringIndex_free(BStringIndex *index)
+{
+  if (!index)
+    return;
+  for (Py_ssize_t i = 0; i <= index->mask; ++i)
+  {
+    Py_XDECREF(index->entries[i].key);
+  }
+  PyMem_Free(index->entries);
+  PyMem_Free(index);
+}
+
+// Makes room for extra new keys so that the following BStringIndex_add()
+// calls cannot fail. Storage mutators call this before changing anything.
+int BStringIndex_reserve(BStringIndex *index, Py_ssize_t extra)
+{
+  if ((index->used + extra) * 3 < (index->mask + 1) * 2)
+    return 0;
+  return BStringIndex_resize(index, BStringIndex_slots_for(index->used + extra));
+}
+
+// Returns the entry of key, or NULL when key is not in the BString.
+BStringIndexEntry *BStringIndex_lookup(BStringIndex *index, PyObject *key)
+{
+  BStringIndexEntry *entry = BStringIndex_probe(index->entries, index->mask, key, BStringIndex_hash(key));
+  return entry->key ? entry : NULL;
+}
+
+// Records that key now occurs at position and returns its entry. Shifts
+// caused by the same insertion must be logged before this call.
+BStringIndexEntry *BStringIndex_add(BStringIndex *index, PyObject *key, Py_ssize_t position)
+{
+  Py_hash_t hash = BStringIndex_hash(key);
+  BStringIndexEntry *entry = BStringIndex_probe(index->entries, index->mask, key, hash);
+  if (!entry->key)
+  {
+    Py_INCREF(key);
+    entry->key = key;
+    entry->hash = hash;
+    entry->count = 1;
+    entry->first = position;
+    entry->epoch = index->num_shifts;
+    entry->exact = 1;
+    index->used++;
+    return entry;
+  }
+  BStringIndex_update(index, entry);
+  entry->count++;
+  // A lower bound means no occurrence before it, so anything at or below it is the first.
+  if (position < entry->first || (!entry->exact && position == entry->first))
+  {
+    entry->first = position;
+    entry->exact = 1;
+  }
+  return entry;
+}
+
+// Records that the occurrence of key at position is going away. Shifts
+// caused by the same deletion must be logged after this call.
+void BStringIndex_discard(BStringIndex *index, PyObject *key, Py_ssize_t position)
+{
+  Py_ssize_t mask = index->mask;
+  BStringIndexEntry *entry = BStringIndex_probe(index->entries, mask, key, BStringIndex_hash(key));
+  if (!entry->key)
+    return;
+  BStringIndex_update(index, entry);
+  if (--entry->count > 0)
+  {
+    // The next occurrence is somewhere after position.
+    if (entry->exact && entry->first == position)
+      entry->exact = 0;
+    return;
+  }
+
+  // Backward-shift deletion: move later members of the probe run into the
+  // hole so that lookups never need tombstones.
+  Py_DECREF(entry->key);
+  Py_ssize_t hole = entry - index->entries;
+  Py_ssize_t slot = hole;
+  for (;;)
+  {
+    slot = (slot + 1) & mask;
+    BStringIndexEntry *next = &index->entries[slot];
+    if (!next->key)
+      break;
+    Py_ssize_t home = (Py_ssize_t)((size_t)next->hash & (size_t)mask);
+    if (((slot - home) & mask) >= ((slot - hole) & mask))
+    {
+      index->entries[hole] = *next;
+      hole = slot;
+    }
+  }
+  index->entries[hole].key = NULL;
+  index->used--;
+}
+
+void BStringIndex_shifted(BStringIndex *index, Py_ssize_t position, Py_ssize_t delta)
+{
+  if (index->overflowed)
+    return;
+  if (index->num_shifts == BSTRING_INDEX_MAX_SHIFTS)
+  {
+    index->overflowed = 1;
+    return;
+  }
+  index->shifts[index->num_shifts].position = position;
+  index->shifts[index->num_shifts].delta = delta;
+  index->num_shifts++;
+}
+
+// Brings the first position of entry up to date with the shift log.
+void BStringIndex_update(BStringIndex *index, BStringIndexEntry *entry)
+{
+  if (index->overflowed)
+    return;
+  Py_ssize_t first = entry->first;
+  for (Py_ssize_t i = entry->epoch; i < index->num_shifts; ++i)
+  {
+    Py_ssize_t position = index->shifts[i].position;
+    Py_ssize_t delta = index->shifts[i].delta;
+    if (first < position)
+      continue;
+    if (delta > 0 || first >= position - delta)
+    {
+      first += delta;
+    }
+    else
+    {
+      // The first occurrence was deleted; later ones start at position at the earliest.
+      first = position;
+      entry->exact = 0;
+    }
+  }
+  entry->first = first;
+  entry->epoch = index->num_shifts;
+}
+
+// Marks every first position unknown (-1) and clears the shift log before
+// the first positions are recomputed from the items.
+void BStringIndex_reset_firsts(BStringIndex *index)
+{
+  for (Py_ssize_t i = 0; i <= index->mask; ++i)
+  {
+    index->entries[i].first = -1;
+    index->entries[i].epoch = 0;
+    index->entries[i].exact = 0;
+  }
+  index->num_shifts = 0;
+  index->overflowed = 0;
+}
+
+static int BStringSet_resize(BStringSet *set, Py_ssize_t slots)
+{
+  BStringSetEntry *entries = PyMem_Calloc(slots, sizeof(BStringSetEntry));
+  if (!entries)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  Py_ssize_t mask = slots - 1;
+  for (Py_ssize_t i = 0; i <= set->mask; ++i)
+  {
+    BStringSetEntry *entry = &set->entries[i];
+    if (!entry->key)
+      continue;
+    Py_ssize_t slot = (Py_ssize_t)((size_t)entry->hash & (size_t)mask);
+    while (entries[slot].key)
+      slot = (slot + 1) & mask;
+    entries[slot] = *entry;
+  }
+  PyMem_Free(set->entries);
+  set->entries = entries;
+  set->mask = mask;
+  return 0;
+}
+
+int BStringSet_init(BStringSet *set)
+{
+  set->entries = NULL;
+  set->mask = -1;
+  set->used = 0;
+  return BStringSet_resize(set, BStringIndex_slots_for(0));
+}
+
+void BStringSet_clear(BStringSet *set)
+{
+  PyMem_Free(set->entries);
+  set->entries = NULL;
+  set->mask = -1;
+  set->used = 0;
+}
+
+// Returns 1 when key was added, 0 when an equal string was already in the
+// set and -1 on memory errors.
+int BStringSet_add(BStringSet *set, PyObject *key)
+{
+  Py_hash_t hash = BStringIndex_hash(key);
+  Py_ssize_t mask = set->mask;
+  Py_ssize_t slot = (Py_ssize_t)((size_t)hash & (size_t)mask);
+  BStringSetEntry *entry;
+  while ((entry = &set->entries[slot])->key)
+  {
+    if (entry->hash == hash && BStringIndex_equal(entry->key, key))
+      return 0;
+    slot = (slot + 1) & mask;
+  }
+  entry->key = key;
+  entry->hash = hash;
+  set->used++;
+  if (set->used * 3 >= (mask + 1) * 2 && BStringSet_resize(set, (mask + 1) * 2) < 0)
+    return -1;
+  return 1;
+}
@@ -0,0 +1,96 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_INDEX_H
+#define BSTRING_INDEX_H
+
+#include "bstring.h"
+#include <string.h>
+
+// Number of position shifts remembered before the index recomputes every
+// first position from the items.
+#define BSTRING_INDEX_MAX_SHIFTS 1024
+
+// One distinct string of an indexed BString.
+typedef struct {
+    PyObject *key;                 // Strong reference, or NULL for an empty slot.
+    Py_hash_t hash;
+    Py_ssize_t count;              // Occurrences of key in the BString.
+    Py_ssize_t first;              // Position of the first occurrence, or a lower bound for it when !exact.
+    Py_ssize_t epoch;              // Number of logged shifts already applied to first.
+    int exact;
+} BStringIndexEntry;
+
+// Items inserted (delta > 0) or deleted (delta < 0) at position.
+typedef struct {
+    Py_ssize_t position;
+    Py_ssize_t delta;
+} BStringIndexShift;
+
+// Open-addressing hash table from string to occurrence count and first
+// position. Counts are always exact. Inserting or deleting items before the
+// end of a BString moves the positions behind them; instead of rewriting
+// every entry, the shift is logged and applied to an entry when it is next
+// used. Once the log is full the first positions are recomputed in one pass.
+struct BStringIndex {
+    BStringIndexEntry *entries;
+    Py_ssize_t mask;               // Number of slots - 1; the slot count is a power of two.
+    Py_ssize_t used;
+    Py_ssize_t num_shifts;
+    int overflowed;                // Shifts were lost; first positions must be recomputed.
+    BStringIndexShift shifts[BSTRING_INDEX_MAX_SHIFTS];
+};
+
+BStringIndex *BStringIndex_new(Py_ssize_t expected);
+void BStringIndex_free(BStringIndex *index);
+int BStringIndex_reserve(BStringIndex *index, Py_ssize_t extra);
+BStringIndexEntry *BStringIndex_lookup(BStringIndex *index, PyObject *key);
+BStringIndexEntry *BStringIndex_add(BStringIndex *index, PyObject *key, Py_ssize_t position);
+void BStringIndex_discard(BStringIndex *index, PyObject *key, Py_ssize_t position);
+void BStringIndex_shifted(BStringIndex *index, Py_ssize_t position, Py_ssize_t delta);
+void BStringIndex_update(BStringIndex *index, BStringIndexEntry *entry);
+void BStringIndex_reset_firsts(BStringIndex *index);
+
+// Hash set of borrowed str references for one-off passes such as unique().
+// Entries are half the size of index entries so that large sets stay cache
+// friendly; the caller keeps the keys alive while the set is in use.
+typedef struct {
+    PyObject *key;
+    Py_hash_t hash;
+} BStringSetEntry;
+
+typedef struct {
+    BStringSetEntry *entries;
+    Py_ssize_t mask;
+    Py_ssize_t used;
+} BStringSet;
+
+int BStringSet_init(BStringSet *set);
+void BStringSet_clear(BStringSet *set);
+int BStringSet_add(BStringSet *set, PyObject *key);
+
+// The hash str objects cache after their first use.
+static inline Py_hash_t BStringIndex_hash(PyObject *key)
+{
+  Py_hash_t hash = ((PyASCIIObject *)key)->hash;
+  return hash != -1 ? hash : PyObject_Hash(key);
+}
+
+// Equality of two str objects without going through rich comparison.
+static inline int BStringIndex_equal(PyObject *a, PyObject *b)
+{
+  if (a == b)
+    return 1;
+  Py_ssize_t length = PyUnicode_GET_LENGTH(a);
+  int kind = PyUnicode_KIND(a);
+  if (length != PyUnicode_GET_LENGTH(b) || kind != PyUnicode_KIND(b))
+    return 0;
+  return memcmp(PyUnicode_DATA(a), PyUnicode_DATA(b), length * kind) == 0;
+}
+
+#endif // BSTRING_INDEX_H
@@ -0,0 +1,940 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_kernels.h"
+#include "bstring_search.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Calls the method itself, for str subclasses and text a kernel does not
+// handle natively.
+static PyObject *BStringKernel_call(BStringKernel *kernel, PyObject *item)
+{
+  kernel->call_args[0] = item;
+  return PyObject_VectorcallMethod(kernel->name, kernel->call_args, kernel->num_call_args, NULL);
+}
+
+static PyObject *BStringKernel_unchanged(PyObject *item)
+{
+  Py_INCREF(item);
+  return item;
+}
+
+// --- strip(), lstrip(), rstrip() ---
+
+static inline int BStringKernel_strips(BStringKernel *kernel, Py_UCS4 ch)
+{
+  if (!kernel->first)
+    return Py_UNICODE_ISSPACE(ch);
+  if (ch < 128)
+    return kernel->ascii_chars[ch];
+  for (Py_ssize_t i = 0; i < kernel->num_wide_chars; ++i)
+  {
+    if (kernel->wide_chars[i] == ch)
+      return 1;
+  }
+  return 0;
+}
+
+static PyObject *BStringKernel_strip_sides(BStringKernel *kernel, PyObject *item, int left, int right)
+{
+  if (!PyUnicode_CheckExact(item))
+    return BStringKernel_call(kernel, item);
+  int kind = PyUnicode_KIND(item);
+  const void *data = PyUnicode_DATA(item);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  Py_ssize_t start = 0;
+  Py_ssize_t end = length;
+  if (left)
+  {
+    while (start < end && BStringKernel_strips(kernel, PyUnicode_READ(kind, data, start)))
+      start++;
+  }
+  if (right)
+  {
+    while (end > start && BStringKernel_strips(kernel, PyUnicode_READ(kind, data, end - 1)))
+      end--;
+  }
+  if (start == 0 && end == length)
+    return BStringKernel_unchanged(item);
+  return PyUnicode_Substring(item, start, end);
+}
+
+static PyObject *BStringKernel_strip(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_strip_sides(kernel, item, 1, 1);
+}
+
+static PyObject *BStringKernel_lstrip(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_strip_sides(kernel, item, 1, 0);
+}
+
+static PyObject *BStringKernel_rstrip(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_strip_sides(kernel, item, 0, 1);
+}
+
+// Strips ASCII bytes. A non-ASCII character at either end could be stripped
+// as well and sends the item through the str kernel.
+static int BStringKernel_strip_sides_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out, int left, int right)
+{
+  int wide = !kernel->first || kernel->num_wide_chars > 0;
+  Py_ssize_t start = 0;
+  Py_ssize_t end = length;
+  if (left)
+  {
+    while (start < end && !(bytes[start] & 0x80) && BStringKernel_strips(kernel, (unsigned char)bytes[start]))
+      start++;
+    if (start < end && (bytes[start] & 0x80) && wide)
+      return 0;
+  }
+  if (right)
+  {
+    while (end > start && !(bytes[end - 1] & 0x80) && BStringKernel_strips(kernel, (unsigned char)bytes[end - 1]))
+      end--;
+    if (end > start && (bytes[end - 1] & 0x80) && wide)
+      return 0;
+  }
+  return BStringArena_append(out, bytes + start, end - start) < 0 ? -1 : 1;
+}
+
+static int BStringKernel_strip_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_strip_sides_utf8(kernel, bytes, length, out, 1, 1);
+}
+
+static int BStringKernel_lstrip_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_strip_sides_utf8(kernel, bytes, length, out, 1, 0);
+}
+
+static int BStringKernel_rstrip_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_strip_sides_utf8(kernel, bytes, length, out, 0, 1);
+}
+
+// --- lower(), upper(), casefold() ---
+
+// ASCII text is converted here; a string that has nothing to convert is
+// returned as is. Other text needs the full Unicode mappings of the method.
+static PyObject *BStringKernel_ascii_case(BStringKernel *kernel, PyObject *item, int upper)
+{
+  if (!PyUnicode_CheckExact(item) || !PyUnicode_IS_ASCII(item))
+    return BStringKernel_call(kernel, item);
+  const unsigned char *data = (const unsigned char *)PyUnicode_DATA(item);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  Py_ssize_t i = 0;
+  if (upper)
+  {
+    while (i < length && !Py_ISLOWER(data[i]))
+      i++;
+  }
+  else
+  {
+    while (i < length && !Py_ISUPPER(data[i]))
+      i++;
+  }
+  if (i == length)
+    return BStringKernel_unchanged(item);
+
+  PyObject *result = PyUnicode_New(length, 127);
+  if (!result)
+    return NULL;
+  unsigned char *out = (unsigned char *)PyUnicode_DATA(result);
+  memcpy(out, data, i);
+  if (upper)
+  {
+    for (; i < length; ++i)
+      out[i] = Py_TOUPPER(data[i]);
+  }
+  else
+  {
+    for (; i < length; ++i)
+      out[i] = Py_TOLOWER(data[i]);
+  }
+  return result;
+}
+
+static int BStringKernel_ascii_case_utf8(const char *bytes, Py_ssize_t length, BStringArena *out, int upper)
+{
+  if (!BStringSearch_is_ascii(bytes, length))
+    return 0;
+  char *text = BStringArena_append_raw(out, length);
+  if (!text)
+    return -1;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    text[i] = upper ? Py_TOUPPER(bytes[i]) : Py_TOLOWER(bytes[i]);
+  }
+  return 1;
+}
+
+static int BStringKernel_lower_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_ascii_case_utf8(bytes, length, out, 0);
+}
+
+static int BStringKernel_upper_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_ascii_case_utf8(bytes, length, out, 1);
+}
+
+static PyObject *BStringKernel_lower(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_ascii_case(kernel, item, 0);
+}
+
+static PyObject *BStringKernel_upper(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_ascii_case(kernel, item, 1);
+}
+
+// --- replace(), zfill(), removeprefix(), removesuffix() ---
+
+static PyObject *BStringKernel_replace(BStringKernel *kernel, PyObject *item)
+{
+  if (!PyUnicode_CheckExact(item))
+    return BStringKernel_call(kernel, item);
+  return PyUnicode_Replace(item, kernel->first, kernel->second, kernel->number);
+}
+
+// UTF-8 matches of a non-empty needle fall on character boundaries, so the
+// bytes can be replaced as they are. An empty old string inserts between
+// characters and is left to the str kernel.
+static int BStringKernel_replace_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  const char *old = kernel->first_utf8;
+  Py_ssize_t old_length = kernel->first_utf8_length;
+  if (old_length == 0)
+    return 0;
+  Py_ssize_t limit = kernel->number < 0 ? PY_SSIZE_T_MAX : kernel->number;
+  Py_ssize_t matches = 0;
+  for (Py_ssize_t at = 0, found; matches < limit && (found = BStringSearch_bytes(bytes + at, length - at, old, old_length)) >= 0;)
+  {
+    matches++;
+    at += found + old_length;
+  }
+  if (matches == 0)
+    return BStringArena_append(out, bytes, length) < 0 ? -1 : 1;
+
+  Py_ssize_t new_length = kernel->second_utf8_length;
+  char *text = BStringArena_append_raw(out, length + matches * (new_length - old_length));
+  if (!text)
+    return -1;
+  Py_ssize_t at = 0;
+  for (Py_ssize_t i = 0; i < matches; ++i)
+  {
+    Py_ssize_t found = BStringSearch_bytes(bytes + at, length - at, old, old_length);
+    memcpy(text, bytes + at, found);
+    memcpy(text + found, kernel->second_utf8, new_length);
+    text += found + new_length;
+    at += found + old_length;
+  }
+  memcpy(text, bytes + at, length - at);
+  return 1;
+}
+
+static PyObject *BStringKernel_zfill(BStringKernel *kernel, PyObject *item)
+{
+  if (!PyUnicode_CheckExact(item))
+    return BStringKernel_call(kernel, item);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  if (length >= kernel->number)
+    return BStringKernel_unchanged(item);
+
+  Py_ssize_t fill = kernel->number - length;
+  PyObject *result = PyUnicode_New(kernel->number, PyUnicode_MAX_CHAR_VALUE(item));
+  if (!result)
+    return NULL;
+  int kind = PyUnicode_KIND(result);
+  void *data = PyUnicode_DATA(result);
+  for (Py_ssize_t i = 0; i < fill; ++i)
+  {
+    PyUnicode_WRITE(kind, data, i, '0');
+  }
+  PyUnicode_CopyCharacters(result, fill, item, 0, length);
+  // A leading sign moves in front of the zeros.
+  Py_UCS4 sign = length > 0 ? PyUnicode_READ(kind, data, fill) : 0;
+  if (sign == '+' || sign == '-')
+  {
+    PyUnicode_WRITE(kind, data, 0, sign);
+    PyUnicode_WRITE(kind, data, fill, '0');
+  }
+  return result;
+}
+
+static int BStringKernel_zfill_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  // The width counts characters: every byte that does not continue one.
+  Py_ssize_t characters = 0;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    characters += ((unsigned char)bytes[i] & 0xC0) != 0x80;
+  }
+  Py_ssize_t fill = kernel->number - characters;
+  if (fill <= 0)
+    return BStringArena_append(out, bytes, length) < 0 ? -1 : 1;
+  char *text = BStringArena_append_raw(out, fill + length);
+  if (!text)
+    return -1;
+  memset(text, '0', fill);
+  memcpy(text + fill, bytes, length);
+  if (length > 0 && (bytes[0] == '+' || bytes[0] == '-'))
+  {
+    text[0] = bytes[0];
+    text[fill] = '0';
+  }
+  return 1;
+}
+
+static PyObject *BStringKernel_remove_affix(BStringKernel *kernel, PyObject *item, int direction)
+{
+  if (!PyUnicode_CheckExact(item))
+    return BStringKernel_call(kernel, item);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  Py_ssize_t affix_length = PyUnicode_GET_LENGTH(kernel->first);
+  Py_ssize_t match = PyUnicode_Tailmatch(item, kernel->first, 0, length, direction);
+  if (match < 0)
+    return NULL;
+  if (!match || affix_length == 0)
+    return BStringKernel_unchanged(item);
+  if (direction < 0)
+    return PyUnicode_Substring(item, affix_length, length);
+  return PyUnicode_Substring(item, 0, length - affix_length);
+}
+
+static int BStringKernel_remove_affix_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out, int direction)
+{
+  const char *affix = kernel->first_utf8;
+  Py_ssize_t affix_length = kernel->first_utf8_length;
+  if (affix_length <= length)
+  {
+    if (direction < 0 && memcmp(bytes, affix, affix_length) == 0)
+      bytes += affix_length, length -= affix_length;
+    else if (direction > 0 && memcmp(bytes + length - affix_length, affix, affix_length) == 0)
+      length -= affix_length;
+  }
+  return BStringArena_append(out, bytes, length) < 0 ? -1 : 1;
+}
+
+static int BStringKernel_removeprefix_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_remove_affix_utf8(kernel, bytes, length, out, -1);
+}
+
+static int BStringKernel_removesuffix_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  return BStringKernel_remove_affix_utf8(kernel, bytes, length, out, 1);
+}
+
+static PyObject *BStringKernel_removeprefix(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_remove_affix(kernel, item, -1);
+}
+
+static PyObject *BStringKernel_removesuffix(BStringKernel *kernel, PyObject *item)
+{
+  return BStringKernel_remove_affix(kernel, item, 1);
+}
+
+// --- transform_chars() ---
+
+static inline int BStringKernel_keeps(BStringKernel *kernel, Py_UCS4 ch)
+{
+  if (ch < 256)
+    return kernel->keep_chars[ch];
+  Py_ssize_t low = 0;
+  Py_ssize_t high = kernel->num_wide_chars;
+  while (low < high)
+  {
+    Py_ssize_t middle = low + (high - low) / 2;
+    if (kernel->wide_chars[middle] < ch)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  int listed = low < kernel->num_wide_chars && kernel->wide_chars[low] == ch;
+  return listed != (int)kernel->number;
+}
+
+// Copies the kept characters of text to out, which has room for length
+// bytes, and returns the number of bytes written. ASCII is classified with
+// the table, 16 bytes at a time with SSSE3, and a block that is kept whole
+// is stored as it is. The other bytes are Latin-1 characters, or with utf8
+// set the lead bytes of multi-byte sequences.
+static Py_ssize_t BStringKernel_keep_bytes(BStringKernel *kernel, const unsigned char *text, Py_ssize_t length, unsigned char *out, int utf8)
+{
+  Py_ssize_t i = 0;
+  Py_ssize_t n = 0;
+#if defined(BSTRING_HAVE_SSSE3)
+  const __m128i rows = _mm_loadu_si128((const __m128i *)kernel->keep_nibbles);
+  const __m128i columns = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i low_nibble = _mm_set1_epi8(0x0F);
+#endif
+  while (i < length)
+  {
+#if defined(BSTRING_HAVE_SSSE3)
+    for (; i + 16 <= length; i += 16)
+    {
+      __m128i block = _mm_loadu_si128((const __m128i *)(text + i));
+      if (_mm_movemask_epi8(block))
+        break;
+      __m128i row = _mm_shuffle_epi8(rows, _mm_and_si128(block, low_nibble));
+      __m128i column = _mm_shuffle_epi8(columns, _mm_and_si128(_mm_srli_epi16(block, 4), low_nibble));
+      unsigned int keep = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, column), column));
+      if (keep == 0xFFFF)
+      {
+        _mm_storeu_si128((__m128i *)(out + n), block);
+        n += 16;
+        continue;
+      }
+      for (int j = 0; j < 16; ++j)
+      {
+        out[n] = text[i + j];
+        n += (keep >> j) & 1;
+      }
+    }
+    // The block with non-ASCII text, or the tail, one character at a time.
+    Py_ssize_t stop = length - i > 16 ? i + 16 : length;
+#else
+    Py_ssize_t stop = length;
+#endif
+    while (i < stop)
+    {
+      unsigned char ch = text[i];
+      if (ch < 128 || !utf8)
+      {
+        out[n] = ch;
+        n += kernel->keep_chars[ch];
+        i++;
+        continue;
+      }
+      Py_ssize_t size;
+      Py_UCS4 code;
+      if (ch >= 0xF0)
+      {
+        size = 4;
+        code = ((Py_UCS4)(ch & 0x07) << 18) | ((Py_UCS4)(text[i + 1] & 0x3F) << 12) | ((Py_UCS4)(text[i + 2] & 0x3F) << 6) | (text[i + 3] & 0x3F);
+      }
+      else if (ch >= 0xE0)
+      {
+        size = 3;
+        code = ((Py_UCS4)(ch & 0x0F) << 12) | ((Py_UCS4)(text[i + 1] & 0x3F) << 6) | (text[i + 2] & 0x3F);
+      }
+      else
+      {
+        size = 2;
+        code = ((Py_UCS4)(ch & 0x1F) << 6) | (text[i + 1] & 0x3F);
+      }
+      if (BStringKernel_keeps(kernel, code))
+      {
+        memcpy(out + n, text + i, size);
+        n += size;
+      }
+      i += size;
+    }
+  }
+  return n;
+}
+
+// Writes into a new str of the length of item and shrinks it, or copies the
+// kept characters of wider text to a buffer for PyUnicode_FromKindAndData(),
+// which also narrows the result when the widest characters were removed.
+static PyObject *BStringKernel_transform_chars(BStringKernel *kernel, PyObject *item)
+{
+  int kind = PyUnicode_KIND(item);
+  const void *data = PyUnicode_DATA(item);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  if (PyUnicode_IS_ASCII(item))
+  {
+    PyObject *result = PyUnicode_New(length, 127);
+    if (!result)
+      return NULL;
+    Py_ssize_t n = BStringKernel_keep_bytes(kernel, data, length, PyUnicode_DATA(result), 0);
+    if (n == length && PyUnicode_CheckExact(item))
+    {
+      Py_DECREF(result);
+      return BStringKernel_unchanged(item);
+    }
+    if (n < length && PyUnicode_Resize(&result, n) < 0)
+      return NULL;
+    return result;
+  }
+
+  void *kept = PyMem_Malloc(length * kind);
+  if (!kept)
+    return PyErr_NoMemory();
+  Py_ssize_t n = 0;
+  if (kind == PyUnicode_1BYTE_KIND)
+  {
+    n = BStringKernel_keep_bytes(kernel, data, length, kept, 0);
+  }
+  else
+  {
+    for (Py_ssize_t i = 0; i < length; ++i)
+    {
+      Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+      if (BStringKernel_keeps(kernel, ch))
+        PyUnicode_WRITE(kind, kept, n++, ch);
+    }
+  }
+  PyObject *result;
+  if (n == length && PyUnicode_CheckExact(item))
+    result = BStringKernel_unchanged(item);
+  else
+    result = PyUnicode_FromKindAndData(kind, kept, n);
+  PyMem_Free(kept);
+  return result;
+}
+
+static int BStringKernel_transform_chars_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  char *text = BStringArena_append_raw(out, length);
+  if (!text)
+    return -1;
+  Py_ssize_t n = BStringKernel_keep_bytes(kernel, (const unsigned char *)bytes, length, (unsigned char *)text, 1);
+  BStringArena_truncate_last(out, n);
+  return 1;
+}
+
+// --- Predicates for filter() ---
+// A predicate on UTF-8 bytes returns 1 or 0, or -1 when the bytes hold
+// non-ASCII text that only the str method can judge.
+
+static int BStringKernel_startswith_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length)
+{
+  Py_ssize_t affix_length = kernel->first_utf8_length;
+  return affix_length <= length && memcmp(bytes, kernel->first_utf8, affix_length) == 0;
+}
+
+static int BStringKernel_endswith_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length)
+{
+  Py_ssize_t affix_length = kernel->first_utf8_length;
+  return affix_length <= length && memcmp(bytes + length - affix_length, kernel->first_utf8, affix_length) == 0;
+}
+
+static int BStringKernel_isascii_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length)
+{
+  return BStringSearch_is_ascii(bytes, length);
+}
+
+// Character classes of the is*() predicates over ASCII.
+enum {
+  BSTRING_CLASS_DIGIT,
+  BSTRING_CLASS_ALPHA,
+  BSTRING_CLASS_ALNUM,
+  BSTRING_CLASS_SPACE,
+  BSTRING_CLASS_LOWER,
+  BSTRING_CLASS_UPPER
+};
+
+static int BStringKernel_class_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length)
+{
+  int cased = 0;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    unsigned char ch = (unsigned char)bytes[i];
+    if (ch & 0x80)
+      return -1;
+    switch (kernel->number)
+    {
+    case BSTRING_CLASS_DIGIT:
+      if (!Py_ISDIGIT(ch))
+        return 0;
+      break;
+    case BSTRING_CLASS_ALPHA:
+      if (!Py_ISALPHA(ch))
+        return 0;
+      break;
+    case BSTRING_CLASS_ALNUM:
+      if (!Py_ISALNUM(ch))
+        return 0;
+      break;
+    case BSTRING_CLASS_SPACE:
+      if (!Py_UNICODE_ISSPACE(ch))
+        return 0;
+      break;
+    case BSTRING_CLASS_LOWER:
+      if (Py_ISUPPER(ch))
+        return 0;
+      cased |= Py_ISLOWER(ch);
+      break;
+    case BSTRING_CLASS_UPPER:
+      if (Py_ISLOWER(ch))
+        return 0;
+      cased |= Py_ISUPPER(ch);
+      break;
+    }
+  }
+  if (kernel->number == BSTRING_CLASS_LOWER || kernel->number == BSTRING_CLASS_UPPER)
+    return cased;
+  return length > 0;
+}
+
+// Returns 1 or 0 for an item, calling the method for the items the byte
+// predicate cannot decide. -1 on error.
+int BStringKernel_test(BStringKernel *kernel, PyObject *item)
+{
+  if (PyUnicode_CheckExact(item) && PyUnicode_IS_ASCII(item))
+  {
+    int verdict = kernel->test_utf8(kernel, (const char *)PyUnicode_DATA(item), PyUnicode_GET_LENGTH(item));
+    if (verdict >= 0)
+      return verdict;
+  }
+  PyObject *result = BStringKernel_call(kernel, item);
+  if (!result)
+    return -1;
+  int verdict = PyObject_IsTrue(result);
+  Py_DECREF(result);
+  return verdict;
+}
+
+int BStringKernel_test_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length)
+{
+  int verdict = kernel->test_utf8(kernel, bytes, length);
+  if (verdict >= 0)
+    return verdict;
+  PyObject *item = PyUnicode_DecodeUTF8(bytes, length, "strict");
+  if (!item)
+    return -1;
+  verdict = BStringKernel_test(kernel, item);
+  Py_DECREF(item);
+  return verdict;
+}
+
+// --- Lookup ---
+
+static int BStringKernel_name_is(PyObject *name, const char *method)
+{
+  return PyUnicode_CompareWithASCIIString(name, method) == 0;
+}
+
+// Reads an index-sized int argument; 0 when it is not one or out of range,
+// leaving the error to the method itself.
+static int BStringKernel_number(PyObject *arg, Py_ssize_t *number)
+{
+  if (!PyLong_CheckExact(arg))
+    return 0;
+  *number = PyLong_AsSsize_t(arg);
+  if (*number == -1 && PyErr_Occurred())
+  {
+    PyErr_Clear();
+    return 0;
+  }
+  return 1;
+}
+
+static int BStringKernel_init_strip(BStringKernel *kernel, PyObject *chars)
+{
+  if (chars == Py_None)
+    return 1;
+  if (!PyUnicode_Check(chars))
+    return 0;
+  kernel->first = chars;
+  int kind = PyUnicode_KIND(chars);
+  const void *data = PyUnicode_DATA(chars);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(chars);
+  kernel->wide_chars = PyMem_Malloc((length ? length : 1) * sizeof(Py_UCS4));
+  if (!kernel->wide_chars)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+    if (ch < 128)
+      kernel->ascii_chars[ch] = 1;
+    else
+      kernel->wide_chars[kernel->num_wide_chars++] = ch;
+  }
+  return 1;
+}
+
+static int BStringKernel_prepare(BStringKernel *kernel, PyObject *name, PyObject *const *args, Py_ssize_t nargs)
+{
+  memset(kernel, 0, sizeof(*kernel));
+  kernel->name = name;
+  kernel->number = -1;
+  if (nargs > 3)
+    return 0;
+  for (Py_ssize_t i = 0; i < nargs; ++i)
+  {
+    kernel->call_args[i + 1] = args[i];
+  }
+  kernel->num_call_args = nargs + 1;
+  return 1;
+}
+
+// Encodes the str arguments for the byte kernels.
+static int BStringKernel_encode_args(BStringKernel *kernel)
+{
+  if (kernel->first)
+  {
+    kernel->first_utf8 = PyUnicode_AsUTF8AndSize(kernel->first, &kernel->first_utf8_length);
+    if (!kernel->first_utf8)
+      goto error;
+  }
+  if (kernel->second)
+  {
+    kernel->second_utf8 = PyUnicode_AsUTF8AndSize(kernel->second, &kernel->second_utf8_length);
+    if (!kernel->second_utf8)
+      goto error;
+  }
+  return 1;
+
+error:
+  // Lone surrogates cannot be encoded; leave those arguments to the method.
+  PyErr_Clear();
+  BStringKernel_clear(kernel);
+  return 0;
+}
+
+int BStringKernel_init(BStringKernel *kernel, PyObject *name, PyObject *const *args, Py_ssize_t nargs)
+{
+  if (!BStringKernel_prepare(kernel, name, args, nargs))
+    return 0;
+
+  if (BStringKernel_name_is(name, "strip") || BStringKernel_name_is(name, "lstrip") || BStringKernel_name_is(name, "rstrip"))
+  {
+    if (nargs > 1)
+      return 0;
+    int status = nargs == 1 ? BStringKernel_init_strip(kernel, args[0]) : 1;
+    if (status <= 0)
+      return status;
+    if (BStringKernel_name_is(name, "strip"))
+    {
+      kernel->apply = BStringKernel_strip;
+      kernel->apply_utf8 = BStringKernel_strip_utf8;
+    }
+    else if (BStringKernel_name_is(name, "lstrip"))
+    {
+      kernel->apply = BStringKernel_lstrip;
+      kernel->apply_utf8 = BStringKernel_lstrip_utf8;
+    }
+    else
+    {
+      kernel->apply = BStringKernel_rstrip;
+      kernel->apply_utf8 = BStringKernel_rstrip_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "lower") || BStringKernel_name_is(name, "casefold"))
+  {
+    // ASCII text casefolds to its lowercase.
+    if (nargs == 0)
+    {
+      kernel->apply = BStringKernel_lower;
+      kernel->apply_utf8 = BStringKernel_lower_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "upper"))
+  {
+    if (nargs == 0)
+    {
+      kernel->apply = BStringKernel_upper;
+      kernel->apply_utf8 = BStringKernel_upper_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "replace"))
+  {
+    if ((nargs == 2 || (nargs == 3 && BStringKernel_number(args[2], &kernel->number))) &&
+        PyUnicode_Check(args[0]) && PyUnicode_Check(args[1]))
+    {
+      kernel->first = args[0];
+      kernel->second = args[1];
+      kernel->apply = BStringKernel_replace;
+      kernel->apply_utf8 = BStringKernel_replace_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "zfill"))
+  {
+    if (nargs == 1 && BStringKernel_number(args[0], &kernel->number))
+    {
+      kernel->apply = BStringKernel_zfill;
+      kernel->apply_utf8 = BStringKernel_zfill_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "removeprefix") || BStringKernel_name_is(name, "removesuffix"))
+  {
+    if (nargs == 1 && PyUnicode_Check(args[0]))
+    {
+      int prefix = BStringKernel_name_is(name, "removeprefix");
+      kernel->first = args[0];
+      kernel->apply = prefix ? BStringKernel_removeprefix : BStringKernel_removesuffix;
+      kernel->apply_utf8 = prefix ? BStringKernel_removeprefix_utf8 : BStringKernel_removesuffix_utf8;
+    }
+  }
+  if (!kernel->apply)
+    return 0;
+  return BStringKernel_encode_args(kernel);
+}
+
+int BStringKernel_init_test(BStringKernel *kernel, PyObject *name, PyObject *const *args, Py_ssize_t nargs)
+{
+  if (!BStringKernel_prepare(kernel, name, args, nargs))
+    return 0;
+
+  static const struct {
+    const char *name;
+    int character_class;
+  } classes[] = {
+      {"isdigit", BSTRING_CLASS_DIGIT},
+      {"isdecimal", BSTRING_CLASS_DIGIT},
+      {"isnumeric", BSTRING_CLASS_DIGIT},
+      {"isalpha", BSTRING_CLASS_ALPHA},
+      {"isalnum", BSTRING_CLASS_ALNUM},
+      {"isspace", BSTRING_CLASS_SPACE},
+      {"islower", BSTRING_CLASS_LOWER},
+      {"isupper", BSTRING_CLASS_UPPER},
+  };
+  if (BStringKernel_name_is(name, "startswith") || BStringKernel_name_is(name, "endswith"))
+  {
+    if (nargs == 1 && PyUnicode_Check(args[0]))
+    {
+      kernel->first = args[0];
+      kernel->test_utf8 = BStringKernel_name_is(name, "startswith") ? BStringKernel_startswith_utf8 : BStringKernel_endswith_utf8;
+    }
+  }
+  else if (BStringKernel_name_is(name, "isascii"))
+  {
+    if (nargs == 0)
+      kernel->test_utf8 = BStringKernel_isascii_utf8;
+  }
+  else if (nargs == 0)
+  {
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); ++i)
+    {
+      if (BStringKernel_name_is(name, classes[i].name))
+      {
+        kernel->number = classes[i].character_class;
+        kernel->test_utf8 = BStringKernel_class_utf8;
+      }
+    }
+  }
+  if (!kernel->test_utf8)
+    return 0;
+  return BStringKernel_encode_args(kernel);
+}
+
+static int BStringKernel_compare_chars(const void *a, const void *b)
+{
+  Py_UCS4 x = *(const Py_UCS4 *)a;
+  Py_UCS4 y = *(const Py_UCS4 *)b;
+  return (x > y) - (x < y);
+}
+
+int BStringKernel_init_chars(BStringKernel *kernel, PyObject *characters, int remove)
+{
+  memset(kernel, 0, sizeof(*kernel));
+  kernel->number = remove;
+  int kind = PyUnicode_KIND(characters);
+  const void *data = PyUnicode_DATA(characters);
+  Py_ssize_t length = PyUnicode_GET_LENGTH(characters);
+  kernel->wide_chars = PyMem_Malloc((length ? length : 1) * sizeof(Py_UCS4));
+  if (!kernel->wide_chars)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  memset(kernel->keep_chars, remove, sizeof(kernel->keep_chars));
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+    if (ch < 256)
+      kernel->keep_chars[ch] = !remove;
+    else
+      kernel->wide_chars[kernel->num_wide_chars++] = ch;
+  }
+  qsort(kernel->wide_chars, kernel->num_wide_chars, sizeof(Py_UCS4), BStringKernel_compare_chars);
+  for (int ch = 0; ch < 128; ++ch)
+  {
+    if (kernel->keep_chars[ch])
+      kernel->keep_nibbles[ch & 0x0F] |= (unsigned char)(1 << (ch >> 4));
+  }
+  kernel->apply = BStringKernel_transform_chars;
+  kernel->apply_utf8 = BStringKernel_transform_chars_utf8;
+  return 0;
+}
+
+void BStringKernel_clear(BStringKernel *kernel)
+{
+  PyMem_Free(kernel->wide_chars);
+  kernel->wide_chars = NULL;
+  kernel->apply = NULL;
+  kernel->apply_utf8 = NULL;
+  kernel->test_utf8 = NULL;
+}
+
+// Appends the result for one item of compact storage to out.
+int BStringKernel_apply_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out)
+{
+  int status = kernel->apply_utf8(kernel, bytes, length, out);
+  if (status != 0)
+    return status < 0 ? -1 : 0;
+  PyObject *item = PyUnicode_DecodeUTF8(bytes, length, "strict");
+  if (!item)
+    return -1;
+  PyObject *result = kernel->apply(kernel, item);
+  Py_DECREF(item);
+  if (!result)
+    return -1;
+  status = BStringArena_append_object(out, result);
+  Py_DECREF(result);
+  return status;
+}
+
+// --- Worker threads ---
+
+// The bytes a worker can read for item i of a part, or NULL when the item
+// needs Python.
+static inline const char *BStringKernel_part_bytes(BStringKernelPart *part, Py_ssize_t i, Py_ssize_t *length)
+{
+  if (part->source)
+    return BStringArena_bytes(part->source, i, length);
+  PyObject *item = part->items[i];
+  if (!PyUnicode_CheckExact(item) || !PyUnicode_IS_ASCII(item))
+    return NULL;
+  *length = PyUnicode_GET_LENGTH(item);
+  return (const char *)PyUnicode_DATA(item);
+}
+
+void BStringKernel_map_part(void *parts, Py_ssize_t index)
+{
+  BStringKernelPart *part = (BStringKernelPart *)parts + index;
+  BStringKernel *kernel = part->kernel;
+  unsigned char *marks = part->marks;
+  for (Py_ssize_t i = part->start; i < part->stop; ++i, ++marks)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringKernel_part_bytes(part, i, &length);
+    int status = bytes ? kernel->apply_utf8(kernel, bytes, length, part->out) : 0;
+    *marks = status == 0;
+    if (status == 0)
+      status = BStringArena_append(part->out, "", 0) == 0 ? 1 : -1;
+    if (status < 0)
+    {
+      part->failed = 1;
+      return;
+    }
+  }
+}
+
+void BStringKernel_filter_part(void *parts, Py_ssize_t index)
+{
+  BStringKernelPart *part = (BStringKernelPart *)parts + index;
+  BStringKernel *kernel = part->kernel;
+  unsigned char *marks = part->marks;
+  for (Py_ssize_t i = part->start; i < part->stop; ++i, ++marks)
+  {
+    Py_ssize_t length;
+    const char *bytes = BStringKernel_part_bytes(part, i, &length);
+    int verdict = bytes ? kernel->test_utf8(kernel, bytes, length) : -1;
+    *marks = verdict < 0 ? BSTRING_KERNEL_UNDECIDED : (unsigned char)verdict;
+  }
+}
@@ -0,0 +1,82 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_KERNELS_H
+#define BSTRING_KERNELS_H
+
+#include "bstring.h"
+#include "bstring_arena.h"
+
+// A str method implemented in C for map(), with its arguments checked once.
+// The kernels give the same results as calling the method on an exact str;
+// other items go through the method itself. Compact storage is transformed
+// as UTF-8 bytes, decoding only the items a byte kernel cannot handle.
+typedef struct BStringKernel BStringKernel;
+struct BStringKernel {
+    PyObject *(*apply)(BStringKernel *kernel, PyObject *item);
+    int (*apply_utf8)(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out);
+    int (*test_utf8)(BStringKernel *kernel, const char *bytes, Py_ssize_t length);
+    PyObject *name;                // Method name, for items the kernel leaves to Python.
+    PyObject *call_args[4];        // Item slot followed by the map() arguments, for those calls.
+    Py_ssize_t num_call_args;
+    PyObject *first;               // Borrowed str arguments: strip() chars, replace() old,
+    PyObject *second;              // removeprefix() prefix, ...; replace() new.
+    const char *first_utf8;        // The str arguments encoded as UTF-8.
+    Py_ssize_t first_utf8_length;
+    const char *second_utf8;
+    Py_ssize_t second_utf8_length;
+    Py_ssize_t number;             // replace() count or zfill() width; 1 for transform_chars() remove.
+    unsigned char ascii_chars[128];// strip(): ASCII characters in chars.
+    Py_UCS4 *wide_chars;           // strip(): the other characters in chars; transform_chars(): sorted.
+    Py_ssize_t num_wide_chars;
+    unsigned char keep_chars[256]; // transform_chars(): 1 for the Latin-1 characters that are kept,
+    unsigned char keep_nibbles[16];// and for ASCII by low nibble, one bit per high nibble.
+};
+
+// Returns 1 when name(*args) has a kernel, 0 when the method must be called
+// normally (unknown method or arguments the kernel does not take), -1 on error.
+// BStringKernel_init() looks for a transformation for map(),
+// BStringKernel_init_test() for a predicate for filter().
+int BStringKernel_init(BStringKernel *kernel, PyObject *name, PyObject *const *args, Py_ssize_t nargs);
+int BStringKernel_init_test(BStringKernel *kernel, PyObject *name, PyObject *const *args, Py_ssize_t nargs);
+// The transform_chars() kernel, which removes the given characters or keeps
+// only those. It handles every str natively. Returns 0, or -1 on error.
+int BStringKernel_init_chars(BStringKernel *kernel, PyObject *characters, int remove);
+void BStringKernel_clear(BStringKernel *kernel);
+int BStringKernel_apply_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length, BStringArena *out);
+
+// Predicate results: 1 or 0, or -1 on error.
+int BStringKernel_test(BStringKernel *kernel, PyObject *item);
+int BStringKernel_test_utf8(BStringKernel *kernel, const char *bytes, Py_ssize_t length);
+
+// One slice [start, stop) of a map() or filter() run on a worker thread.
+// Workers only handle what needs no Python: exact ASCII str items and
+// compact storage bytes. Everything else is marked and finished by the
+// calling thread once the workers are done.
+typedef struct {
+    BStringKernel *kernel;
+    BStringArena *source;          // Compact storage being read, or NULL.
+    PyObject *const *items;        // Otherwise the items, kept alive by the caller.
+    Py_ssize_t start;
+    Py_ssize_t stop;
+    BStringArena *out;             // map(): one result per item, empty for marked items.
+    unsigned char *marks;          // Per item from start: map() 1 = not done; filter() 1 keep, 0 drop, 2 not decided.
+    int failed;                    // Out of memory.
+} BStringKernelPart;
+
+#define BSTRING_KERNEL_UNDECIDED 2
+
+void BStringKernel_map_part(void *parts, Py_ssize_t part);
+void BStringKernel_filter_part(void *parts, Py_ssize_t part);
+
+static inline PyObject *BStringKernel_apply(BStringKernel *kernel, PyObject *item)
+{
+  return kernel->apply(kernel, item);
+}
+
+#endif // BSTRING_KERNELS_H
@@ -0,0 +1,478 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring_patterns.h"
+#include "bstring_search.h"
+#include <limits.h>
+#include <string.h>
+
+// Writes the UTF-8 form of ch to out and returns its length. Surrogates are
+// encoded like any other code point so that patterns and text agree.
+static inline int BStringPatterns_encode(Py_UCS4 ch, unsigned char *out)
+{
+  if (ch < 0x80)
+  {
+    out[0] = (unsigned char)ch;
+    return 1;
+  }
+  if (ch < 0x800)
+  {
+    out[0] = (unsigned char)(0xC0 | (ch >> 6));
+    out[1] = (unsigned char)(0x80 | (ch & 0x3F));
+    return 2;
+  }
+  if (ch < 0x10000)
+  {
+    out[0] = (unsigned char)(0xE0 | (ch >> 12));
+    out[1] = (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+    out[2] = (unsigned char)(0x80 | (ch & 0x3F));
+    return 3;
+  }
+  out[0] = (unsigned char)(0xF0 | (ch >> 18));
+  out[1] = (unsigned char)(0x80 | ((ch >> 12) & 0x3F));
+  out[2] = (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+  out[3] = (unsigned char)(0x80 | (ch & 0x3F));
+  return 4;
+}
+
+static inline int BStringPatterns_step(BStringPatternsObject *self, int state, unsigned char byte)
+{
+  return self->delta[(Py_ssize_t)state * self->num_classes + self->classes[byte]];
+}
+
+// The patterns as matched: lowered by str.lower() when matching ignores
+// case, like the needles of contains() and find_all().
+static PyObject *BStringPatterns_keys(BStringPatternsObject *self)
+{
+  if (self->case_sensitive)
+  {
+    Py_INCREF(self->patterns);
+    return self->patterns;
+  }
+  Py_ssize_t count = PyTuple_GET_SIZE(self->patterns);
+  PyObject *keys = PyTuple_New(count);
+  if (!keys)
+    return NULL;
+  for (Py_ssize_t p = 0; p < count; ++p)
+  {
+    PyObject *key = PyObject_CallMethod(PyTuple_GET_ITEM(self->patterns, p), "lower", NULL);
+    if (!key)
+    {
+      Py_DECREF(keys);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(keys, p, key);
+  }
+  return keys;
+}
+
+static int BStringPatterns_build(BStringPatternsObject *self)
+{
+  PyObject *patterns = BStringPatterns_keys(self);
+  if (!patterns)
+    return -1;
+  Py_ssize_t count = PyTuple_GET_SIZE(patterns);
+  Py_ssize_t capacity = 0;
+  for (Py_ssize_t p = 0; p < count; ++p)
+  {
+    capacity += 4 * PyUnicode_GET_LENGTH(PyTuple_GET_ITEM(patterns, p));
+  }
+
+  // The UTF-8 form of every pattern, case-folded when matching ignores case.
+  unsigned char *bytes = PyMem_Malloc(capacity + 1);
+  Py_ssize_t *ends = PyMem_Malloc((count + 1) * sizeof(Py_ssize_t));
+  self->lengths = PyMem_Malloc((count + 1) * sizeof(Py_ssize_t));
+  if (!bytes || !ends || !self->lengths)
+  {
+    Py_DECREF(patterns);
+    PyMem_Free(bytes);
+    PyMem_Free(ends);
+    PyErr_NoMemory();
+    return -1;
+  }
+  Py_ssize_t used = 0;
+  for (Py_ssize_t p = 0; p < count; ++p)
+  {
+    PyObject *pattern = PyTuple_GET_ITEM(patterns, p);
+    int kind = PyUnicode_KIND(pattern);
+    const void *data = PyUnicode_DATA(pattern);
+    Py_ssize_t length = PyUnicode_GET_LENGTH(pattern);
+    for (Py_ssize_t i = 0; i < length; ++i)
+    {
+      Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+      used += BStringPatterns_encode(self->case_sensitive ? ch : BStringSearch_fold(ch), bytes + used);
+    }
+    ends[p] = used;
+    self->lengths[p] = length;
+  }
+  Py_DECREF(patterns);
+
+  // UTF-8 never uses 0xC0, 0xC1 or 0xF5-0xFF, so the classes fit in a byte.
+  memset(self->classes, 0, sizeof(self->classes));
+  int num_classes = 1;
+  for (Py_ssize_t i = 0; i < used; ++i)
+  {
+    if (!self->classes[bytes[i]])
+      self->classes[bytes[i]] = (unsigned char)num_classes++;
+  }
+  if (!self->case_sensitive)
+  {
+    for (int c = 'A'; c <= 'Z'; ++c)
+    {
+      self->classes[c] = self->classes[c + ('a' - 'A')];
+    }
+  }
+  self->num_classes = num_classes;
+
+  Py_ssize_t max_states = used + 1;
+  if (max_states > INT_MAX / num_classes)
+  {
+    PyMem_Free(bytes);
+    PyMem_Free(ends);
+    PyErr_SetString(PyExc_OverflowError, "too many patterns to compile");
+    return -1;
+  }
+  self->delta = PyMem_Calloc(max_states * num_classes, sizeof(int));
+  self->match = PyMem_Malloc(max_states * sizeof(int));
+  self->output = PyMem_Malloc(max_states * sizeof(int));
+  self->next_output = PyMem_Malloc(max_states * sizeof(int));
+  int *queue = PyMem_Malloc(max_states * sizeof(int));
+  int *fail = PyMem_Malloc(max_states * sizeof(int));
+  if (!self->delta || !self->match || !self->output || !self->next_output || !queue || !fail)
+  {
+    PyMem_Free(bytes);
+    PyMem_Free(ends);
+    PyMem_Free(queue);
+    PyMem_Free(fail);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  // Trie of the patterns. Until the failure links are resolved below, a zero
+  // transition means "no edge": no edge ever leads back to the root.
+  int *delta = self->delta;
+  int num_states = 1;
+  self->match[0] = -1;
+  Py_ssize_t start = 0;
+  for (Py_ssize_t p = 0; p < count; ++p)
+  {
+    int state = 0;
+    for (Py_ssize_t i = start; i < ends[p]; ++i)
+    {
+      int *edge = &delta[(Py_ssize_t)state * num_classes + self->classes[bytes[i]]];
+      if (!*edge)
+      {
+        self->match[num_states] = -1;
+        *edge = num_states++;
+      }
+      state = *edge;
+    }
+    // Later duplicates of a pattern are reported as the first one.
+    if (self->match[state] < 0)
+      self->match[state] = (int)p;
+    start = ends[p];
+  }
+  PyMem_Free(bytes);
+  PyMem_Free(ends);
+
+  // Breadth-first pass: failure links, output chains, and every missing
+  // transition replaced by the one its failure state takes.
+  Py_ssize_t head = 0, tail = 0;
+  self->output[0] = -1;
+  self->next_output[0] = -1;
+  fail[0] = 0;
+  queue[tail++] = 0;
+  while (head < tail)
+  {
+    int state = queue[head++];
+    int *row = &delta[(Py_ssize_t)state * num_classes];
+    const int *fail_row = &delta[(Py_ssize_t)fail[state] * num_classes];
+    for (int c = 0; c < num_classes; ++c)
+    {
+      int child = row[c];
+      if (!child)
+      {
+        row[c] = state ? fail_row[c] : 0;
+        continue;
+      }
+      int link = state ? fail_row[c] : 0;
+      fail[child] = link;
+      self->next_output[child] = self->output[link];
+      self->output[child] = self->match[child] >= 0 ? child : self->output[link];
+      queue[tail++] = child;
+    }
+  }
+  PyMem_Free(queue);
+  PyMem_Free(fail);
+
+  self->num_states = num_states;
+  int *shrunk = PyMem_Realloc(self->delta, (Py_ssize_t)num_states * num_classes * sizeof(int));
+  if (shrunk)
+    self->delta = shrunk;
+  return 0;
+}
+
+PyObject *BStringPatterns_compile(PyObject *patterns, int case_sensitive)
+{
+  if (PyUnicode_Check(patterns))
+  {
+    PyErr_SetString(PyExc_TypeError, "patterns must be an iterable of strings, not a single string");
+    return NULL;
+  }
+  PyObject *tuple = PySequence_Tuple(patterns);
+  if (!tuple)
+    return NULL;
+  for (Py_ssize_t p = 0; p < PyTuple_GET_SIZE(tuple); ++p)
+  {
+    PyObject *pattern = PyTuple_GET_ITEM(tuple, p);
+    if (!PyUnicode_Check(pattern) || PyUnicode_GET_LENGTH(pattern) == 0)
+    {
+      PyErr_SetString(PyUnicode_Check(pattern) ? PyExc_ValueError : PyExc_TypeError, "patterns must be non-empty strings");
+      Py_DECREF(tuple);
+      return NULL;
+    }
+  }
+
+  BStringPatternsObject *self = PyObject_New(BStringPatternsObject, &BStringPatterns_Type);
+  if (!self)
+  {
+    Py_DECREF(tuple);
+    return NULL;
+  }
+  self->patterns = tuple;
+  self->case_sensitive = case_sensitive;
+  self->num_classes = 0;
+  self->num_states = 0;
+  self->delta = NULL;
+  self->output = NULL;
+  self->next_output = NULL;
+  self->match = NULL;
+  self->lengths = NULL;
+  if (BStringPatterns_build(self) < 0)
+  {
+    Py_DECREF(self);
+    return NULL;
+  }
+  return (PyObject *)self;
+}
+
+static int BStringPatterns_append_index(Py_ssize_t index, PyObject *result)
+{
+  PyObject *value = PyLong_FromSsize_t(index);
+  if (!value)
+    return -1;
+  int status = PyList_Append(result, value);
+  Py_DECREF(value);
+  return status;
+}
+
+// Appends an (index, pattern, offset) tuple for each pattern that ends with
+// the code point at end.
+static int BStringPatterns_report(BStringPatternsObject *self, int state, Py_ssize_t end, Py_ssize_t index, PyObject *result)
+{
+  for (int s = self->output[state]; s >= 0; s = self->next_output[s])
+  {
+    int p = self->match[s];
+    PyObject *found = Py_BuildValue("(nOn)", index, PyTuple_GET_ITEM(self->patterns, p), end + 1 - self->lengths[p]);
+    if (!found || PyList_Append(result, found) < 0)
+    {
+      Py_XDECREF(found);
+      return -1;
+    }
+    Py_DECREF(found);
+  }
+  return 0;
+}
+
+// Feeds UTF-8 (or ASCII) bytes through the automaton. Offsets count code
+// points, i.e. bytes that are not continuation bytes.
+static int BStringPatterns_scan_bytes(BStringPatternsObject *self, const unsigned char *bytes, Py_ssize_t length, Py_ssize_t index, PyObject *result, int positions)
+{
+  int state = 0;
+  Py_ssize_t code_point = -1;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    code_point += (bytes[i] & 0xC0) != 0x80;
+    state = BStringPatterns_step(self, state, bytes[i]);
+    if (self->output[state] < 0)
+      continue;
+    if (!positions)
+      return BStringPatterns_append_index(index, result);
+    if (BStringPatterns_report(self, state, code_point, index, result) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Feeds the code points of a non-ASCII item through the automaton, folded
+// when matching ignores case.
+static int BStringPatterns_scan_code_points(BStringPatternsObject *self, PyObject *item, Py_ssize_t index, PyObject *result, int positions)
+{
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  int kind = PyUnicode_KIND(item);
+  const void *data = PyUnicode_DATA(item);
+  int state = 0;
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+    unsigned char encoded[4];
+    int n = BStringPatterns_encode(self->case_sensitive ? ch : BStringSearch_fold(ch), encoded);
+    for (int k = 0; k < n; ++k)
+    {
+      state = BStringPatterns_step(self, state, encoded[k]);
+    }
+    if (self->output[state] < 0)
+      continue;
+    if (!positions)
+      return BStringPatterns_append_index(index, result);
+    if (BStringPatterns_report(self, state, i, index, result) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Scans item.lower() for an item whose simple folding differs from it, and
+// maps the offsets back to the item. Only U+0130 lowers to more than one
+// code point.
+static int BStringPatterns_scan_lowered(BStringPatternsObject *self, PyObject *item, Py_ssize_t index, PyObject *result, int positions)
+{
+  PyObject *lowered = PyObject_CallMethod(item, "lower", NULL);
+  if (!lowered)
+    return -1;
+  Py_ssize_t first = PyList_GET_SIZE(result);
+  int status = BStringPatterns_scan_code_points(self, lowered, index, result, positions);
+  Py_ssize_t lowered_length = PyUnicode_GET_LENGTH(lowered);
+  Py_DECREF(lowered);
+  if (status < 0 || !positions || PyList_GET_SIZE(result) == first)
+    return status;
+
+  Py_ssize_t *origin = PyMem_Malloc((lowered_length + 1) * sizeof(Py_ssize_t));
+  if (!origin)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  int kind = PyUnicode_KIND(item);
+  const void *data = PyUnicode_DATA(item);
+  Py_ssize_t position = 0;
+  for (Py_ssize_t i = 0; i < PyUnicode_GET_LENGTH(item) && position < lowered_length; ++i)
+  {
+    origin[position++] = i;
+    if (PyUnicode_READ(kind, data, i) == 0x130 && position < lowered_length)
+      origin[position++] = i;
+  }
+  for (Py_ssize_t k = first; k < PyList_GET_SIZE(result); ++k)
+  {
+    PyObject *found = PyList_GET_ITEM(result, k);
+    Py_ssize_t offset = PyLong_AsSsize_t(PyTuple_GET_ITEM(found, 2));
+    PyObject *mapped = Py_BuildValue("(nOn)", index, PyTuple_GET_ITEM(found, 1), origin[offset]);
+    if (!mapped)
+    {
+      PyMem_Free(origin);
+      return -1;
+    }
+    PyList_SetItem(result, k, mapped);
+  }
+  PyMem_Free(origin);
+  return 0;
+}
+
+int BStringPatterns_scan(BStringPatternsObject *self, PyObject *item, Py_ssize_t index, PyObject *result, int positions)
+{
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  if (PyUnicode_IS_ASCII(item))
+    return BStringPatterns_scan_bytes(self, PyUnicode_DATA(item), length, index, result, positions);
+  if (!self->case_sensitive)
+  {
+    int kind = PyUnicode_KIND(item);
+    const void *data = PyUnicode_DATA(item);
+    for (Py_ssize_t i = 0; i < length; ++i)
+    {
+      if (BSTRING_NEEDS_FULL_LOWER(PyUnicode_READ(kind, data, i)))
+        return BStringPatterns_scan_lowered(self, item, index, result, positions);
+    }
+  }
+  return BStringPatterns_scan_code_points(self, item, index, result, positions);
+}
+
+// Compact storage items are scanned as they are, except that non-ASCII items
+// are decoded for case-insensitive matching.
+int BStringPatterns_scan_utf8(BStringPatternsObject *self, const char *bytes, Py_ssize_t length, Py_ssize_t index, PyObject *result, int positions)
+{
+  if (self->case_sensitive || BStringSearch_is_ascii(bytes, length))
+    return BStringPatterns_scan_bytes(self, (const unsigned char *)bytes, length, index, result, positions);
+  PyObject *item = PyUnicode_DecodeUTF8(bytes, length, "strict");
+  if (!item)
+    return -1;
+  int status = BStringPatterns_scan(self, item, index, result, positions);
+  Py_DECREF(item);
+  return status;
+}
+
+static PyObject *BStringPatterns_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  PyObject *patterns;
+  int case_sensitive = 1;
+  static char *kwlist[] = {"patterns", "case_sensitive", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p", kwlist, &patterns, &case_sensitive))
+  {
+    return NULL;
+  }
+  return BStringPatterns_compile(patterns, case_sensitive);
+}
+
+static void BStringPatterns_dealloc(BStringPatternsObject *self)
+{
+  Py_XDECREF(self->patterns);
+  PyMem_Free(self->delta);
+  PyMem_Free(self->output);
+  PyMem_Free(self->next_output);
+  PyMem_Free(self->match);
+  PyMem_Free(self->lengths);
+  PyObject_Del(self);
+}
+
+static Py_ssize_t BStringPatterns_length(BStringPatternsObject *self)
+{
+  return PyTuple_GET_SIZE(self->patterns);
+}
+
+static PyObject *BStringPatterns_get_patterns(BStringPatternsObject *self, void *closure)
+{
+  Py_INCREF(self->patterns);
+  return self->patterns;
+}
+
+static PyObject *BStringPatterns_get_case_sensitive(BStringPatternsObject *self, void *closure)
+{
+  return PyBool_FromLong(self->case_sensitive);
+}
+
+static PyGetSetDef BStringPatterns_getsetters[] =
+{
+    {"patterns", (getter)BStringPatterns_get_patterns, NULL, "The compiled patterns as a tuple (read-only).", NULL},
+    {"case_sensitive", (getter)BStringPatterns_get_case_sensitive, NULL, "Whether matching distinguishes case (read-only).", NULL},
+    {NULL} /* Sentinel */
+};
+
+static PySequenceMethods BStringPatterns_as_sequence =
+{
+    (lenfunc)BStringPatterns_length,
+};
+
+PyTypeObject BStringPatterns_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "BeautifulString.BStringPatterns",
+    .tp_doc = "BStringPatterns(patterns, case_sensitive=True)\n\nA set of strings compiled once for BString.find_any().",
+    .tp_basicsize = sizeof(BStringPatternsObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = BStringPatterns_new,
+    .tp_dealloc = (destructor)BStringPatterns_dealloc,
+    .tp_as_sequence = &BStringPatterns_as_sequence,
+    .tp_getset = BStringPatterns_getsetters,
+};
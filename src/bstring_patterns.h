@@ -0,0 +1,42 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_PATTERNS_H
+#define BSTRING_PATTERNS_H
+
+#include "bstring.h"
+
+// A set of patterns compiled into an Aho-Corasick automaton over UTF-8
+// bytes. Transitions are resolved through the failure links at compile time,
+// so scanning a string costs one table lookup per byte however many patterns
+// there are. Input bytes are first mapped to classes: the bytes that occur in
+// the patterns each get one, all other bytes share class 0.
+typedef struct {
+    PyObject_HEAD
+    PyObject *patterns;            // Tuple of the pattern strings, in the order given.
+    int case_sensitive;
+    int num_classes;
+    int num_states;
+    unsigned char classes[256];    // Byte -> class; ASCII letters share a class when !case_sensitive.
+    int *delta;                    // num_states x num_classes transitions.
+    int *output;                   // First state on the failure chain (itself included) where a pattern ends, or -1.
+    int *next_output;              // The next such state after it, or -1.
+    int *match;                    // Pattern ending in each state, or -1.
+    Py_ssize_t *lengths;           // Pattern lengths in code points.
+} BStringPatternsObject;
+
+PyObject *BStringPatterns_compile(PyObject *patterns, int case_sensitive);
+
+// Scan one item and append to result: the index once when any pattern occurs
+// (positions == 0), or an (index, pattern, offset) tuple for every occurrence.
+int BStringPatterns_scan(BStringPatternsObject *self, PyObject *item, Py_ssize_t index, PyObject *result, int positions);
+int BStringPatterns_scan_utf8(BStringPatternsObject *self, const char *bytes, Py_ssize_t length, Py_ssize_t index, PyObject *result, int positions);
+
+extern PyTypeObject BStringPatterns_Type;
+
+#endif // BSTRING_PATTERNS_H
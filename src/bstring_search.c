@@ -0,0 +1,334 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_search.h"
+#include <string.h>
+
+int BStringSearch_cpu_has_avx2(void)
+{
+#if defined(BSTRING_HAVE_AVX2)
+  return 1;
+#elif defined(BSTRING_RUNTIME_AVX2) && defined(_MSC_VER)
+  // CPUID leaf 7 reports AVX2; leaf 1 and XGETBV tell that the operating
+  // system saves the YMM registers.
+  int info[4];
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    return 0;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(BSTRING_RUNTIME_AVX2)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#else
+  return 0;
+#endif
+}
+
+// Compares length ASCII bytes of haystack, folded to lowercase, with an
+// already lowercase needle.
+static inline int BStringSearch_ascii_equal(const char *haystack, const char *needle, Py_ssize_t length)
+{
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    if (Py_TOLOWER((unsigned char)haystack[i]) != (unsigned char)needle[i])
+      return 0;
+  }
+  return 1;
+}
+
+// Exact search of needle in haystack, for ASCII, Latin-1 or UTF-8 text alike
+// (a UTF-8 needle can only match at a character boundary). Like the
+// case-insensitive kernel below, the vector loops compare the first and last
+// needle bytes at 16 or 32 positions per step and only verify candidates.
+Py_ssize_t BStringSearch_bytes(const char *haystack, Py_ssize_t haystack_length, const char *needle, Py_ssize_t needle_length)
+{
+  if (needle_length == 0)
+    return 0;
+  if (needle_length > haystack_length)
+    return -1;
+  if (needle_length == 1)
+  {
+    const char *found = memchr(haystack, needle[0], (size_t)haystack_length);
+    return found ? found - haystack : -1;
+  }
+  Py_ssize_t last = haystack_length - needle_length;
+  Py_ssize_t tail = needle_length - 1;
+  Py_ssize_t i = 0;
+
+#if defined(BSTRING_HAVE_AVX2)
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i final = _mm256_set1_epi8(needle[tail]);
+  for (; i + 32 <= last + 1; i += 32)
+  {
+    __m256i head = _mm256_loadu_si256((const __m256i *)(haystack + i));
+    __m256i end = _mm256_loadu_si256((const __m256i *)(haystack + i + tail));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(end, final)));
+    while (mask)
+    {
+      Py_ssize_t pos = i + BStringSearch_lowest_bit(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, (size_t)(needle_length - 2 > 0 ? needle_length - 2 : 0)) == 0)
+        return pos;
+      mask &= mask - 1;
+    }
+  }
+#elif defined(BSTRING_HAVE_SSE2)
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i final = _mm_set1_epi8(needle[tail]);
+  for (; i + 16 <= last + 1; i += 16)
+  {
+    __m128i head = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i end = _mm_loadu_si128((const __m128i *)(haystack + i + tail));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(end, final)));
+    while (mask)
+    {
+      Py_ssize_t pos = i + BStringSearch_lowest_bit(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, (size_t)(needle_length - 2 > 0 ? needle_length - 2 : 0)) == 0)
+        return pos;
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; i <= last; ++i)
+  {
+    if (haystack[i] == needle[0] && haystack[i + tail] == needle[tail] &&
+        memcmp(haystack + i + 1, needle + 1, (size_t)(needle_length - 2 > 0 ? needle_length - 2 : 0)) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// Case-insensitive search of a lowercase ASCII needle in ASCII text. The
+// vector loops compare the first and last needle bytes, in both cases, at 16
+// or 32 positions per step and only verify the positions where both match.
+Py_ssize_t BStringSearch_ascii_nocase(const char *haystack, Py_ssize_t haystack_length, const char *needle, Py_ssize_t needle_length)
+{
+  if (needle_length == 0)
+    return 0;
+  if (needle_length > haystack_length)
+    return -1;
+  Py_ssize_t last = haystack_length - needle_length;
+  Py_ssize_t tail = needle_length - 1;
+  unsigned char first_lower = (unsigned char)needle[0];
+  unsigned char last_lower = (unsigned char)needle[tail];
+  Py_ssize_t i = 0;
+
+#if defined(BSTRING_HAVE_AVX2)
+  const __m256i first_lo = _mm256_set1_epi8((char)first_lower);
+  const __m256i first_up = _mm256_set1_epi8((char)Py_TOUPPER(first_lower));
+  const __m256i last_lo = _mm256_set1_epi8((char)last_lower);
+  const __m256i last_up = _mm256_set1_epi8((char)Py_TOUPPER(last_lower));
+  for (; i + 32 <= last + 1; i += 32)
+  {
+    __m256i head = _mm256_loadu_si256((const __m256i *)(haystack + i));
+    __m256i end = _mm256_loadu_si256((const __m256i *)(haystack + i + tail));
+    __m256i match = _mm256_and_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(head, first_lo), _mm256_cmpeq_epi8(head, first_up)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(end, last_lo), _mm256_cmpeq_epi8(end, last_up)));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(match);
+    while (mask)
+    {
+      Py_ssize_t pos = i + BStringSearch_lowest_bit(mask);
+      if (BStringSearch_ascii_equal(haystack + pos + 1, needle + 1, needle_length - 2 > 0 ? needle_length - 2 : 0))
+        return pos;
+      mask &= mask - 1;
+    }
+  }
+#elif defined(BSTRING_HAVE_SSE2)
+  const __m128i first_lo = _mm_set1_epi8((char)first_lower);
+  const __m128i first_up = _mm_set1_epi8((char)Py_TOUPPER(first_lower));
+  const __m128i last_lo = _mm_set1_epi8((char)last_lower);
+  const __m128i last_up = _mm_set1_epi8((char)Py_TOUPPER(last_lower));
+  for (; i + 16 <= last + 1; i += 16)
+  {
+    __m128i head = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i end = _mm_loadu_si128((const __m128i *)(haystack + i + tail));
+    __m128i match = _mm_and_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(head, first_lo), _mm_cmpeq_epi8(head, first_up)),
+        _mm_or_si128(_mm_cmpeq_epi8(end, last_lo), _mm_cmpeq_epi8(end, last_up)));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(match);
+    while (mask)
+    {
+      Py_ssize_t pos = i + BStringSearch_lowest_bit(mask);
+      if (BStringSearch_ascii_equal(haystack + pos + 1, needle + 1, needle_length - 2 > 0 ? needle_length - 2 : 0))
+        return pos;
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; i <= last; ++i)
+  {
+    if (Py_TOLOWER((unsigned char)haystack[i]) == first_lower &&
+        Py_TOLOWER((unsigned char)haystack[i + tail]) == last_lower &&
+        BStringSearch_ascii_equal(haystack + i + 1, needle + 1, needle_length - 2 > 0 ? needle_length - 2 : 0))
+      return i;
+  }
+  return -1;
+}
+
+int BStringSearch_is_ascii(const char *bytes, Py_ssize_t length)
+{
+  Py_ssize_t i = 0;
+#if defined(BSTRING_HAVE_SSE2) || defined(BSTRING_HAVE_AVX2)
+  for (; i + 16 <= length; i += 16)
+  {
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(bytes + i))))
+      return 0;
+  }
+#endif
+  for (; i < length; ++i)
+  {
+    if ((unsigned char)bytes[i] & 0x80)
+      return 0;
+  }
+  return 1;
+}
+
+int BStringNeedle_init(BStringNeedle *needle, PyObject *substring, int case_sensitive)
+{
+  needle->case_sensitive = case_sensitive;
+  needle->ascii = NULL;
+  needle->code_points = NULL;
+  if (case_sensitive)
+  {
+    Py_INCREF(substring);
+    needle->text = substring;
+  }
+  else
+  {
+    needle->text = PyObject_CallMethod(substring, "lower", NULL);
+    if (!needle->text)
+      return -1;
+  }
+  needle->length = PyUnicode_GET_LENGTH(needle->text);
+  if (PyUnicode_IS_ASCII(needle->text))
+    needle->ascii = (const char *)PyUnicode_DATA(needle->text);
+  needle->utf8 = PyUnicode_AsUTF8AndSize(needle->text, &needle->utf8_length);
+  if (!needle->utf8)
+  {
+    Py_CLEAR(needle->text);
+    return -1;
+  }
+  if (!case_sensitive)
+  {
+    needle->code_points = PyUnicode_AsUCS4Copy(needle->text);
+    if (!needle->code_points)
+    {
+      Py_CLEAR(needle->text);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void BStringNeedle_clear(BStringNeedle *needle)
+{
+  Py_CLEAR(needle->text);
+  PyMem_Free(needle->code_points);
+  needle->code_points = NULL;
+  needle->ascii = NULL;
+  needle->utf8 = NULL;
+}
+
+// Falls back to Python's full lowercasing for the rare items that need it.
+static int BStringNeedle_search_lowered(BStringNeedle *needle, PyObject *item)
+{
+  PyObject *lowered = PyObject_CallMethod(item, "lower", NULL);
+  if (!lowered)
+    return -1;
+  Py_ssize_t found = PyUnicode_Find(lowered, needle->text, 0, PyUnicode_GET_LENGTH(lowered), 1);
+  Py_DECREF(lowered);
+  if (found == -2)
+    return -1;
+  return found >= 0;
+}
+
+// Case-sensitive matching. One byte strings (ASCII or Latin-1) are searched
+// directly when the needle has the same width; wider strings are left to
+// PyUnicode_Find().
+static int BStringNeedle_search_exact(BStringNeedle *needle, PyObject *item)
+{
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  if (PyUnicode_IS_ASCII(item) && !needle->ascii)
+    return 0;
+  if (PyUnicode_KIND(item) == PyUnicode_1BYTE_KIND)
+  {
+    if (PyUnicode_KIND(needle->text) != PyUnicode_1BYTE_KIND)
+      return 0;
+    return BStringSearch_bytes((const char *)PyUnicode_DATA(item), length,
+                               (const char *)PyUnicode_DATA(needle->text), needle->length) >= 0;
+  }
+  Py_ssize_t found = PyUnicode_Find(item, needle->text, 0, length, 1);
+  if (found == -2)
+    return -1;
+  return found >= 0;
+}
+
+// Returns 1 when item contains the needle, 0 when it does not and -1 on error.
+int BStringNeedle_search(BStringNeedle *needle, PyObject *item)
+{
+  if (needle->case_sensitive)
+    return BStringNeedle_search_exact(needle, item);
+
+  Py_ssize_t length = PyUnicode_GET_LENGTH(item);
+  Py_ssize_t needle_length = needle->length;
+  if (PyUnicode_IS_ASCII(item))
+  {
+    // Lowered ASCII text only contains a needle that is ASCII itself.
+    if (!needle->ascii)
+      return 0;
+    return BStringSearch_ascii_nocase((const char *)PyUnicode_DATA(item), length, needle->ascii, needle_length) >= 0;
+  }
+
+  int kind = PyUnicode_KIND(item);
+  const void *data = PyUnicode_DATA(item);
+  for (Py_ssize_t i = 0; i < length; ++i)
+  {
+    if (BSTRING_NEEDS_FULL_LOWER(PyUnicode_READ(kind, data, i)))
+      return BStringNeedle_search_lowered(needle, item);
+  }
+  if (needle_length == 0)
+    return 1;
+
+  const Py_UCS4 *code_points = needle->code_points;
+  for (Py_ssize_t i = 0; i + needle_length <= length; ++i)
+  {
+    if (BStringSearch_fold(PyUnicode_READ(kind, data, i)) != code_points[0])
+      continue;
+    Py_ssize_t j = 1;
+    while (j < needle_length && BStringSearch_fold(PyUnicode_READ(kind, data, i + j)) == code_points[j])
+      j++;
+    if (j == needle_length)
+      return 1;
+  }
+  return 0;
+}
+
+// BStringNeedle_search() for UTF-8 bytes, as held by compact storage.
+// Case-sensitive matching never decodes; otherwise only non-ASCII items are.
+int BStringNeedle_search_utf8(BStringNeedle *needle, const char *bytes, Py_ssize_t length)
+{
+  if (needle->case_sensitive)
+    return BStringSearch_bytes(bytes, length, needle->utf8, needle->utf8_length) >= 0;
+  if (BStringSearch_is_ascii(bytes, length))
+  {
+    if (!needle->ascii)
+      return 0;
+    return BStringSearch_ascii_nocase(bytes, length, needle->ascii, needle->length) >= 0;
+  }
+  PyObject *item = PyUnicode_DecodeUTF8(bytes, length, "strict");
+  if (!item)
+    return -1;
+  int found = BStringNeedle_search(needle, item);
+  Py_DECREF(item);
+  return found;
+}
@@ -0,0 +1,112 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_SEARCH_H
+#define BSTRING_SEARCH_H
+
+#include "bstring.h"
+
+// Vector extensions available to the search kernels. SSE2 is part of every
+// x86-64 target; SSSE3 and AVX2 are used when the compiler is told the CPU
+// has them.
+#if defined(__AVX2__)
+#define BSTRING_HAVE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BSTRING_HAVE_SSE2 1
+#endif
+#if defined(__SSSE3__) || defined(BSTRING_HAVE_AVX2)
+#define BSTRING_HAVE_SSSE3 1
+#endif
+// AVX2 kernels that are built into every x86-64 module and used when the CPU
+// turns out to have AVX2 (BStringSearch_cpu_has_avx2). GCC and Clang compile
+// them with a target attribute; MSVC accepts AVX2 intrinsics without one.
+#if defined(BSTRING_HAVE_AVX2)
+#define BSTRING_RUNTIME_AVX2 1
+#define BSTRING_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BSTRING_RUNTIME_AVX2 1
+#define BSTRING_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define BSTRING_RUNTIME_AVX2 1
+#define BSTRING_TARGET_AVX2
+#endif
+#if defined(BSTRING_HAVE_AVX2) || defined(BSTRING_RUNTIME_AVX2)
+#include <immintrin.h>
+#elif defined(BSTRING_HAVE_SSSE3)
+#include <tmmintrin.h>
+#elif defined(BSTRING_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 1 when the CPU and the operating system support AVX2.
+int BStringSearch_cpu_has_avx2(void);
+
+// Index of the lowest set bit of a non-zero movemask result.
+static inline int BStringSearch_lowest_bit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+  unsigned long bit;
+  _BitScanForward(&bit, mask);
+  return (int)bit;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+static inline int BStringSearch_lowest_bit64(unsigned long long mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long bit;
+  _BitScanForward64(&bit, mask);
+  return (int)bit;
+#elif defined(_MSC_VER)
+  unsigned int low = (unsigned int)mask;
+  return low ? BStringSearch_lowest_bit(low) : 32 + BStringSearch_lowest_bit((unsigned int)(mask >> 32));
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+
+// Code points whose str.lower() differs from their simple lowercase mapping:
+// U+0130 lowers to two code points and U+03A3 depends on its context (final
+// sigma). Items containing them are lowered by Python instead.
+#define BSTRING_NEEDS_FULL_LOWER(ch) ((ch) == 0x130 || (ch) == 0x3A3)
+
+// Simple (one to one) lowercase mapping of a code point.
+static inline Py_UCS4 BStringSearch_fold(Py_UCS4 ch)
+{
+  return ch < 128 ? (Py_UCS4)Py_TOLOWER(ch) : Py_UNICODE_TOLOWER(ch);
+}
+
+// A substring prepared once for matching against many strings. With
+// case_sensitive set matching is `needle in item`, otherwise it follows
+// `needle.lower() in item.lower()` without creating the lowered strings.
+typedef struct {
+    PyObject *text;                // The needle, lowered when matching ignores case.
+    int case_sensitive;
+    const char *ascii;             // The bytes of text when it is ASCII, otherwise NULL.
+    const char *utf8;              // text encoded as UTF-8, for compact storage.
+    Py_ssize_t utf8_length;
+    Py_UCS4 *code_points;          // The code points of text, when matching ignores case.
+    Py_ssize_t length;
+} BStringNeedle;
+
+int BStringNeedle_init(BStringNeedle *needle, PyObject *substring, int case_sensitive);
+void BStringNeedle_clear(BStringNeedle *needle);
+int BStringNeedle_search(BStringNeedle *needle, PyObject *item);
+int BStringNeedle_search_utf8(BStringNeedle *needle, const char *bytes, Py_ssize_t length);
+
+Py_ssize_t BStringSearch_bytes(const char *haystack, Py_ssize_t haystack_length, const char *needle, Py_ssize_t needle_length);
+Py_ssize_t BStringSearch_ascii_nocase(const char *haystack, Py_ssize_t haystack_length, const char *needle, Py_ssize_t needle_length);
+int BStringSearch_is_ascii(const char *bytes, Py_ssize_t length);
+
+#endif // BSTRING_SEARCH_H
@@ -0,0 +1,1149 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring_storage.h"
+#include <stddef.h>
+#include <string.h>
+
+// Allocates a slab of num_chunks chunks and threads them onto the free list.
+static int BString_add_slab(BStringObject *self, Py_ssize_t num_chunks)
+{
+  Slab *slab = PyMem_Malloc(sizeof(Slab) + num_chunks * sizeof(BStringChunk));
+  if (!slab)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  slab->num_chunks = num_chunks;
+  slab->live_chunks = 0;
+  slab->owner = self;
+  slab->next = self->slabs;
+  self->slabs = slab;
+
+  BStringChunk *chunks = (BStringChunk *)(slab + 1);
+  for (Py_ssize_t i = num_chunks - 1; i >= 0; --i)
+  {
+    chunks[i].slab = slab;
+    chunks[i].next_free = self->free_chunks;
+    self->free_chunks = &chunks[i];
+  }
+  self->slab_chunks += num_chunks;
+  return 0;
+}
+
+// Allocates a chunk for capacity items: a full-size one from the slabs, or
+// a smaller one on its own.
+static BStringChunk *new_BStringChunk(BStringObject *self, Py_ssize_t capacity)
+{
+  BStringChunk *chunk;
+  if (capacity < BSTRING_CHUNK_CAPACITY)
+  {
+    chunk = PyMem_Malloc(offsetof(BStringChunk, items) + capacity * sizeof(PyObject *));
+    if (!chunk)
+    {
+      PyErr_NoMemory();
+      return NULL;
+    }
+    chunk->slab = NULL;
+  }
+  else
+  {
+    if (!self->free_chunks)
+    {
+      // Grow slabs with the number of chunks handed out so far.
+      Py_ssize_t num_chunks = self->slab_chunks ? self->slab_chunks : 1;
+      if (num_chunks > BSTRING_SLAB_MAX_CHUNKS)
+        num_chunks = BSTRING_SLAB_MAX_CHUNKS;
+      if (BString_add_slab(self, num_chunks) < 0)
+        return NULL;
+    }
+    chunk = self->free_chunks;
+    self->free_chunks = chunk->next_free;
+    chunk->slab->live_chunks++;
+    capacity = BSTRING_CHUNK_CAPACITY;
+  }
+  chunk->next_free = NULL;
+  chunk->refs = 1;
+  chunk->capacity = capacity;
+  return chunk;
+}
+
+// Drops one directory reference to chunk, whose first count items are in use.
+// The last reference releases the items and returns the chunk to the free
+// list of the BString that allocated it, or frees the slab once that BString
+// is gone and nothing else uses the slab.
+static void release_BStringChunk(BStringChunk *chunk, Py_ssize_t count)
+{
+  if (--chunk->refs > 0)
+    return;
+
+  for (Py_ssize_t i = 0; i < count; ++i)
+  {
+    Py_DECREF(chunk->items[i]);
+  }
+
+  Slab *slab = chunk->slab;
+  if (!slab)
+  {
+    PyMem_Free(chunk);
+    return;
+  }
+  slab->live_chunks--;
+  if (slab->owner)
+  {
+    chunk->next_free = slab->owner->free_chunks;
+    slab->owner->free_chunks = chunk;
+  }
+  else if (slab->live_chunks == 0)
+  {
+    PyMem_Free(slab);
+  }
+}
+
+static int BString_grow_directory(BStringObject *self, Py_ssize_t needed)
+{
+  if (needed <= self->chunks_allocated)
+    return 0;
+
+  Py_ssize_t new_allocated = self->chunks_allocated ? self->chunks_allocated * 2 : 1;
+  while (new_allocated < needed)
+    new_allocated *= 2;
+
+  BStringChunk **chunks = PyMem_Realloc(self->chunks, new_allocated * sizeof(BStringChunk *));
+  if (!chunks)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  self->chunks = chunks;
+
+  Py_ssize_t *chunk_counts = PyMem_Realloc(self->chunk_counts, new_allocated * sizeof(Py_ssize_t));
+  if (!chunk_counts)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  self->chunk_counts = chunk_counts;
+
+  Py_ssize_t *count_tree = PyMem_Realloc(self->count_tree, (new_allocated + 1) * sizeof(Py_ssize_t));
+  if (!count_tree)
+  {
+    PyErr_NoMemory();
+    return -1;
+  }
+  self->count_tree = count_tree;
+  self->chunks_allocated = new_allocated;
+  return 0;
+}
+
+// The count tree is a Fenwick tree over chunk_counts: count_tree[i] holds the
+// total of chunks (i - lowbit(i), i] (1-based), so locating the chunk that
+// holds a sequence index and updating a chunk's count both take O(log n).
+// Slot i only depends on chunks before it, so inserting or dropping a chunk
+// at position pos invalidates the slots past pos and nothing else; they are
+// recomputed lazily, in one sequential pass, by the next lookup.
+
+static void BString_invalidate_count_tree(BStringObject *self, Py_ssize_t pos)
+{
+  if (self->count_tree_valid > pos)
+    self->count_tree_valid = pos;
+  if (self->cached_chunk >= pos)
+    self->cached_chunk = -1;
+}
+
+// Records that the chunk at position pos gained (or lost) delta items.
+static void BString_adjust_count(BStringObject *self, Py_ssize_t pos, Py_ssize_t delta)
+{
+  self->chunk_counts[pos] += delta;
+  if (self->cached_chunk > pos)
+    self->cached_chunk = -1;
+  for (Py_ssize_t i = pos + 1; i <= self->count_tree_valid; i += i & -i)
+  {
+    self->count_tree[i] += delta;
+  }
+}
+
+static void BString_refresh_count_tree(BStringObject *self)
+{
+  for (Py_ssize_t i = self->count_tree_valid + 1; i <= self->num_chunks; ++i)
+  {
+    // Slot i is chunk i - 1 plus the slots i - 1, i - 2, i - 4, ... it covers.
+    Py_ssize_t total = self->chunk_counts[i - 1];
+    for (Py_ssize_t child = 1; child < (i & -i); child *= 2)
+    {
+      total += self->count_tree[i - child];
+    }
+    self->count_tree[i] = total;
+  }
+  self->count_tree_valid = self->num_chunks;
+}
+
+// Inserts an empty chunk for capacity items into the directory at position pos.
+static BStringChunk *BString_insert_chunk(BStringObject *self, Py_ssize_t pos, Py_ssize_t capacity)
+{
+  if (BString_grow_directory(self, self->num_chunks + 1) < 0)
+    return NULL;
+  BStringChunk *chunk = new_BStringChunk(self, capacity);
+  if (!chunk)
+    return NULL;
+
+  Py_ssize_t tail = self->num_chunks - pos;
+  memmove(&self->chunks[pos + 1], &self->chunks[pos], tail * sizeof(BStringChunk *));
+  memmove(&self->chunk_counts[pos + 1], &self->chunk_counts[pos], tail * sizeof(Py_ssize_t));
+  self->chunks[pos] = chunk;
+  self->chunk_counts[pos] = 0;
+  self->num_chunks++;
+  BString_invalidate_count_tree(self, pos);
+  return chunk;
+}
+
+// Replaces a shared chunk at position pos with a private copy, so that it can
+// be written to without affecting the other BStrings that reference it.
+static int BString_own_chunk(BStringObject *self, Py_ssize_t pos)
+{
+  BStringChunk *shared = self->chunks[pos];
+  if (shared->refs == 1)
+    return 0;
+
+  BStringChunk *chunk = new_BStringChunk(self, shared->capacity);
+  if (!chunk)
+    return -1;
+  Py_ssize_t count = self->chunk_counts[pos];
+  for (Py_ssize_t i = 0; i < count; ++i)
+  {
+    Py_INCREF(shared->items[i]);
+    chunk->items[i] = shared->items[i];
+  }
+  release_BStringChunk(shared, count);
+  self->chunks[pos] = chunk;
+  return 0;
+}
+
+// Grows the chunk at pos, which must not be shared and must be smaller than
+// full size, to hold at least needed items. Its capacity at least doubles,
+// and it moves into a slab once it reaches full size.
+static int BString_grow_chunk(BStringObject *self, Py_ssize_t pos, Py_ssize_t needed)
+{
+  BStringChunk *chunk = self->chunks[pos];
+  Py_ssize_t capacity = chunk->capacity * 2 > needed ? chunk->capacity * 2 : needed;
+  if (capacity > BSTRING_CHUNK_CAPACITY)
+    capacity = BSTRING_CHUNK_CAPACITY;
+  BStringChunk *grown;
+  if (capacity < BSTRING_CHUNK_CAPACITY)
+  {
+    grown = PyMem_Realloc(chunk, offsetof(BStringChunk, items) + capacity * sizeof(PyObject *));
+    if (!grown)
+    {
+      PyErr_NoMemory();
+      return -1;
+    }
+    grown->capacity = capacity;
+  }
+  else
+  {
+    grown = new_BStringChunk(self, capacity);
+    if (!grown)
+      return -1;
+    memcpy(grown->items, chunk->items, self->chunk_counts[pos] * sizeof(PyObject *));
+    PyMem_Free(chunk);
+  }
+  self->chunks[pos] = grown;
+  return 0;
+}
+
+// The position of a chunk at the end of the directory with room for more
+// items, making one when the last chunk is full or shared. The first chunk
+// is sized for wanted items and later ones are full-size. Returns -1 when
+// memory runs out.
+static Py_ssize_t BString_tail_chunk(BStringObject *self, Py_ssize_t wanted)
+{
+  Py_ssize_t last = self->num_chunks - 1;
+  if (last >= 0 && self->chunks[last]->refs == 1)
+  {
+    Py_ssize_t count = self->chunk_counts[last];
+    if (count < self->chunks[last]->capacity)
+      return last;
+    if (count < BSTRING_CHUNK_CAPACITY)
+      return BString_grow_chunk(self, last, count + wanted) < 0 ? -1 : last;
+  }
+  Py_ssize_t capacity = BSTRING_CHUNK_CAPACITY;
+  if (last < 0 && wanted < BSTRING_CHUNK_CAPACITY)
+    capacity = wanted > BSTRING_CHUNK_MIN_CAPACITY ? wanted : BSTRING_CHUNK_MIN_CAPACITY;
+  if (!BString_insert_chunk(self, self->num_chunks, capacity))
+    return -1;
+  return last + 1;
+}
+
+// Removes a chunk from the directory, releasing the items it still counts.
+static void BString_drop_chunk(BStringObject *self, Py_ssize_t pos)
+{
+  Py_ssize_t tail = self->num_chunks - pos - 1;
+  release_BStringChunk(self->chunks[pos], self->chunk_counts[pos]);
+  memmove(&self->chunks[pos], &self->chunks[pos + 1], tail * sizeof(BStringChunk *));
+  memmove(&self->chunk_counts[pos], &self->chunk_counts[pos + 1], tail * sizeof(Py_ssize_t));
+  self->num_chunks--;
+  BString_invalidate_count_tree(self, pos);
+}
+
+// Folds chunk pos + 1 into chunk pos when both are sparse, so long runs of
+// deletions do not leave the directory full of nearly empty blocks. Merging
+// is an optimisation only, so it is skipped if copying a shared chunk fails.
+static void BString_merge_chunks(BStringObject *self, Py_ssize_t pos)
+{
+  if (pos < 0 || pos + 1 >= self->num_chunks)
+    return;
+  Py_ssize_t left_count = self->chunk_counts[pos];
+  Py_ssize_t right_count = self->chunk_counts[pos + 1];
+  if (left_count + right_count > BSTRING_CHUNK_CAPACITY / 2)
+    return;
+  if (BString_own_chunk(self, pos) < 0 ||
+      (self->chunks[pos]->capacity < left_count + right_count && BString_grow_chunk(self, pos, left_count + right_count) < 0))
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  BStringChunk *left = self->chunks[pos];
+  BStringChunk *right = self->chunks[pos + 1];
+  for (Py_ssize_t i = 0; i < right_count; ++i)
+  {
+    Py_INCREF(right->items[i]);
+    left->items[left_count + i] = right->items[i];
+  }
+  self->chunk_counts[pos] += right_count;
+  BString_invalidate_count_tree(self, pos);
+  BString_drop_chunk(self, pos + 1);
+}
+
+// Resolves index against the chunk of the previous lookup, its neighbours and
+// the last chunk, so sequential and tail accesses skip the tree descent.
+// Returns -1 when none of them holds index.
+static Py_ssize_t BString_find_chunk_nearby(BStringObject *self, Py_ssize_t index, Py_ssize_t *offset)
+{
+  Py_ssize_t c = self->cached_chunk;
+  if (c >= 0)
+  {
+    Py_ssize_t base = self->cached_base;
+    if (index >= base)
+    {
+      for (; c < self->num_chunks && c <= self->cached_chunk + 1; base += self->chunk_counts[c++])
+      {
+        if (index < base + self->chunk_counts[c])
+        {
+          self->cached_chunk = c;
+          self->cached_base = base;
+          *offset = index - base;
+          return c;
+        }
+      }
+    }
+    else if (c > 0 && index >= base - self->chunk_counts[c - 1])
+    {
+      self->cached_chunk = c - 1;
+      self->cached_base = base - self->chunk_counts[c - 1];
+      *offset = index - self->cached_base;
+      return c - 1;
+    }
+  }
+
+  Py_ssize_t last = self->num_chunks - 1;
+  Py_ssize_t tail_base = self->size - self->chunk_counts[last];
+  if (index >= tail_base)
+  {
+    self->cached_chunk = last;
+    self->cached_base = tail_base;
+    *offset = index - tail_base;
+    return last;
+  }
+  return -1;
+}
+
+// Returns the directory position of the chunk holding index (0 <= index < size)
+// and stores the position inside that chunk in *offset.
+static Py_ssize_t BString_find_chunk(BStringObject *self, Py_ssize_t index, Py_ssize_t *offset)
+{
+  Py_ssize_t nearby = BString_find_chunk_nearby(self, index, offset);
+  if (nearby >= 0)
+    return nearby;
+
+  if (self->count_tree_valid < self->num_chunks)
+    BString_refresh_count_tree(self);
+
+  Py_ssize_t step = 1;
+  while (step * 2 <= self->num_chunks)
+    step *= 2;
+
+  Py_ssize_t pos = 0;
+  Py_ssize_t remaining = index;
+  for (; step > 0; step /= 2)
+  {
+    if (pos + step <= self->num_chunks && self->count_tree[pos + step] <= remaining)
+    {
+      pos += step;
+      remaining -= self->count_tree[pos];
+    }
+  }
+  self->cached_chunk = pos;
+  self->cached_base = index - remaining;
+  *offset = remaining;
+  return pos;
+}
+
+// Gives self a private copy of an arena that another holder (a threaded
+// map() or filter()) still reads.
+static int BString_own_arena(BStringObject *self)
+{
+  if (self->arena->refs == 1)
+    return 0;
+  BStringArena *copy = BStringArena_copy(self->arena);
+  if (!copy)
+    return -1;
+  BStringArena_free(self->arena);
+  self->arena = copy;
+  return 0;
+}
+
+// Every item of a BString is a str: the index, set and rendering code read
+// string data directly. Raises TypeError and returns -1 for anything else.
+static int BString_check_item(PyObject *item)
+{
+  if (PyUnicode_Check(item))
+    return 0;
+  PyErr_Format(PyExc_TypeError, "BString items must be strings, not %.50s", Py_TYPE(item)->tp_name);
+  return -1;
+}
+
+int BString_push(BStringObject *self, PyObject *item)
+{
+  if (BString_check_item(item) < 0)
+    return -1;
+  if (self->index && BStringIndex_reserve(self->index, 1) < 0)
+    return -1;
+  if (self->arena)
+  {
+    if (BString_own_arena(self) < 0)
+      return -1;
+    if (BStringArena_append_object(self->arena, item) == 0)
+    {
+      if (self->index)
+        BStringIndex_add(self->index, item, self->size);
+      if (self->size == 0)
+        self->current = 0;
+      self->size++;
+      return 0;
+    }
+    // Strings without a UTF-8 form (lone surrogates) can only be held as objects.
+    if (!PyErr_ExceptionMatches(PyExc_UnicodeEncodeError))
+      return -1;
+    PyErr_Clear();
+    if (BString_expand_arena(self) < 0)
+      return -1;
+  }
+
+  Py_ssize_t last = BString_tail_chunk(self, 1);
+  if (last < 0)
+    return -1;
+  Py_INCREF(item);
+  self->chunks[last]->items[self->chunk_counts[last]] = item;
+  BString_adjust_count(self, last, 1);
+  if (self->index)
+    BStringIndex_add(self->index, item, self->size);
+  if (self->size == 0)
+    self->current = 0;
+  self->size++;
+  return 0;
+}
+
+// Prepares for count items to be appended: grows the directory once and
+// carves every chunk they need out of full-size slabs up front. An empty
+// BString that needs less than a chunk gets its first chunk when the items
+// arrive, sized to them.
+int BString_reserve(BStringObject *self, Py_ssize_t count)
+{
+  if (self->arena || count <= 0 || (self->num_chunks == 0 && count < BSTRING_CHUNK_CAPACITY))
+    return 0;
+
+  Py_ssize_t last = self->num_chunks - 1;
+  if (last >= 0 && self->chunks[last]->refs == 1)
+    count -= BSTRING_CHUNK_CAPACITY - self->chunk_counts[last];
+  if (count <= 0)
+    return 0;
+  Py_ssize_t needed = (count + BSTRING_CHUNK_CAPACITY - 1) / BSTRING_CHUNK_CAPACITY;
+  if (BString_grow_directory(self, self->num_chunks + needed) < 0)
+    return -1;
+
+  for (BStringChunk *chunk = self->free_chunks; chunk && needed > 0; chunk = chunk->next_free)
+  {
+    needed--;
+  }
+  while (needed > 0)
+  {
+    Py_ssize_t num_chunks = needed < BSTRING_SLAB_MAX_CHUNKS ? needed : BSTRING_SLAB_MAX_CHUNKS;
+    if (BString_add_slab(self, num_chunks) < 0)
+      return -1;
+    needed -= num_chunks;
+  }
+  return 0;
+}
+
+// Appends n strings from a contiguous array, filling each chunk with one
+// copy and one count update instead of going through BString_push per item.
+int BString_push_array(BStringObject *self, PyObject *const *items, Py_ssize_t n)
+{
+  for (Py_ssize_t i = 0; i < n; ++i)
+  {
+    if (BString_check_item(items[i]) < 0)
+      return -1;
+  }
+  if (self->arena)
+  {
+    for (Py_ssize_t i = 0; i < n; ++i)
+    {
+      if (BString_push(self, items[i]) != 0)
+        return -1;
+    }
+    return 0;
+  }
+  if (BString_reserve(self, n) < 0)
+    return -1;
+  if (self->index && BStringIndex_reserve(self->index, n) < 0)
+    return -1;
+
+  Py_ssize_t done = 0;
+  while (done < n)
+  {
+    Py_ssize_t last = BString_tail_chunk(self, n - done);
+    if (last < 0)
+      return -1;
+    Py_ssize_t count = self->chunk_counts[last];
+    Py_ssize_t take = self->chunks[last]->capacity - count;
+    if (take > n - done)
+      take = n - done;
+    PyObject **slots = &self->chunks[last]->items[count];
+    for (Py_ssize_t i = 0; i < take; ++i)
+    {
+      Py_INCREF(items[done + i]);
+      slots[i] = items[done + i];
+      if (self->index)
+        BStringIndex_add(self->index, items[done + i], self->size + i);
+    }
+    BString_adjust_count(self, last, take);
+    if (self->size == 0)
+      self->current = 0;
+    self->size += take;
+    done += take;
+  }
+  return 0;
+}
+
+int BString_insert_at(BStringObject *self, Py_ssize_t index, PyObject *item)
+{
+  if (BString_check_item(item) < 0)
+    return -1;
+  if (index >= self->size)
+    return BString_push(self, item);
+  if (index < 0)
+    index = 0;
+  if (self->arena && BString_expand_arena(self) < 0)
+    return -1;
+  if (self->index && BStringIndex_reserve(self->index, 1) < 0)
+    return -1;
+
+  Py_ssize_t offset;
+  Py_ssize_t c = BString_find_chunk(self, index, &offset);
+  if (BString_own_chunk(self, c) < 0)
+    return -1;
+
+  if (self->chunk_counts[c] == self->chunks[c]->capacity && self->chunk_counts[c] < BSTRING_CHUNK_CAPACITY)
+  {
+    if (BString_grow_chunk(self, c, self->chunk_counts[c] + 1) < 0)
+      return -1;
+  }
+  else if (self->chunk_counts[c] == BSTRING_CHUNK_CAPACITY)
+  {
+    BStringChunk *sibling = BString_insert_chunk(self, c + 1, BSTRING_CHUNK_CAPACITY);
+    if (!sibling)
+      return -1;
+    Py_ssize_t half = BSTRING_CHUNK_CAPACITY / 2;
+    memcpy(sibling->items, &self->chunks[c]->items[half], (BSTRING_CHUNK_CAPACITY - half) * sizeof(PyObject *));
+    BString_adjust_count(self, c, half - BSTRING_CHUNK_CAPACITY);
+    BString_adjust_count(self, c + 1, BSTRING_CHUNK_CAPACITY - half);
+    if (offset > half)
+    {
+      offset -= half;
+      c++;
+    }
+  }
+
+  BStringChunk *chunk = self->chunks[c];
+  self->mod_count++;
+  memmove(&chunk->items[offset + 1], &chunk->items[offset], (self->chunk_counts[c] - offset) * sizeof(PyObject *));
+  Py_INCREF(item);
+  chunk->items[offset] = item;
+  BString_adjust_count(self, c, 1);
+  if (self->index)
+  {
+    BStringIndex_shifted(self->index, index, 1);
+    BStringIndex_add(self->index, item, index);
+  }
+
+  if (index <= self->current)
+    self->current++;
+  self->size++;
+  return 0;
+}
+
+PyObject *BString_item_at(BStringObject *self, Py_ssize_t index)
+{
+  Py_ssize_t offset;
+  Py_ssize_t c = BString_find_chunk(self, index, &offset);
+  return self->chunks[c]->items[offset];
+}
+
+// Returns a new reference to the item at index in either storage mode.
+PyObject *BString_fetch_at(BStringObject *self, Py_ssize_t index)
+{
+  if (self->arena)
+    return BStringArena_item(self->arena, index);
+  PyObject *item = BString_item_at(self, index);
+  Py_INCREF(item);
+  return item;
+}
+
+int BString_replace_at(BStringObject *self, Py_ssize_t index, PyObject *item)
+{
+  if (BString_check_item(item) < 0)
+    return -1;
+  if (self->arena && BString_expand_arena(self) < 0)
+    return -1;
+  if (self->index && BStringIndex_reserve(self->index, 1) < 0)
+    return -1;
+  Py_ssize_t offset;
+  Py_ssize_t c = BString_find_chunk(self, index, &offset);
+  if (BString_own_chunk(self, c) < 0)
+    return -1;
+  PyObject *old = self->chunks[c]->items[offset];
+  Py_INCREF(item);
+  self->chunks[c]->items[offset] = item;
+  self->mod_count++;
+  if (self->index)
+  {
+    BStringIndex_discard(self->index, old, index);
+    BStringIndex_add(self->index, item, index);
+  }
+  Py_DECREF(old);
+  return 0;
+}
+
+PyObject *BString_take_at(BStringObject *self, Py_ssize_t index)
+{
+  if (self->arena && BString_expand_arena(self) < 0)
+    return NULL;
+  Py_ssize_t offset;
+  Py_ssize_t c = BString_find_chunk(self, index, &offset);
+  if (BString_own_chunk(self, c) < 0)
+    return NULL;
+  BStringChunk *chunk = self->chunks[c];
+  PyObject *item = chunk->items[offset];
+
+  self->mod_count++;
+  if (self->index)
+  {
+    BStringIndex_discard(self->index, item, index);
+    if (index < self->size - 1)
+      BStringIndex_shifted(self->index, index, -1);
+  }
+  BString_adjust_count(self, c, -1);
+  memmove(&chunk->items[offset], &chunk->items[offset + 1], (self->chunk_counts[c] - offset) * sizeof(PyObject *));
+  if (self->chunk_counts[c] == 0)
+  {
+    BString_drop_chunk(self, c);
+  }
+  else
+  {
+    BString_merge_chunks(self, c);
+  }
+
+  if (index < self->current)
+    self->current--;
+  else if (index == self->current)
+    self->current = 0;
+  self->size--;
+  return item;
+}
+
+int BString_delete_range(BStringObject *self, Py_ssize_t start, Py_ssize_t stop)
+{
+  if (start >= stop)
+    return 0;
+  if (self->arena && BString_expand_arena(self) < 0)
+    return -1;
+  if (self->index)
+  {
+    // Not undone if the deletion fails below; the index is dropped then.
+    BStringWalk walk;
+    BString_walk_init_range(&walk, self, start, 1, stop - start);
+    PyObject *item;
+    for (Py_ssize_t i = start; (item = BString_walk_next(&walk)); ++i)
+    {
+      BStringIndex_discard(self->index, item, i);
+    }
+    if (stop < self->size)
+      BStringIndex_shifted(self->index, start, start - stop);
+  }
+
+  Py_ssize_t offset;
+  Py_ssize_t first = BString_find_chunk(self, start, &offset);
+  Py_ssize_t c = first;
+  Py_ssize_t remaining = stop - start;
+  self->mod_count++;
+
+  while (remaining > 0 && c < self->num_chunks)
+  {
+    Py_ssize_t count = self->chunk_counts[c];
+    Py_ssize_t n = count - offset;
+    if (n > remaining)
+      n = remaining;
+    remaining -= n;
+    self->size -= n;
+
+    if (n == count)
+    {
+      // Whole chunk: drop the reference without copying even if it is shared.
+      BString_drop_chunk(self, c);
+      offset = 0;
+      continue;
+    }
+
+    if (BString_own_chunk(self, c) < 0)
+    {
+      self->size += n;
+      BString_drop_index(self);
+      return -1;
+    }
+    BStringChunk *chunk = self->chunks[c];
+    for (Py_ssize_t i = offset; i < offset + n; ++i)
+    {
+      Py_DECREF(chunk->items[i]);
+    }
+    memmove(&chunk->items[offset], &chunk->items[offset + n], (count - offset - n) * sizeof(PyObject *));
+    BString_adjust_count(self, c, -n);
+    c++;
+    offset = 0;
+  }
+
+  BString_merge_chunks(self, first);
+  BString_merge_chunks(self, first - 1);
+  self->current = 0;
+  return 0;
+}
+
+// Appends the items of source by referencing its chunks instead of copying
+// them. Sparse chunks are copied item by item so that repeating or
+// concatenating small BStrings does not produce a directory of tiny chunks.
+int BString_push_shared(BStringObject *self, BStringObject *source)
+{
+  // Rebuilt by the next lookup rather than updated item by item.
+  BString_drop_index(self);
+  if (source->arena)
+  {
+    if (self->arena && BString_own_arena(self) < 0)
+      return -1;
+    Py_ssize_t count = source->arena->count;
+    for (Py_ssize_t i = 0; i < count; ++i)
+    {
+      int status;
+      if (self->arena)
+      {
+        Py_ssize_t length;
+        const char *bytes = BStringArena_bytes(source->arena, i, &length);
+        status = BStringArena_append(self->arena, bytes, length);
+        if (status == 0)
+          self->size++;
+      }
+      else
+      {
+        PyObject *item = BStringArena_item(source->arena, i);
+        if (!item)
+          return -1;
+        status = BString_push(self, item);
+        Py_DECREF(item);
+      }
+      if (status != 0)
+        return -1;
+    }
+    return 0;
+  }
+  if (self->arena)
+  {
+    BStringWalk walk;
+    BString_walk_init(&walk, source, 0);
+    PyObject *item;
+    while ((item = BString_walk_next(&walk)))
+    {
+      if (BString_push(self, item) != 0)
+        return -1;
+    }
+    return 0;
+  }
+
+  if (source == self)
+  {
+    // Copied sparse chunks would land in the chunks still being read, so
+    // self is appended through a snapshot that shares them.
+    BStringObject *snapshot = (BStringObject *)BStringType.tp_new(&BStringType, NULL, NULL);
+    if (!snapshot)
+      return -1;
+    int status = BString_push_shared(snapshot, self);
+    if (status == 0)
+      status = BString_push_shared(self, snapshot);
+    Py_DECREF(snapshot);
+    return status;
+  }
+
+  Py_ssize_t num_chunks = source->num_chunks;
+  if (BString_grow_directory(self, self->num_chunks + num_chunks) < 0)
+    return -1;
+
+  for (Py_ssize_t c = 0; c < num_chunks; ++c)
+  {
+    BStringChunk *chunk = source->chunks[c];
+    Py_ssize_t count = source->chunk_counts[c];
+    if (count < BSTRING_CHUNK_CAPACITY / 2)
+    {
+      for (Py_ssize_t i = 0; i < count; ++i)
+      {
+        if (BString_push(self, chunk->items[i]) != 0)
+          return -1;
+      }
+      continue;
+    }
+
+    Py_ssize_t pos = self->num_chunks;
+    chunk->refs++;
+    self->chunks[pos] = chunk;
+    self->chunk_counts[pos] = count;
+    self->num_chunks++;
+    BString_invalidate_count_tree(self, pos);
+    if (self->size == 0)
+      self->current = 0;
+    self->size += count;
+  }
+  return 0;
+}
+
+void BString_clear_storage(BStringObject *self)
+{
+  self->mod_count++;
+  for (Py_ssize_t c = 0; c < self->num_chunks; ++c)
+  {
+    release_BStringChunk(self->chunks[c], self->chunk_counts[c]);
+  }
+
+  // Slabs with chunks still shared by other BStrings outlive their owner and
+  // are freed by the last release_BStringChunk().
+  Slab *slab = self->slabs;
+  while (slab)
+  {
+    Slab *next = slab->next;
+    if (slab->live_chunks == 0)
+      PyMem_Free(slab);
+    else
+      slab->owner = NULL;
+    slab = next;
+  }
+  self->slabs = NULL;
+  self->free_chunks = NULL;
+  self->slab_chunks = 0;
+
+  PyMem_Free(self->chunks);
+  PyMem_Free(self->chunk_counts);
+  PyMem_Free(self->count_tree);
+  self->chunks = NULL;
+  self->chunk_counts = NULL;
+  self->count_tree = NULL;
+  self->num_chunks = 0;
+  self->chunks_allocated = 0;
+  self->count_tree_valid = 0;
+  self->cached_chunk = -1;
+  self->current = 0;
+  self->size = 0;
+
+  BStringArena_free(self->arena);
+  self->arena = NULL;
+  BString_drop_index(self);
+}
+
+// Moves the items into a new UTF-8 arena and releases the chunk storage.
+int BString_compact_storage(BStringObject *self)
+{
+  if (self->arena)
+    return 0;
+
+  BStringArena *arena = BStringArena_new();
+  if (!arena)
+    return -1;
+  BStringWalk walk;
+  BString_walk_init(&walk, self, 0);
+  PyObject *item;
+  while ((item = BString_walk_next(&walk)))
+  {
+    if (BStringArena_append_object(arena, item) != 0)
+    {
+      BStringArena_free(arena);
+      return -1;
+    }
+  }
+
+  Py_ssize_t current = self->current;
+  BStringIndex *index = self->index;
+  self->index = NULL;
+  BString_clear_storage(self);
+  self->arena = arena;
+  self->size = arena->count;
+  self->current = current;
+  self->index = index;
+  return 0;
+}
+
+// Decodes every arena item into chunk storage and drops the arena. On failure
+// the BString is left compact and unchanged.
+int BString_expand_arena(BStringObject *self)
+{
+  BStringArena *arena = self->arena;
+  if (!arena)
+    return 0;
+
+  // The items keep their positions, so the index stays valid as it is.
+  Py_ssize_t current = self->current;
+  BStringIndex *index = self->index;
+  self->index = NULL;
+  self->arena = NULL;
+  self->size = 0;
+  for (Py_ssize_t i = 0; i < arena->count; ++i)
+  {
+    PyObject *item = BStringArena_item(arena, i);
+    int status = item ? BString_push(self, item) : -1;
+    Py_XDECREF(item);
+    if (status != 0)
+    {
+      BString_clear_storage(self);
+      self->arena = arena;
+      self->size = arena->count;
+      self->current = current;
+      self->index = index;
+      return -1;
+    }
+  }
+  BStringArena_free(arena);
+  self->current = current;
+  self->index = index;
+  return 0;
+}
+
+void BString_drop_index(BStringObject *self)
+{
+  BStringIndex_free(self->index);
+  self->index = NULL;
+}
+
+// Returns the hash index of self, building it from the items on first use.
+static BStringIndex *BString_get_index(BStringObject *self)
+{
+  if (self->index)
+    return self->index;
+
+  BStringIndex *index = BStringIndex_new(self->size);
+  if (!index)
+    return NULL;
+  if (self->arena)
+  {
+    for (Py_ssize_t i = 0; i < self->size; ++i)
+    {
+      PyObject *item = BStringArena_item(self->arena, i);
+      if (!item)
+      {
+        BStringIndex_free(index);
+        return NULL;
+      }
+      BStringIndex_add(index, item, i);
+      Py_DECREF(item);
+    }
+  }
+  else
+  {
+    BStringWalk walk;
+    BString_walk_init(&walk, self, 0);
+    PyObject *item;
+    for (Py_ssize_t i = 0; (item = BString_walk_next(&walk)); ++i)
+    {
+      BStringIndex_add(index, item, i);
+    }
+  }
+  self->index = index;
+  return index;
+}
+
+// Recomputes every first position after the shift log overflowed. The pass
+// stops as soon as each distinct string has been seen once.
+static int BString_refresh_index(BStringObject *self)
+{
+  BStringIndex *index = self->index;
+  BStringIndex_reset_firsts(index);
+  Py_ssize_t remaining = index->used;
+  for (Py_ssize_t i = 0; remaining > 0 && i < self->size; ++i)
+  {
+    PyObject *item = BString_fetch_at(self, i);
+    if (!item)
+      return -1;
+    BStringIndexEntry *entry = BStringIndex_lookup(index, item);
+    Py_DECREF(item);
+    if (!entry->exact)
+    {
+      entry->first = i;
+      entry->exact = 1;
+      remaining--;
+    }
+  }
+  return 0;
+}
+
+// Linear search for value in [start, stop) without an index.
+static int BString_scan_item(BStringObject *self, PyObject *value, Py_ssize_t start, Py_ssize_t stop, Py_ssize_t *position)
+{
+  if (self->arena)
+  {
+    Py_ssize_t length;
+    const char *bytes = PyUnicode_AsUTF8AndSize(value, &length);
+    if (!bytes)
+    {
+      // Strings without a UTF-8 form are never held in an arena.
+      if (!PyErr_ExceptionMatches(PyExc_UnicodeEncodeError))
+        return -1;
+      PyErr_Clear();
+      return 0;
+    }
+    for (Py_ssize_t i = start; i < stop; ++i)
+    {
+      Py_ssize_t item_length;
+      const char *item_bytes = BStringArena_bytes(self->arena, i, &item_length);
+      if (item_length == length && memcmp(item_bytes, bytes, length) == 0)
+      {
+        *position = i;
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  BStringWalk walk;
+  BString_walk_init_range(&walk, self, start, 1, stop - start);
+  PyObject *item;
+  for (Py_ssize_t i = start; (item = BString_walk_next(&walk)); ++i)
+  {
+    if (BStringIndex_equal(item, value))
+    {
+      *position = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Finds the first occurrence of value in [start, stop). Returns 1 and sets
+// *position when found, 0 when not, and -1 on error.
+int BString_find_item(BStringObject *self, PyObject *value, Py_ssize_t start, Py_ssize_t stop, Py_ssize_t *position)
+{
+  if (!PyUnicode_Check(value))
+    return 0;
+  if (start < 0)
+    start = 0;
+  if (stop > self->size)
+    stop = self->size;
+  if (start >= stop)
+    return 0;
+
+  if (self->use_index)
+  {
+    BStringIndex *index = BString_get_index(self);
+    if (!index)
+      return -1;
+    if (index->overflowed && BString_refresh_index(self) < 0)
+      return -1;
+    BStringIndexEntry *entry = BStringIndex_lookup(index, value);
+    if (!entry)
+      return 0;
+    BStringIndex_update(index, entry);
+    if (!entry->exact)
+    {
+      // Only a lower bound is known: look for the occurrence from there.
+      Py_ssize_t first;
+      int found = BString_scan_item(self, value, entry->first, self->size, &first);
+      if (found <= 0)
+        return found;
+      entry->first = first;
+      entry->exact = 1;
+    }
+    if (entry->first >= stop)
+      return 0;
+    if (entry->first >= start)
+    {
+      *position = entry->first;
+      return 1;
+    }
+    // The first occurrence lies before start; only a later one can match.
+    if (entry->count == 1)
+      return 0;
+  }
+  return BString_scan_item(self, value, start, stop, position);
+}
+
+// Returns the number of occurrences of value, or -1 on error.
+Py_ssize_t BString_count_item(BStringObject *self, PyObject *value)
+{
+  if (!PyUnicode_Check(value))
+    return 0;
+  if (self->use_index)
+  {
+    BStringIndex *index = BString_get_index(self);
+    if (!index)
+      return -1;
+    BStringIndexEntry *entry = BStringIndex_lookup(index, value);
+    return entry ? entry->count : 0;
+  }
+
+  Py_ssize_t count = 0;
+  Py_ssize_t position;
+  for (Py_ssize_t start = 0;; start = position + 1)
+  {
+    int found = BString_scan_item(self, value, start, self->size, &position);
+    if (found < 0)
+      return -1;
+    if (found == 0)
+      return count;
+    count++;
+  }
+}
+
+void BString_walk_init(BStringWalk *walk, BStringObject *self, Py_ssize_t start)
+{
+  if (start < 0)
+    start = 0;
+  BString_walk_init_range(walk, self, start, 1, start < self->size ? self->size - start : 0);
+}
+
+void BString_walk_init_range(BStringWalk *walk, BStringObject *self, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length)
+{
+  walk->owner = self;
+  walk->index = start;
+  walk->step = step;
+  walk->remaining = length;
+  walk->chunk = 0;
+  walk->offset = 0;
+  if (step == 1 && length > 0 && start > 0)
+    walk->chunk = BString_find_chunk(self, start, &walk->offset);
+}
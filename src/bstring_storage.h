@@ -0,0 +1,89 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_STORAGE_H
+#define BSTRING_STORAGE_H
+
+#include "bstring.h"
+#include "bstring_arena.h"
+#include "bstring_index.h"
+
+// A forward cursor over the items start, start + step, ... of a BString,
+// yielding at most `remaining` items.
+typedef struct {
+    BStringObject *owner;
+    Py_ssize_t chunk;
+    Py_ssize_t offset;
+    Py_ssize_t index;
+    Py_ssize_t step;
+    Py_ssize_t remaining;
+} BStringWalk;
+
+// Positional operations work in both storage modes; the mutating ones other
+// than appends expand a compact BString back into chunks first. The ones
+// that add items raise TypeError for anything but a str.
+int BString_push(BStringObject *self, PyObject *item);
+int BString_push_array(BStringObject *self, PyObject *const *items, Py_ssize_t n);
+int BString_push_shared(BStringObject *self, BStringObject *source);
+int BString_reserve(BStringObject *self, Py_ssize_t count);
+int BString_insert_at(BStringObject *self, Py_ssize_t index, PyObject *item);
+PyObject *BString_fetch_at(BStringObject *self, Py_ssize_t index);
+int BString_replace_at(BStringObject *self, Py_ssize_t index, PyObject *item);
+PyObject *BString_take_at(BStringObject *self, Py_ssize_t index);
+int BString_delete_range(BStringObject *self, Py_ssize_t start, Py_ssize_t stop);
+void BString_clear_storage(BStringObject *self);
+int BString_compact_storage(BStringObject *self);
+int BString_expand_arena(BStringObject *self);
+
+// Lookups by value. They use the hash index when the BString has one enabled
+// and scan the items otherwise. Both storage modes are supported.
+int BString_find_item(BStringObject *self, PyObject *value, Py_ssize_t start, Py_ssize_t stop, Py_ssize_t *position);
+Py_ssize_t BString_count_item(BStringObject *self, PyObject *value);
+void BString_drop_index(BStringObject *self);
+
+// Borrowed-reference access to chunk storage. A compact BString must be
+// expanded with BString_expand_arena() before using these.
+PyObject *BString_item_at(BStringObject *self, Py_ssize_t index);
+void BString_walk_init(BStringWalk *walk, BStringObject *self, Py_ssize_t start);
+void BString_walk_init_range(BStringWalk *walk, BStringObject *self, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length);
+
+// Returns a borrowed reference to the next item, or NULL at the end.
+static inline PyObject *BString_walk_next(BStringWalk *walk)
+{
+  BStringObject *self = walk->owner;
+  if (walk->remaining <= 0)
+    return NULL;
+  if (walk->step != 1)
+  {
+    if (walk->index < 0 || walk->index >= self->size)
+      return NULL;
+    PyObject *item = BString_item_at(self, walk->index);
+    walk->index += walk->step;
+    walk->remaining--;
+    return item;
+  }
+  while (walk->chunk < self->num_chunks)
+  {
+    if (walk->offset < self->chunk_counts[walk->chunk])
+    {
+      walk->remaining--;
+      return self->chunks[walk->chunk]->items[walk->offset++];
+    }
+    walk->chunk++;
+    walk->offset = 0;
+  }
+  return NULL;
+}
+
+// Element operations over a walk, shared by BString and BStringView.
+PyObject *BString_from_walk(BStringWalk *walk);
+PyObject *BString_join_walk(BStringWalk *walk, PyObject *separator);
+PyObject *BString_contains_walk(BStringWalk *walk, const char *substring_cstr, int case_sensitive);
+PyObject *BString_to_file_walk(BStringWalk *walk, const char *filepath);
+
+#endif // BSTRING_STORAGE_H
@@ -0,0 +1,94 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring.h"
+#include "bstring_threads.h"
+#include "pythread.h"
+
+// Items below which another thread is not worth starting.
+#define BSTRING_THREAD_MIN_ITEMS 16384
+
+typedef struct {
+    BStringThreadWork work;
+    void *arg;
+    Py_ssize_t next_part;          // Next part for a helper thread to take.
+    Py_ssize_t running;            // Helper threads that have not finished.
+    PyThread_type_lock mutex;
+    PyThread_type_lock done;       // Held until the last helper finishes.
+} BStringThreadJob;
+
+static void BStringThreads_helper(void *arg)
+{
+  BStringThreadJob *job = (BStringThreadJob *)arg;
+  PyThread_acquire_lock(job->mutex, WAIT_LOCK);
+  Py_ssize_t part = job->next_part++;
+  PyThread_release_lock(job->mutex);
+
+  job->work(job->arg, part);
+
+  PyThread_acquire_lock(job->mutex, WAIT_LOCK);
+  int last = --job->running == 0;
+  PyThread_release_lock(job->mutex);
+  if (last)
+    PyThread_release_lock(job->done);
+}
+
+void BStringThreads_run(BStringThreadWork work, void *arg, Py_ssize_t parts)
+{
+  BStringThreadJob job = {work, arg, 1, 0, NULL, NULL};
+  if (parts > 1)
+  {
+    job.mutex = PyThread_allocate_lock();
+    job.done = PyThread_allocate_lock();
+  }
+  Py_ssize_t started = 0;
+
+  Py_BEGIN_ALLOW_THREADS
+  if (job.mutex && job.done)
+  {
+    PyThread_acquire_lock(job.done, WAIT_LOCK);
+    // running counts the helpers up front so that an early finisher cannot
+    // see zero while others are still being started.
+    job.running = parts - 1;
+    for (; started < parts - 1; ++started)
+    {
+      if (PyThread_start_new_thread(BStringThreads_helper, &job) == PYTHREAD_INVALID_THREAD_ID)
+        break;
+    }
+    PyThread_acquire_lock(job.mutex, WAIT_LOCK);
+    job.running -= parts - 1 - started;
+    int waiting = job.running > 0;
+    PyThread_release_lock(job.mutex);
+
+    work(arg, 0);
+    // The parts no helper took run here.
+    for (Py_ssize_t part = 1 + started; part < parts; ++part)
+      work(arg, part);
+    if (waiting)
+      PyThread_acquire_lock(job.done, WAIT_LOCK);
+    PyThread_release_lock(job.done);
+  }
+  else
+  {
+    for (Py_ssize_t part = 0; part < parts; ++part)
+      work(arg, part);
+  }
+  Py_END_ALLOW_THREADS
+
+  if (job.mutex)
+    PyThread_free_lock(job.mutex);
+  if (job.done)
+    PyThread_free_lock(job.done);
+}
+
+Py_ssize_t BStringThreads_parts(Py_ssize_t count, int threads)
+{
+  Py_ssize_t parts = count / BSTRING_THREAD_MIN_ITEMS;
+  if (parts > threads)
+    parts = threads;
+  return parts > 1 ? parts : 1;
+}
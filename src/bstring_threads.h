@@ -0,0 +1,28 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_THREADS_H
+#define BSTRING_THREADS_H
+
+#include "bstring.h"
+
+// Work that may run without the GIL: it must not touch Python objects other
+// than reading immutable data that the caller keeps alive.
+typedef void (*BStringThreadWork)(void *arg, Py_ssize_t part);
+
+// Runs work(arg, part) for every part in 0 .. parts - 1 at the same time, on
+// the calling thread and parts - 1 helper threads, and returns when all are
+// done. Must be called with the GIL held; it is released meanwhile. Parts
+// whose thread cannot be started run on the calling thread.
+void BStringThreads_run(BStringThreadWork work, void *arg, Py_ssize_t parts);
+
+// Number of parts to split count items into for the requested threads, so
+// that small inputs do not pay for threads they cannot use.
+Py_ssize_t BStringThreads_parts(Py_ssize_t count, int threads);
+
+#endif // BSTRING_THREADS_H
@@ -0,0 +1,200 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "bstring_view.h"
+#include "bstring_storage.h"
+#include "fastargs.h"
+
+PyObject *BStringView_create(BStringObject *parent, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length)
+{
+  BStringViewObject *view = PyObject_New(BStringViewObject, &BStringView_Type);
+  if (!view)
+    return NULL;
+
+  Py_INCREF(parent);
+  view->parent = parent;
+  view->start = start;
+  view->step = step;
+  view->length = length > 0 ? length : 0;
+  view->mod_count = parent->mod_count;
+  return (PyObject *)view;
+}
+
+static void BStringView_dealloc(BStringViewObject *self)
+{
+  Py_XDECREF(self->parent);
+  PyObject_Del(self);
+}
+
+static int BStringView_check(BStringViewObject *self)
+{
+  if (self->mod_count != self->parent->mod_count)
+  {
+    PyErr_SetString(PyExc_RuntimeError, "BString was modified after this view was created");
+    return -1;
+  }
+  return 0;
+}
+
+static int BStringView_walk_init(BStringViewObject *self, BStringWalk *walk)
+{
+  if (BStringView_check(self) < 0)
+    return -1;
+  BString_walk_init_range(walk, self->parent, self->start, self->step, self->length);
+  return 0;
+}
+
+static Py_ssize_t BStringView_length(BStringViewObject *self)
+{
+  return self->length;
+}
+
+static PyObject *BStringView_item(BStringViewObject *self, Py_ssize_t i)
+{
+  if (BStringView_check(self) < 0)
+    return NULL;
+  if (i < 0 || i >= self->length)
+  {
+    PyErr_SetString(PyExc_IndexError, "BStringView index out of range");
+    return NULL;
+  }
+  PyObject *item = BString_item_at(self->parent, self->start + i * self->step);
+  Py_INCREF(item);
+  return item;
+}
+
+static PyObject *BStringView_getitem(BStringViewObject *self, PyObject *key)
+{
+  if (PySlice_Check(key))
+  {
+    Py_ssize_t start, stop, step, slicelength;
+    if (PySlice_GetIndicesEx(key, self->length, &start, &stop, &step, &slicelength) < 0)
+    {
+      return NULL;
+    }
+    return BStringView_create(self->parent, self->start + start * self->step, self->step * step, slicelength);
+  }
+  else if (PyLong_Check(key))
+  {
+    Py_ssize_t i = PyLong_AsSsize_t(key);
+    if (i == -1 && PyErr_Occurred())
+    {
+      return NULL;
+    }
+    if (i < 0)
+    {
+      i += self->length;
+    }
+    return BStringView_item(self, i);
+  }
+  else
+  {
+    PyErr_SetString(PyExc_TypeError, "BStringView indices must be integers or slices");
+    return NULL;
+  }
+}
+
+static PyObject *BStringView_repr(BStringViewObject *self)
+{
+  BStringWalk walk;
+  if (BStringView_walk_init(self, &walk) < 0)
+    return NULL;
+
+  PyObject *list = PyList_New(self->length);
+  if (!list)
+    return NULL;
+  for (Py_ssize_t i = 0; i < self->length; ++i)
+  {
+    PyObject *item = BString_walk_next(&walk);
+    Py_INCREF(item);
+    PyList_SET_ITEM(list, i, item);
+  }
+  PyObject *repr = PyObject_Repr(list);
+  Py_DECREF(list);
+  return repr;
+}
+
+static PyObject *BStringView_materialize(BStringViewObject *self, PyObject *Py_UNUSED(args))
+{
+  BStringWalk walk;
+  if (BStringView_walk_init(self, &walk) < 0)
+    return NULL;
+  return BString_from_walk(&walk);
+}
+
+static PyObject *BStringView_join(BStringViewObject *self, PyObject *separator)
+{
+  BStringWalk walk;
+  if (BStringView_walk_init(self, &walk) < 0)
+    return NULL;
+  return BString_join_walk(&walk, separator);
+}
+
+static PyObject *BStringView_contains(BStringViewObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+  const char *substring_cstr;
+  int case_sensitive = 1;
+  static char *kwlist[] = {"substring", "case_sensitive", NULL};
+  if (!FastArgs_Parse(args, nargs, kwnames, "s|p:contains", kwlist, &substring_cstr, &case_sensitive))
+    return NULL;
+
+  BStringWalk walk;
+  if (BStringView_walk_init(self, &walk) < 0)
+    return NULL;
+  return BString_contains_walk(&walk, substring_cstr, case_sensitive);
+}
+
+static PyObject *BStringView_to_file(BStringViewObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+  const char *filepath;
+  static char *kwlist[] = {"filepath", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "s:to_file", kwlist, &filepath))
+    return NULL;
+
+  BStringWalk walk;
+  if (BStringView_walk_init(self, &walk) < 0)
+    return NULL;
+  return BString_to_file_walk(&walk, filepath);
+}
+
+static PyMethodDef BStringView_methods[] =
+{
+    {"materialize", (PyCFunction)BStringView_materialize, METH_NOARGS, "Copy the viewed items into a new BString."},
+    {"join", (PyCFunction)BStringView_join, METH_O, "Join the viewed elements into a single string with a separator."},
+    {"contains", (PyCFunction)BStringView_contains, METH_FASTCALL | METH_KEYWORDS, "Check if any viewed string contains a substring."},
+    {"to_file", (PyCFunction)BStringView_to_file, METH_FASTCALL, "Save the viewed strings to a file, one string per line."},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+static PySequenceMethods BStringView_as_sequence =
+{
+    (lenfunc)BStringView_length,
+    0,
+    0,
+    (ssizeargfunc)BStringView_item,
+};
+
+static PyMappingMethods BStringView_as_mapping =
+{
+    (lenfunc)BStringView_length,
+    (binaryfunc)BStringView_getitem,
+    0
+};
+
+PyTypeObject BStringView_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "BeautifulString.BStringView",
+    .tp_doc = "A read-only, zero-copy view over a range of a BString.",
+    .tp_basicsize = sizeof(BStringViewObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)BStringView_dealloc,
+    .tp_repr = (reprfunc)BStringView_repr,
+    .tp_as_sequence = &BStringView_as_sequence,
+    .tp_as_mapping = &BStringView_as_mapping,
+    .tp_methods = BStringView_methods,
+};
@@ -0,0 +1,30 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef BSTRING_VIEW_H
+#define BSTRING_VIEW_H
+
+#include "bstring.h"
+
+// A read-only window over items start, start + step, ... of a parent BString.
+// The view shares the parent's storage and becomes invalid as soon as the
+// parent's existing items are modified (appends are allowed).
+typedef struct {
+    PyObject_HEAD
+    BStringObject *parent;
+    Py_ssize_t start;
+    Py_ssize_t step;
+    Py_ssize_t length;
+    Py_ssize_t mod_count;      // The parent's mod_count when the view was created.
+} BStringViewObject;
+
+PyObject *BStringView_create(BStringObject *parent, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length);
+
+extern PyTypeObject BStringView_Type;
+
+#endif // BSTRING_VIEW_H
@@ -0,0 +1,184 @@
+/*
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include "fastargs.h"
+#include <stdarg.h>
+#include <string.h>
+
+// Stores the converted value of obj for format unit *unit and advances the
+// argument list past that unit's output pointers.
+static int FastArgs_convert(PyObject *obj, const char *unit, const char *fname, const char *argname, va_list *vargs)
+{
+  switch (*unit)
+  {
+  case 's':
+  {
+    const char **out = va_arg(*vargs, const char **);
+    if (!PyUnicode_Check(obj))
+    {
+      PyErr_Format(PyExc_TypeError, "%s() argument '%s' must be str, not %.50s", fname, argname, Py_TYPE(obj)->tp_name);
+      return -1;
+    }
+    Py_ssize_t length;
+    const char *value = PyUnicode_AsUTF8AndSize(obj, &length);
+    if (!value)
+      return -1;
+    if ((Py_ssize_t)strlen(value) != length)
+    {
+      PyErr_SetString(PyExc_ValueError, "embedded null character");
+      return -1;
+    }
+    *out = value;
+    return 0;
+  }
+  case 'O':
+  {
+    if (unit[1] == '!')
+    {
+      PyTypeObject *type = va_arg(*vargs, PyTypeObject *);
+      PyObject **out = va_arg(*vargs, PyObject **);
+      if (!PyObject_TypeCheck(obj, type))
+      {
+        PyErr_Format(PyExc_TypeError, "%s() argument '%s' must be %.50s, not %.50s", fname, argname, type->tp_name, Py_TYPE(obj)->tp_name);
+        return -1;
+      }
+      *out = obj;
+      return 0;
+    }
+    PyObject **out = va_arg(*vargs, PyObject **);
+    *out = obj;
+    return 0;
+  }
+  case 'i':
+  {
+    int *out = va_arg(*vargs, int *);
+    long value = PyLong_AsLong(obj);
+    if (value == -1 && PyErr_Occurred())
+      return -1;
+    if (value > INT_MAX || value < INT_MIN)
+    {
+      PyErr_SetString(PyExc_OverflowError, "signed integer is out of range for a C int");
+      return -1;
+    }
+    *out = (int)value;
+    return 0;
+  }
+  case 'n':
+  {
+    Py_ssize_t *out = va_arg(*vargs, Py_ssize_t *);
+    Py_ssize_t value = PyNumber_AsSsize_t(obj, PyExc_OverflowError);
+    if (value == -1 && PyErr_Occurred())
+      return -1;
+    *out = value;
+    return 0;
+  }
+  case 'p':
+  {
+    int *out = va_arg(*vargs, int *);
+    int value = PyObject_IsTrue(obj);
+    if (value < 0)
+      return -1;
+    *out = value;
+    return 0;
+  }
+  }
+  PyErr_Format(PyExc_SystemError, "%s(): unsupported format unit '%c'", fname, *unit);
+  return -1;
+}
+
+int FastArgs_Parse(PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames, const char *format, char **kwlist, ...)
+{
+  // Split the format into its units and find the function name.
+  const char *units[FASTARGS_MAX_PARAMS];
+  Py_ssize_t num_params = 0;
+  Py_ssize_t required = -1;
+  const char *fname = "function";
+  for (const char *f = format; *f; ++f)
+  {
+    if (*f == '|')
+    {
+      required = num_params;
+    }
+    else if (*f == ':')
+    {
+      fname = f + 1;
+      break;
+    }
+    else if (*f != '!')
+    {
+      if (num_params == FASTARGS_MAX_PARAMS)
+      {
+        PyErr_SetString(PyExc_SystemError, "too many parameters in FastArgs_Parse() format");
+        return 0;
+      }
+      units[num_params++] = f;
+    }
+  }
+  if (required < 0)
+    required = num_params;
+
+  if (nargs > num_params)
+  {
+    PyErr_Format(PyExc_TypeError, "%s() takes at most %zd arguments (%zd given)", fname, num_params, nargs);
+    return 0;
+  }
+
+  PyObject *values[FASTARGS_MAX_PARAMS] = {NULL};
+  for (Py_ssize_t i = 0; i < nargs; ++i)
+  {
+    values[i] = args[i];
+  }
+
+  Py_ssize_t num_kwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+  for (Py_ssize_t k = 0; k < num_kwargs; ++k)
+  {
+    PyObject *key = PyTuple_GET_ITEM(kwnames, k);
+    Py_ssize_t i = 0;
+    while (i < num_params && PyUnicode_CompareWithASCIIString(key, kwlist[i]) != 0)
+    {
+      i++;
+    }
+    if (i == num_params)
+    {
+      PyErr_Format(PyExc_TypeError, "'%U' is an invalid keyword argument for %s()", key, fname);
+      return 0;
+    }
+    if (values[i])
+    {
+      PyErr_Format(PyExc_TypeError, "argument for %s() given by name ('%s') and position (%zd)", fname, kwlist[i], i + 1);
+      return 0;
+    }
+    values[i] = args[nargs + k];
+  }
+
+  va_list vargs;
+  va_start(vargs, kwlist);
+  for (Py_ssize_t i = 0; i < num_params; ++i)
+  {
+    if (values[i])
+    {
+      if (FastArgs_convert(values[i], units[i], fname, kwlist[i], &vargs) < 0)
+      {
+        va_end(vargs);
+        return 0;
+      }
+      continue;
+    }
+    if (i < required)
+    {
+      va_end(vargs);
+      PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s' (pos %zd)", fname, kwlist[i], i + 1);
+      return 0;
+    }
+    // Skip the output pointers of an omitted optional parameter.
+    if (units[i][0] == 'O' && units[i][1] == '!')
+      (void)va_arg(vargs, PyTypeObject *);
+    (void)va_arg(vargs, void *);
+  }
+  va_end(vargs);
+  return 1;
+}
@@ -0,0 +1,24 @@
+/*
+
+This file is part of BeautifulString python extension library.
+Developed by Juha Sinisalo
+Email: juha.a.sinisalo@gmail.com
+
+*/
+
+#ifndef FASTARGS_H
+#define FASTARGS_H
+
+#include <Python.h>
+
+// Maximum number of parameters a FastArgs_Parse() format can describe.
+#define FASTARGS_MAX_PARAMS 12
+
+// Argument parsing for METH_FASTCALL and vectorcall entry points. Works like
+// PyArg_ParseTupleAndKeywords() on the (args, nargs, kwnames) calling
+// convention, so no argument tuple or keyword dict is built per call.
+// Supported format units: s, O, O!, i, n, p, with '|' before the optional
+// parameters and ":name" at the end for error messages. kwnames may be NULL.
+int FastArgs_Parse(PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames, const char *format, char **kwlist, ...);
+
+#endif // FASTARGS_H
@@ -7,6 +7,10 @@ Email: juha.a.sinisalo@gmail.com
 #define PY_SSIZE_T_CLEAN
 #include "beanalyzer.h"
 #include "bstring.h"
+#include "bstring_csv.h"
+#include "bstring_expr.h"
+#include "bstring_patterns.h"
+#include "bstring_view.h"
 #include "stremove.h"
 #include "strfetch.h"
 #include "strlearn.h"
@@ -20,15 +24,15 @@ Email: juha.a.sinisalo@gmail.com
 
 static PyMethodDef BeautifulStringMethods[] =
 {
-    {"strfetch", strfetch, METH_VARARGS, "Fetch substrings using slice definitions."},
-    {"strvalidate", (PyCFunction)strvalidate, METH_VARARGS | METH_KEYWORDS, "Validates the given pattern based string"},
-    {"strscan", (PyCFunction)strscan, METH_VARARGS | METH_KEYWORDS,
+    {"strfetch", (PyCFunction)strfetch, METH_FASTCALL, "Fetch substrings using slice definitions."},
+    {"strvalidate", (PyCFunction)strvalidate, METH_FASTCALL | METH_KEYWORDS, "Validates the given pattern based string"},
+    {"strscan", (PyCFunction)strscan, METH_FASTCALL | METH_KEYWORDS,
      "Parse input_str using format_str. Supports named fields and return_type (list, tuple, dict, tuple_list)."},
-    {"strmatch", (PyCFunction)strmatch, METH_VARARGS | METH_KEYWORDS, "Extracting fields from the matching string."},
-    {"strsearch", (PyCFunction)strsearch, METH_VARARGS | METH_KEYWORDS, "Search for pattern match inside a string."},
-    {"strparse", (PyCFunction)strparse, METH_VARARGS | METH_KEYWORDS, "Parsing a string, High-level scanf, constraints, type-safe, returns structured output"},
-    {"strlearn", (PyCFunction)strlearn, METH_VARARGS | METH_KEYWORDS, "Infer a format from a list of strings. format=['list'|'c-style']"},
-    {"stremove", (PyCFunction)stremove, METH_VARARGS | METH_KEYWORDS, "Remove or keep a set of characters from strings."},
+    {"strmatch", (PyCFunction)strmatch, METH_FASTCALL | METH_KEYWORDS, "Extracting fields from the matching string."},
+    {"strsearch", (PyCFunction)strsearch, METH_FASTCALL | METH_KEYWORDS, "Search for pattern match inside a string."},
+    {"strparse", (PyCFunction)strparse, METH_FASTCALL | METH_KEYWORDS, "Parsing a string, High-level scanf, constraints, type-safe, returns structured output"},
+    {"strlearn", (PyCFunction)strlearn, METH_FASTCALL | METH_KEYWORDS, "Infer a format from a list of strings. format=['list'|'c-style']"},
+    {"stremove", (PyCFunction)stremove, METH_FASTCALL | METH_KEYWORDS, "Remove or keep a set of characters from strings."},
     {NULL, NULL, 0, NULL}
 };
 
@@ -43,6 +47,7 @@ PyMODINIT_FUNC PyInit_BeautifulString(void)
 {
   PyObject *m;
 
+  BStringCsv_init();
   if (PyType_Ready(&BStringType) < 0)
     return NULL;
   if (PyType_Ready(&BeautifulAnalyzerType) < 0)
@@ -51,6 +56,18 @@ PyMODINIT_FUNC PyInit_BeautifulString(void)
   if (PyType_Ready(&BStringIter_Type) < 0)
     return NULL;
 
+  if (PyType_Ready(&BStringCsvIter_Type) < 0)
+    return NULL;
+
+  if (PyType_Ready(&BStringView_Type) < 0)
+    return NULL;
+
+  if (PyType_Ready(&BStringPatterns_Type) < 0)
+    return NULL;
+
+  if (PyType_Ready(&BStringExpr_Type) < 0)
+    return NULL;
+
   m = PyModule_Create(&BeautifulString);
   if (m == NULL)
     return NULL;
@@ -63,6 +80,36 @@ PyMODINIT_FUNC PyInit_BeautifulString(void)
     return NULL;
   }
 
+  Py_INCREF(&BStringView_Type);
+  if (PyModule_AddObject(m, "BStringView", (PyObject *)&BStringView_Type) < 0)
+  {
+    Py_DECREF(&BStringType);
+    Py_DECREF(&BStringView_Type);
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  Py_INCREF(&BStringPatterns_Type);
+  if (PyModule_AddObject(m, "BStringPatterns", (PyObject *)&BStringPatterns_Type) < 0)
+  {
+    Py_DECREF(&BStringType);
+    Py_DECREF(&BStringView_Type);
+    Py_DECREF(&BStringPatterns_Type);
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  Py_INCREF(&BStringExpr_Type);
+  if (PyModule_AddObject(m, "BStringExpr", (PyObject *)&BStringExpr_Type) < 0)
+  {
+    Py_DECREF(&BStringType);
+    Py_DECREF(&BStringView_Type);
+    Py_DECREF(&BStringPatterns_Type);
+    Py_DECREF(&BStringExpr_Type);
+    Py_DECREF(m);
+    return NULL;
+  }
+
   Py_INCREF(&BeautifulAnalyzerType);
   if (PyModule_AddObject(m, "BeautifulAnalyzer", (PyObject *)&BeautifulAnalyzerType) < 0)
   {
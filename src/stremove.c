@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "stremove.h"
+#include "fastargs.h"
 #include <string.h>
 
 static PyObject *_process_string(const char *input_str, const char *char_set, int remove_mode)
@@ -51,13 +52,13 @@ static PyObject *_process_string(const char *input_str, const char *char_set, in
   return py_result;
 }
 
-PyObject *stremove(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *stremove(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   PyObject *data_obj;
   const char *char_set;
   const char *action = "remove"; 
   static char *kwlist[] = {"data", "char_set", "action", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Os|s", kwlist, &data_obj, &char_set, &action))
+  if (!FastArgs_Parse(args, nargs, kwnames, "Os|s:stremove", kwlist, &data_obj, &char_set, &action))
   {
     return NULL;
   }
@@ -11,6 +11,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <Python.h>
 
-PyObject* stremove(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *stremove(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif //STREMOVE_H
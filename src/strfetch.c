@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strfetch.h"
+#include "fastargs.h"
 #include <Python.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,11 +37,12 @@ static PyObject *parse_slice_component(const char *str, size_t len)
   return PyLong_FromLong(val);
 }
 
-PyObject *strfetch(PyObject *self, PyObject *args)
+PyObject *strfetch(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
 {
   const char *input_str;
   const char *slices_format_str;
-  if (!PyArg_ParseTuple(args, "ss", &input_str, &slices_format_str))
+  static char *kwlist[] = {"input_str", "slices_format_str", NULL};
+  if (!FastArgs_Parse(args, nargs, NULL, "ss:strfetch", kwlist, &input_str, &slices_format_str))
     return NULL;
   PyObject *py_input_str = PyUnicode_FromString(input_str);
   if (!py_input_str)
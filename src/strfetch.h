@@ -11,6 +11,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <Python.h>
 
-PyObject* strfetch(PyObject *self, PyObject *args);
+PyObject* strfetch(PyObject *self, PyObject *const *args, Py_ssize_t nargs);
 
 #endif //STRFETCH_H
\ No newline at end of file
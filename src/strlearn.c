@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strlearn.h"
+#include "fastargs.h"
 #include <Python.h>
 #include <ctype.h>
 #include <stdlib.h>
@@ -80,12 +81,12 @@ static PyObject *tokenize_string(const char *str)
   return token_list;
 }
 
-PyObject *strlearn(PyObject *self, PyObject *args, PyObject *kwds)
+PyObject *strlearn(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   PyObject *input_list;
   const char *format = "list"; 
   static char *kwlist[] = {"list_of_strings", "format", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|s", kwlist, &PyList_Type, &input_list, &format))
+  if (!FastArgs_Parse(args, nargs, kwnames, "O!|s:strlearn", kwlist, &PyList_Type, &input_list, &format))
   {
     return NULL;
   }
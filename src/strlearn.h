@@ -11,6 +11,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <Python.h>
 
-PyObject *strlearn(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *strlearn(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif // STRLEARN_H
@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strmatch.h"
+#include "fastargs.h"
 #include "strmatch_internal.h"
 #include <ctype.h>
 #include <stdio.h>
@@ -47,13 +48,13 @@ static int parse_named_specifier(const char **p, char *type, char *name)
   return 1;
 }
 
-PyObject *strmatch(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *strmatch(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *input;
   const char *pattern;
   const char *return_container = NULL;
   static char *kwlist[] = {"input", "pattern", "return_container", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|s", kwlist, &input, &pattern, &return_container))
+  if (!FastArgs_Parse(args, nargs, kwnames, "ss|s:strmatch", kwlist, &input, &pattern, &return_container))
   {
     fprintf(stderr, "[DEBUG] PyArg_ParseTuple failed\n");
     return NULL;
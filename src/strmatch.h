@@ -11,6 +11,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <Python.h>
 
-PyObject* strmatch(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *strmatch(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif //STRMATCH_H
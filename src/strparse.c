@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strparse.h"
+#include "fastargs.h"
 #include <Python.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -97,14 +98,14 @@ static char *parse_string_token(const char **input_ptr)
   return buffer;
 }
 
-PyObject *strparse(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *strparse(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *input_str;
   const char *format_str;
   const char *return_type = "dict";
   PyObject *dict_keys_obj = NULL;
   static char *kwlist[] = {"input_str", "format_str", "return_type", "dict_keys", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|sO", kwlist, &input_str, &format_str, &return_type, &dict_keys_obj))
+  if (!FastArgs_Parse(args, nargs, kwnames, "ss|sO:strparse", kwlist, &input_str, &format_str, &return_type, &dict_keys_obj))
   {
     return NULL;
   }
@@ -11,6 +11,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <python.h>
 
-PyObject* strparse(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *strparse(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif //STRPARSE_H
@@ -5,6 +5,7 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strscan.h"
+#include "fastargs.h"
 #include <Python.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -92,14 +93,14 @@ static char *parse_quoted_string(const char **input_ptr)
   return buffer;
 }
 
-PyObject *strscan(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *strscan(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *input_str;
   const char *format_str;
   const char *return_type = "list";
   PyObject *dict_keys_obj = NULL;
   static char *kwlist[] = {"input_str", "format_str", "return_type", "dict_keys", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|sO", kwlist, &input_str, &format_str, &return_type, &dict_keys_obj))
+  if (!FastArgs_Parse(args, nargs, kwnames, "ss|sO:strscan", kwlist, &input_str, &format_str, &return_type, &dict_keys_obj))
   {
     return NULL;
   }
@@ -14,6 +14,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #define MAX_FIELDS 32
 
-PyObject* strscan(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *strscan(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif
@@ -5,17 +5,18 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strsearch.h"
+#include "fastargs.h"
 #include "strmatch_internal.h"
 #include <Python.h>
 #include <string.h>
 
 
-PyObject *strsearch(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *strsearch(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *input_str, *pattern_str, *return_type = NULL;
   int start_index = 0, max_matches = -1;
   static char *kwlist[] = {"input_str", "pattern_str", "start_index", "max_matches", "return_container", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|iis", kwlist, &input_str, &pattern_str, &start_index, &max_matches, &return_type))
+  if (!FastArgs_Parse(args, nargs, kwnames, "ss|iis:strsearch", kwlist, &input_str, &pattern_str, &start_index, &max_matches, &return_type))
   {
     return NULL;
   }
@@ -12,7 +12,7 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <Python.h>
 
-PyObject* strsearch(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *strsearch(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 extern PyObject *strmatch_internal(PyObject *self, const char *input_str, const char *pattern_str, const char *return_type, int *consumed_chars, int partial_mode);
 
 #endif //STRSEARCH_H
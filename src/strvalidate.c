@@ -5,16 +5,17 @@ Email: juha.a.sinisalo@gmail.com
 */
 
 #include "strvalidate.h"
+#include "fastargs.h"
 #include "python.h"
 #include "strvalidate_match.h"
 
-PyObject *strvalidate(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject *strvalidate(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
   const char *input_str;
   const char *format_str;
   static char *kwlist[] = {"input_str", "format_str", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss", kwlist, &input_str, &format_str))
+  if (!FastArgs_Parse(args, nargs, kwnames, "ss:strvalidate", kwlist, &input_str, &format_str))
   {
     return NULL;
   }
@@ -12,6 +12,6 @@ Email: juha.a.sinisalo@gmail.com
 
 #include <python.h>
 
-PyObject* strvalidate(PyObject *self, PyObject *args, PyObject *kwargs);
+PyObject *strvalidate(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
 
 #endif //STRVALIDATE_H
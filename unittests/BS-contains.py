@@ -1,3 +1,5 @@
+import random
+import time
 from BeautifulString import BString
 
 b = BString("Helsinki, Finland", "Oulu", "Rovaniemi, Lapland")
@@ -17,4 +19,33 @@ assert b.contains('lapland') is False
 print(f"Contains 'lapland' (case-insensitive)? -> {b.contains('lapland', case_sensitive=False)}")
 assert b.contains('lapland', case_sensitive=False) is True
 
+# --- Test Case 4: Case-insensitive search agrees with str.lower() ---
+# Covers every needle length around the 16/32-byte vector blocks, mixed case,
+# non-ASCII text and the characters whose lowercase form depends on context.
+rng = random.Random(3)
+alphabet = "abcXYZ -_.0Kk"
+samples = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(70))) for _ in range(300)]
+samples += ["Straße in KØBENHAVN", "ΟΔΥΣΣΕΥΣ", "İstanbul", "\u212a (Kelvin sign)", "ΣΊΣΥΦΟΣ μύθος"]
+needles = ["", "k", "Xy", "ZZ", "c-A", "abcxyz", "Kk kK", "ÉTÉ", "øbenh", "ς", "σσ", "i̇st", "İST", "k (kel", "ος μύ"]
+needles += [s[i:i + n] for s in samples[:40] for i, n in ((2, 1), (0, 17), (5, 33), (1, 40)) if len(s) >= i + n]
+for compact in (False, True):
+    for item in samples:
+        single = BString(item)
+        if compact:
+            single.compact()
+        for needle in needles + [item.swapcase(), item.upper()[1:-1]]:
+            expected = needle.lower() in item.lower()
+            assert single.contains(needle, case_sensitive=False) is expected, (item, needle, compact)
+            assert single.contains(needle) is (needle in item)
+print("Case-insensitive contains() agrees with str.lower() on", len(samples), "strings")
+
+# --- Test Case 5: Timing on a larger BString ---
+lines = [f"2024-05-01 12:00:{i % 60:02d} INFO worker-{i % 16} handled request {i} in {i % 997} ms" for i in range(200000)]
+big = BString.from_list(lines)
+start = time.perf_counter()
+assert big.contains("REQUEST 199999 IN", case_sensitive=False)
+assert not big.contains("ERROR", case_sensitive=False)
+elapsed = time.perf_counter() - start
+print(f"Two case-insensitive scans of {len(lines)} lines: {elapsed * 1000:.1f} ms")
+
 print("\nAll tests passed.")
\ No newline at end of file
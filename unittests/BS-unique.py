@@ -9,4 +9,28 @@ print(f"Unique:   {unique_b}")
 
 # Verify the result
 assert list(unique_b) == ["apple", "banana", "cherry"]
-print("\nAssertion passed: Duplicates removed and order preserved.")
\ No newline at end of file
+print("\nAssertion passed: Duplicates removed and order preserved.")
+# Keep the last occurrence instead of the first
+assert list(b.unique(keep="last")) == ["cherry", "banana", "apple"]
+try:
+    b.unique(keep="middle")
+    assert False, "keep must be 'first' or 'last'"
+except ValueError:
+    pass
+
+# In-place variants modify b itself and return None
+c = BString(*b)
+assert c.unique(inplace=True) is None and list(c) == ["apple", "banana", "cherry"]
+c = BString(*b)
+assert c.unique(keep="last", inplace=True) is None and list(c) == ["cherry", "banana", "apple"]
+c = BString("one", "two")
+c.unique(inplace=True)
+assert list(c) == ["one", "two"] and list(BString().unique()) == []
+
+# Compact storage and larger inputs agree with dict.fromkeys()
+words = [f"word-{i % 997}" for i in range(50000)]
+big = BString.from_list(words)
+big.compact()
+assert list(big.unique()) == list(dict.fromkeys(words))
+assert list(big.unique(keep="last")) == list(dict.fromkeys(reversed(words)))[::-1]
+print("Assertion passed: keep='last' and in-place variants.")
\ No newline at end of file
@@ -0,0 +1,55 @@
+import os
+import time
+from BeautifulString import BString
+
+# --- Configuration ---
+NUM_LINES = 500_000
+REPEATS = 5
+FILE_PATH = "alloc_bench_file.txt"
+
+
+def best_of(label, func):
+    """Runs func REPEATS times and prints the fastest wall-clock time."""
+    best = None
+    result = None
+    for _ in range(REPEATS):
+        start = time.perf_counter()
+        result = func()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"  {label:<28} {best * 1000:9.2f} ms")
+    return result
+
+
+def run_alloc_benchmark():
+    """
+    Times the BString operations that create one storage slot per element,
+    so the cost of the element allocator dominates the measurement.
+    """
+    with open(FILE_PATH, "w") as f:
+        for i in range(NUM_LINES):
+            f.write(f"line-{i:08d}-payload\n")
+
+    print(f"--- Allocation-heavy workloads ({NUM_LINES:,} elements, best of {REPEATS}) ---")
+    b = best_of("BString.from_file()", lambda: BString.from_file(FILE_PATH))
+    best_of("map('upper')", lambda: b.map("upper"))
+    best_of("filter('endswith', ...)", lambda: b.filter(lambda s: s.endswith("0-payload")))
+    best_of("b * 4", lambda: b * 4)
+    best_of("b[10:-10] (slice copy)", lambda: b[10:-10])
+    best_of("append loop (100k)", lambda: [BString().append(s) for s in ("x",) * 100_000])
+
+    # Verify the results are still correct
+    assert len(b) == NUM_LINES
+    assert b[0] == "line-00000000-payload"
+    assert len(b * 4) == 4 * NUM_LINES
+    assert list(b[10:20]) == [f"line-{i:08d}-payload" for i in range(10, 20)]
+    print("\nVerification successful!")
+
+
+if __name__ == "__main__":
+    try:
+        run_alloc_benchmark()
+    finally:
+        if os.path.exists(FILE_PATH):
+            os.remove(FILE_PATH)
+            print(f"Cleaned up '{FILE_PATH}'.")
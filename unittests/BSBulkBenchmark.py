@@ -0,0 +1,83 @@
+import time
+from BeautifulString import BString
+
+# --- Configuration ---
+NUM_ITEMS = 1_000_000
+REPEATS = 5
+
+
+def best_of(label, func):
+    """Runs func REPEATS times and prints the fastest wall-clock time."""
+    best = None
+    result = None
+    for _ in range(REPEATS):
+        result = None  # free the previous result outside the timed region
+        start = time.perf_counter()
+        result = func()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"  {label:<34} {best * 1000:9.2f} ms")
+    return result
+
+
+def append_loop(items):
+    b = BString()
+    for s in items:
+        b.append(s)
+    return b
+
+
+def check_self_extend():
+    """extend() with the BString itself, across several chunks, one of them sparse."""
+    for compact in (False, True):
+        b = BString.from_list([str(i) for i in range(300)])
+        if compact:
+            b.compact()
+        b.insert(24, "x")
+        for index in (27, 28, 130, 131, 132):
+            b.pop(index)
+        for _ in range(5):
+            del b[70:110]
+        expected = list(b)
+        for _ in range(3):
+            b.extend(b)
+            expected += expected
+            assert list(b) == expected and len(b) == len(expected)
+        b += b
+        assert list(b) == expected * 2
+    print("extend() with itself passed")
+
+
+def run_bulk_benchmark():
+    """
+    Compares the bulk constructors against the BString(*lst) idiom and an
+    append loop for building a BString from existing Python strings.
+    """
+    items = [f"item-{i:08d}" for i in range(NUM_ITEMS)]
+    items_tuple = tuple(items)
+    text = " ".join(items)
+    gen_items = lambda: (s for s in items)
+
+    print(f"--- Building a BString from {NUM_ITEMS:,} strings (best of {REPEATS}) ---")
+    best_of("BString(*lst)", lambda: BString(*items))
+    best_of("append() loop", lambda: append_loop(items))
+    a = best_of("BString.from_list(lst)", lambda: BString.from_list(items))
+    b = best_of("BString.from_list(tuple)", lambda: BString.from_list(items_tuple))
+    c = best_of("BString.from_iterable(generator)", lambda: BString.from_iterable(gen_items()))
+    d = best_of("BString.from_iterable(map)", lambda: BString.from_iterable(map(str.upper, items)))
+    e = best_of("BString().extend(lst)", lambda: (lambda x: (x.extend(items), x)[1])(BString()))
+    f = best_of("BString.split(text)", lambda: BString.split(text))
+
+    # Verify the results are still correct
+    for built in (a, b, c, e, f):
+        assert len(built) == NUM_ITEMS
+        assert built[0] == items[0] and built[-1] == items[-1]
+        assert built[NUM_ITEMS // 2] == items[NUM_ITEMS // 2]
+    assert d[12345] == items[12345].upper()
+    assert list(a[1000:1010]) == items[1000:1010]
+    print("\nVerification successful!")
+
+
+if __name__ == "__main__":
+    check_self_extend()
+    run_bulk_benchmark()
@@ -0,0 +1,47 @@
+import time
+from BeautifulString import BString, strvalidate, strfetch
+
+# --- Configuration ---
+NUM_CALLS = 1_000_000
+REPEATS = 5
+
+
+def per_call(label, func):
+    """Runs func REPEATS times and prints the fastest per-call time in ns."""
+    best = None
+    for _ in range(REPEATS):
+        start = time.perf_counter()
+        func()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"  {label:<40} {best / NUM_CALLS * 1e9:8.1f} ns/call")
+
+
+def run_call_overhead_benchmark():
+    """
+    Measures the fixed cost of calling small entry points, where argument
+    parsing rather than the work itself dominates.
+    """
+    calls = range(NUM_CALLS)
+    small = BString("alpha", "beta", "gamma")
+
+    print(f"--- Per-call overhead ({NUM_CALLS:,} calls, best of {REPEATS}) ---")
+    per_call("strvalidate(s, fmt)", lambda: [strvalidate("Age: 42", "Age: %d") for _ in calls])
+    per_call("strvalidate(input_str=, format_str=)", lambda: [strvalidate(input_str="Age: 42", format_str="Age: %d") for _ in calls])
+    per_call("strfetch(s, slices)", lambda: [strfetch("abcdef", "[1:3]") for _ in calls])
+    per_call("BString(a, b, c)", lambda: [BString("a", "b", "c") for _ in calls])
+    per_call("b.contains(s)", lambda: [small.contains("mm") for _ in calls])
+    per_call("b.contains(s, case_sensitive=False)", lambda: [small.contains("MM", case_sensitive=False) for _ in calls])
+    per_call("b.insert(0, s); b.pop(0)", lambda: [(small.insert(0, "x"), small.pop(0)) for _ in calls])
+
+    # Verify the results are still correct
+    assert strvalidate("Age: 42", "Age: %d") is True
+    assert strvalidate(input_str="Age: x", format_str="Age: %d") is False
+    assert BString("a", "b", "c")() == ["a", "b", "c"]
+    assert small.contains("mm") and small.contains("MM", case_sensitive=False)
+    assert small() == ["alpha", "beta", "gamma"]
+    print("\nVerification successful!")
+
+
+if __name__ == "__main__":
+    run_call_overhead_benchmark()
@@ -0,0 +1,127 @@
+import random
+import tracemalloc
+from BeautifulString import BString
+
+# Cross-checks BString against a plain list under a random mix of edits that
+# cross the internal chunk boundaries (chunk splits, merges and drops).
+random.seed(1234)
+
+reference = [f"item-{i}" for i in range(1000)]
+b = BString(*reference)
+assert len(b) == len(reference)
+
+for step in range(5000):
+    op = random.randrange(6)
+    if op == 0:
+        value = f"ins-{step}"
+        index = random.randint(-len(reference) - 5, len(reference) + 5)
+        b.insert(index, value)
+        reference.insert(index, value)
+    elif op == 1 and reference:
+        index = random.randrange(len(reference))
+        assert b.pop(index) == reference.pop(index)
+    elif op == 2 and reference:
+        index = random.randrange(len(reference))
+        b[index] = reference[index] = f"set-{step}"
+    elif op == 3:
+        start = random.randint(0, len(reference))
+        stop = random.randint(start, min(len(reference), start + 150))
+        del b[start:stop]
+        del reference[start:stop]
+    elif op == 4:
+        start = random.randint(0, len(reference))
+        stop = random.randint(start, min(len(reference), start + 20))
+        values = [f"slice-{step}-{k}" for k in range(random.randrange(100))]
+        b[start:stop] = values
+        reference[start:stop] = values
+    else:
+        b.append(f"app-{step}")
+        reference.append(f"app-{step}")
+
+    if reference:
+        # Read around the edit so the cached lookup position is exercised
+        # right after each mutation.
+        probe = random.randrange(len(reference))
+        for i in range(max(0, probe - 70), min(len(reference), probe + 70)):
+            assert b[i] == reference[i]
+
+    if step % 250 == 0:
+        assert list(b) == reference
+        assert [b[i] for i in range(len(reference) - 1, -1, -1)] == reference[::-1]
+
+assert list(b) == reference
+assert len(b) == len(reference)
+for i in range(0, len(reference), 7):
+    assert b[i] == reference[i]
+    assert b[-i - 1] == reference[-i - 1]
+assert list(b[10:500:3]) == reference[10:500:3]
+assert list(b[::-5]) == reference[::-5]
+assert b.head == reference[0] and b.tail == reference[-1]
+
+# Small BStrings start with a chunk sized to their items, which grows as
+# they do; edits and sharing must work across every size on the way.
+for size in (0, 1, 3, 4, 5, 31, 32, 40, 63, 64, 65):
+    items = [f"s{size}-{i}" for i in range(size)]
+    for source in (BString(*items), BString.from_list(items)):
+        shadow = list(items)
+        shared = source + source
+        for step in range(150):
+            op = random.randrange(4)
+            if op == 0:
+                source.append(f"a{step}")
+                shadow.append(f"a{step}")
+            elif op == 1:
+                index = random.randint(0, len(shadow))
+                source.insert(index, f"i{step}")
+                shadow.insert(index, f"i{step}")
+            elif op == 2 and shadow:
+                index = random.randrange(len(shadow))
+                assert source.pop(index) == shadow.pop(index)
+            elif shadow:
+                start = random.randrange(len(shadow))
+                stop = start + random.randrange(10)
+                del source[start:stop]
+                del shadow[start:stop]
+            assert list(source) == shadow
+        assert list(shared) == items + items
+        shared.insert(1, "x")
+        assert list(shared) == (items[:1] + ["x"] + items[1:] + items if items else ["x"])
+
+# A few strings take a few hundred bytes, not a full chunk of 64 slots.
+tracemalloc.start()
+small = [BString("alpha", "beta", "gamma") for _ in range(10000)]
+per_bstring = tracemalloc.get_traced_memory()[0] / len(small)
+tracemalloc.stop()
+del small
+assert per_bstring < 400, per_bstring
+
+# The cursor keeps pointing at the same element across edits before it.
+c = BString("a", "b", "c", "d")
+c.move_next()
+c.move_next()
+assert c.current == "c"
+c.insert(0, "z")
+assert c.current == "c"
+c.pop(0)
+assert c.current == "c"
+c.move_to_tail()
+assert c.current == "d"
+assert not c.move_next()
+
+# Only strings get in, through any path; a rejected slice leaves b unchanged.
+d = BString("a", "b", "c")
+for store in (lambda: d.__setitem__(slice(0, 1), ["x", 1]), lambda: d.__setitem__(1, None),
+              lambda: d.insert(1, b"x"), lambda: d.append(3), lambda: d.extend(["x", 4]),
+              lambda: d.map("split")):
+    try:
+        store()
+        assert False, "a non-str item must be rejected"
+    except TypeError:
+        pass
+assert list(d) == ["a", "b", "c"]
+
+# Iterators keep the BString alive.
+it = iter(BString("x", "y"))
+assert list(it) == ["x", "y"]
+
+print("All chunked storage assertions passed.")
@@ -0,0 +1,86 @@
+import os
+import tracemalloc
+from BeautifulString import BString
+
+lines = [f"2024-05-{i % 28 + 1:02d} INFO worker-{i % 7} handled request {i}" for i in range(20000)]
+lines[10] = "Ünïcödé line, with \"quotes\""
+lines[11] = "Straße ΣΊΣΥΦΟΣ"
+path = "bstring_compact_test.txt"
+with open(path, "w", encoding="utf-8") as f:
+    f.write("\n".join(lines) + "\n")
+
+# --- from_file(compact=True) keeps the lines as UTF-8 bytes ---
+c = BString.from_file(path, compact=True)
+o = BString.from_file(path)
+assert c.is_compact and not o.is_compact
+assert len(c) == len(lines)
+assert list(c) == lines
+assert c[10] == lines[10] and c[-1] == lines[-1] and c.head == lines[0] and c.tail == lines[-1]
+assert list(c[5:50:3]) == lines[5:50:3] and c[5:50:3].is_compact
+assert c() == lines and c(container="tuple") == tuple(lines)
+assert repr(c[:3]) == repr(lines[:3])
+print(f"Loaded {len(c)} lines compactly; c[11] = {c[11]!r}")
+
+# --- join, contains, CSV rendering and to_file run on the arena bytes ---
+assert c.join(", ") == ", ".join(lines)
+assert c.join("") == "".join(lines)
+assert c.contains("request 19999") and not c.contains("request 20000")
+assert c.contains("STRASSE") is o.contains("STRASSE")
+assert c.contains("σίσυφος", case_sensitive=False) is o.contains("σίσυφος", case_sensitive=False) is True
+assert c.contains("WORKER-3", case_sensitive=False) and not c.contains("WORKER-3")
+row = c[8:13]
+for quoting in range(4):
+    assert row(container="csv", quoting=quoting) == o[8:13](container="csv", quoting=quoting)
+assert row(container="csv", delimiter=";", quotechar="'") == o[8:13](container="csv", delimiter=";", quotechar="'")
+c.to_file(path)
+with open(path, encoding="utf-8") as f:
+    assert f.read().splitlines() == lines
+print("join/contains/csv/to_file agree with object storage")
+
+# --- Appends stay compact, other edits expand transparently ---
+c.append("appended")
+c.extend(["one", "two"])
+assert c.is_compact and c[-3:]() == ["appended", "one", "two"]
+d = c + o
+e = c * 2
+assert d.is_compact and e.is_compact and len(e) == 2 * len(c)
+assert list(d) == list(c) + list(o)
+c.append("\udc80")
+assert not c.is_compact and c[-1] == "\udc80"
+c.pop()
+c.compact()
+c.insert(0, "first")
+assert not c.is_compact and c[0] == "first" and c[1] == lines[0]
+c.compact()
+c[1] = "replaced"
+del c[2:5]
+assert c[:3]() == ["first", "replaced", lines[4]]
+assert c.map("upper")[0] == "FIRST" and len(c.filter("startswith", "2024")) == len(lines) - 6
+c.compact()
+assert c.unique().join("") == c.join("")
+assert c.view(0, 2).materialize()() == ["first", "replaced"]
+print(f"After edits: {c[:3]}")
+
+# --- Memory: the arena avoids one str object per line ---
+tracemalloc.start()
+objects = BString.from_file(path)
+objects_mem = tracemalloc.get_traced_memory()[0]
+del objects
+tracemalloc.reset_peak()
+tracemalloc.stop()
+tracemalloc.start()
+compact = BString.from_file(path, compact=True)
+compact_mem = tracemalloc.get_traced_memory()[0]
+tracemalloc.stop()
+print(f"Object storage: {objects_mem / 1e6:.2f} MB, compact storage: {compact_mem / 1e6:.2f} MB")
+assert compact_mem < objects_mem * 0.7
+
+with open(path, "wb") as f:
+    f.write(b"ok\n\xff\xfe broken\n")
+try:
+    BString.from_file(path, compact=True)
+    assert False, "invalid UTF-8 must be rejected"
+except UnicodeDecodeError:
+    pass
+os.remove(path)
+print("Compact storage tests passed.")
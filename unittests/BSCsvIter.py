@@ -0,0 +1,107 @@
+import csv
+import os
+import random
+import time
+import tracemalloc
+from BeautifulString import BString
+
+PATH = "csv_iter_test.csv"
+csv.field_size_limit(1 << 30)
+
+
+class Row(BString):
+    pass
+
+
+def write(data):
+    with open(PATH, "wb") as f:
+        f.write(data.encode("utf-8"))
+
+
+def python_rows():
+    with open(PATH, "r", encoding="utf-8") as f:
+        return list(csv.reader(f))
+
+
+def batches(**kwargs):
+    return [(header, [list(row) for row in rows]) for header, rows in BString.iter_csv(PATH, **kwargs)]
+
+
+try:
+    # --- Batches add up to what from_csv() returns ---
+    rng = random.Random(24)
+    pieces = ["a", "bc", "ÄÖ", "\U0001F600", ",", '""', "\n", "\r\n", " "]
+    lines = []
+    for _ in range(50000):
+        fields = ['"' + "".join(rng.choice(pieces) for _ in range(rng.randrange(6))) + '"' for _ in range(3)]
+        lines.append(",".join(fields))
+    write("id,name,note\n" + "\n".join(lines) + "\n")
+    expected = python_rows()
+    for batch_size in (1, 7, 1000, 10000000):
+        got = batches(batch_size=batch_size)
+        assert all(len(rows) == batch_size for _, rows in got[:-1]) and 0 < len(got[-1][1]) <= batch_size
+        assert all(list(header) == expected[0] for header, _ in got)
+        assert [row for _, rows in got for row in rows] == expected[1:], batch_size
+    got = batches(batch_size=333, header=False, threads=2)
+    assert all(header is None for header, _ in got)
+    assert [row for _, rows in got for row in rows] == expected
+
+    write("name;note\nAnna;'it''s; fine'\nBo;x\n")
+    (header, rows), = BString.iter_csv(PATH, delimiter=";", quotechar="'")
+    assert list(header) == ["name", "note"] and [list(r) for r in rows] == [["Anna", "it's; fine"], ["Bo", "x"]]
+    header, rows = next(iter(Row.iter_csv(PATH, batch_size=1, delimiter=";", quotechar="'")))
+    assert type(header) is Row and type(rows[0]) is Row
+    for data in ("", "a,b\n"):
+        write(data)
+        assert list(BString.iter_csv(PATH)) == []
+    it = BString.iter_csv(PATH, header=False)
+    assert [list(r) for r in next(it)[1]] == [["a", "b"]]
+    assert list(it) == [] and list(it) == []
+    print("iter_csv() batches agree with from_csv()")
+
+    # --- Errors ---
+    for kwargs in ({"batch_size": 0}, {"delimiter": "ab"}, {"quotechar": ","}, {"threads": 0}):
+        try:
+            BString.iter_csv(PATH, **kwargs)
+            assert False, f"{kwargs!r} must be rejected"
+        except ValueError:
+            pass
+    try:
+        BString.iter_csv("no_such_file.csv")
+        assert False, "a missing file must raise"
+    except OSError:
+        pass
+    with open(PATH, "wb") as f:
+        f.write(b"a\nok\n\xff\n")
+    it = BString.iter_csv(PATH, batch_size=1)
+    assert list(next(it)[1][0]) == ["ok"]
+    try:
+        next(it)
+        assert False, "invalid UTF-8 must raise"
+    except UnicodeDecodeError:
+        pass
+    print("iter_csv() errors passed")
+
+    # --- Memory stays bounded by the block and batch sizes ---
+    row = "2024-05-01,alpha,1234,\"quoted, text\",beta\n"
+    write("a,b,c,d,e\n" + row * 100000)
+    megabytes = os.path.getsize(PATH) / 1e6
+    tracemalloc.start()
+    count = 0
+    start = time.perf_counter()
+    for header, rows in BString.iter_csv(PATH, batch_size=1000):
+        count += len(rows)
+    elapsed = time.perf_counter() - start
+    iter_peak = tracemalloc.get_traced_memory()[1]
+    tracemalloc.reset_peak()
+    header, rows = BString.from_csv(PATH)
+    list_peak = tracemalloc.get_traced_memory()[1]
+    tracemalloc.stop()
+    assert count == len(rows) == 100000
+    assert iter_peak * 10 < list_peak, (iter_peak, list_peak)
+    print(f"{megabytes:.0f} MB file: iter_csv peak {iter_peak / 1e6:.1f} MB in {elapsed * 1000:.0f} ms "
+          f"(traced), from_csv peak {list_peak / 1e6:.1f} MB")
+finally:
+    if os.path.exists(PATH):
+        os.remove(PATH)
+print("iter_csv() tests passed.")
@@ -0,0 +1,98 @@
+import csv
+import os
+import random
+import time
+from BeautifulString import BString
+
+PATH = "csv_reader_test.csv"
+csv.field_size_limit(1 << 30)
+
+
+def write(data):
+    with open(PATH, "wb") as f:
+        f.write(data.encode("utf-8"))
+
+
+def python_rows(delimiter=",", quotechar='"'):
+    with open(PATH, "r", encoding="utf-8") as f:
+        return list(csv.reader(f, delimiter=delimiter, quotechar=quotechar))
+
+
+def native_rows(**kwargs):
+    return [list(row) for row in BString.from_csv(PATH, header=False, **kwargs)]
+
+
+try:
+    # --- Edge cases against the csv module ---
+    cases = ['a,b\n\nc\n', 'a,"b"c,d\n', 'a"b,c\n', '"abc', '"a\r\nb",c\r\nd\r', 'a,b', ' "a",b\n',
+             '"a""b",""\n', 'a,"b\n', '"a" "b",c\n', ',\n', '\r\n\r\n', 'a,b\n,\n""\n', '', '\n', 'a,',
+             '"x\ry",z\r', '"é€","\U0001F600,"\n', 'x\r\n\ny', '"a"\r\n"b"']
+    for data in cases:
+        write(data)
+        assert native_rows() == python_rows(), data
+    write("name;note\nAnna;'it''s; fine'\n")
+    header, rows = BString.from_csv(PATH, delimiter=";", quotechar="'")
+    assert list(header) == ["name", "note"] and [list(r) for r in rows] == [["Anna", "it's; fine"]]
+    write("")
+    header, rows = BString.from_csv(PATH)
+    assert list(header) == [] and rows == []
+    print("from_csv() edge cases agree with the csv module")
+
+    # --- Random files, large enough to span several read blocks ---
+    rng = random.Random(21)
+    pieces = ["a", "bc", "ÄÖ", "€", "\U0001F600", ",", ",", '"', '""', "\n", "\r\n", "\r", " "]
+    for size, delimiter in ((200, ","), (2000, ","), (600000, ","), (600000, ";")):
+        chunks = []
+        for _ in range(size):
+            if rng.random() < 0.2:
+                field = "".join(rng.choice(pieces) for _ in range(rng.randrange(6))).replace('"', '""')
+                chunks.append('"' + field + '"')
+            else:
+                chunks.append("".join(rng.choice(pieces[:5]) for _ in range(rng.randrange(4))))
+            chunks.append(rng.choice([delimiter] * 4 + ["\n", "\r\n"]))
+        if rng.random() < 0.5:
+            chunks.append('"' + "long quoted\r\nfield, " * 200000 + '"\n')
+        write("".join(chunks))
+        assert native_rows(delimiter=delimiter) == python_rows(delimiter=delimiter), size
+    print("from_csv() agrees with the csv module on random files")
+
+    try:
+        BString.from_csv("no/such/file.csv")
+        assert False, "a missing file must raise"
+    except FileNotFoundError:
+        pass
+    with open(PATH, "wb") as f:
+        f.write(b"ok,\xff\n")
+    try:
+        BString.from_csv(PATH)
+        assert False, "invalid UTF-8 must raise"
+    except UnicodeDecodeError:
+        pass
+    for bad in ({"delimiter": ",,"}, {"quotechar": ""}, {"delimiter": "\n"}, {"delimiter": '"'}):
+        try:
+            BString.from_csv(PATH, **bad)
+            assert False, f"{bad!r} must be rejected"
+        except ValueError:
+            pass
+    print("from_csv() error handling passed")
+
+    # --- Benchmark ---
+    with open(PATH, "w", encoding="utf-8", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["id", "name", "city", "note", "amount"])
+        for i in range(300000):
+            writer.writerow([i, f"user{i}", "Helsinki" if i % 3 else "Oulu", f'says "hi", #{i}' if i % 5 == 0 else "", i * 1.5])
+    size = os.path.getsize(PATH)
+    start = time.perf_counter()
+    header, rows = BString.from_csv(PATH)
+    native_time = time.perf_counter() - start
+    start = time.perf_counter()
+    expected = python_rows()
+    python_time = time.perf_counter() - start
+    assert [list(header)] + [list(r) for r in rows] == expected
+    print(f"{size / 1e6:.0f} MB, {len(rows)} rows: from_csv {native_time * 1000:.0f} ms ({size / native_time / 1e6:.0f} MB/s), "
+          f"csv.reader without building BStrings {python_time * 1000:.0f} ms")
+finally:
+    if os.path.exists(PATH):
+        os.remove(PATH)
+print("from_csv() tests passed.")
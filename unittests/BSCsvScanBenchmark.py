@@ -0,0 +1,48 @@
+import os
+import time
+from BeautifulString import BString
+
+# --- Configuration ---
+REPEATS = 5
+FILE_PATH = "csv_scan_bench.csv"
+
+
+def best_of(label, size):
+    """Loads FILE_PATH REPEATS times and prints the best throughput."""
+    best = None
+    rows = None
+    for _ in range(REPEATS):
+        start = time.perf_counter()
+        rows = BString.from_csv(FILE_PATH, header=False)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"  {label:<34} {size / 1e6:7.1f} MB {best * 1000:9.2f} ms {size / best / 1e9:7.2f} GB/s")
+    return rows
+
+
+def run_scan_benchmark():
+    """
+    Times from_csv() on files whose fields are long, so that finding the
+    delimiters, quotes and line breaks dominates rather than creating the
+    field objects.
+    """
+    text = "lorem ipsum dolor sit amet consectetur adipiscing elit " * 300
+    layouts = [
+        ("long unquoted fields", "\n".join(",".join([text] * 4) for _ in range(500)) + "\n"),
+        ("long quoted fields", "\n".join(",".join(['"' + text.replace("elit", 'e""lit,\n') + '"'] * 4) for _ in range(500)) + "\n"),
+        ("short fields", "".join(f"{i},user{i},Helsinki,{i * 1.5}\n" for i in range(300000))),
+    ]
+    print("--- from_csv() structural scanning ---")
+    try:
+        for label, data in layouts:
+            with open(FILE_PATH, "w", encoding="utf-8", newline="") as f:
+                f.write(data)
+            rows = best_of(label, os.path.getsize(FILE_PATH))
+            assert len(rows) == data.count("\n") - data.count(",\n")
+    finally:
+        if os.path.exists(FILE_PATH):
+            os.remove(FILE_PATH)
+
+
+if __name__ == "__main__":
+    run_scan_benchmark()
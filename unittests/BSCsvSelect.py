@@ -0,0 +1,138 @@
+import csv
+import os
+import random
+import time
+from BeautifulString import BString
+
+PATH = "csv_select_test.csv"
+csv.field_size_limit(1 << 30)
+
+
+def write(data):
+    with open(PATH, "wb") as f:
+        f.write(data.encode("utf-8"))
+
+
+def reference(header=True, usecols=None, skiprows=0, nrows=None, where=None):
+    """What from_csv() returns, computed from the csv module's rows."""
+    with open(PATH, "r", encoding="utf-8") as f:
+        records = list(csv.reader(f))
+    names = records.pop(0) if header and records else []
+
+    def column(key):
+        return key if isinstance(key, int) else names.index(key)
+
+    def field(record, key):
+        c = column(key)
+        return record[c] if c < len(record) else ""
+
+    def project(record):
+        return list(record) if usecols is None or not record else [field(record, key) for key in usecols]
+
+    data = records[skiprows:]
+    if where:
+        data = [r for r in data if r and all(field(r, k) == v for k, v in where.items())]
+    if nrows is not None:
+        data = data[:nrows]
+    rows = [project(r) for r in data]
+    return (project(names) if names else [], rows) if header else rows
+
+
+def native(**kwargs):
+    result = BString.from_csv(PATH, **kwargs)
+    if kwargs.get("header", True):
+        return list(result[0]), [list(row) for row in result[1]]
+    return [list(row) for row in result]
+
+
+try:
+    # --- Each option, alone and combined ---
+    write('id,name,city,note\n1,Anna,Oulu,"a, b"\n2,Bo,Turku,x\n3,Cy,Oulu\n\n4,Di,Oulu,"multi\nline"\n')
+    assert native(usecols=["name", 0]) == (["name", "id"], [["Anna", "1"], ["Bo", "2"], ["Cy", "3"], [], ["Di", "4"]])
+    assert native(usecols=[3]) == (["note"], [["a, b"], ["x"], [""], [], ["multi\nline"]])
+    assert native(skiprows=2, nrows=1) == (["id", "name", "city", "note"], [["3", "Cy", "Oulu"]])
+    assert native(where={"city": "Oulu"}, usecols=["name"]) == (["name"], [["Anna"], ["Cy"], ["Di"]])
+    assert native(where={"city": "Oulu", 3: ""}) == (["id", "name", "city", "note"], [["3", "Cy", "Oulu"]])
+    assert native(where={"city": "Oulu"}, nrows=2, skiprows=1) == reference(where={"city": "Oulu"}, nrows=2, skiprows=1)
+    assert native(nrows=0) == (["id", "name", "city", "note"], [])
+    assert native(usecols=[]) == ([], [[]] * 5)
+    assert native(header=False, usecols=[1, 1], nrows=2) == [["name", "name"], ["Anna", "Anna"]]
+    assert native(header=False, where={0: "2"}) == [["2", "Bo", "Turku", "x"]]
+    # An empty line is a record without fields: not padded, and no condition holds for it.
+    write("a,b,c\n1,,\n\n\r\n2\n")
+    for threads in (1, 2):
+        assert native(usecols=["c", "a"], threads=threads) == (["c", "a"], [["", "1"], [], [], ["", "2"]])
+        assert native(where={"c": ""}, threads=threads) == (["a", "b", "c"], [["1", "", ""], ["2"]])
+        assert native(where={"c": ""}, usecols=["a"], threads=threads) == (["a"], [["1"], ["2"]])
+        assert native(skiprows=1, usecols=[2], threads=threads) == reference(skiprows=1, usecols=[2])
+    write("")
+    assert native(usecols=[0], nrows=3) == ([], [])
+    print("from_csv() usecols, skiprows, nrows and where basics passed")
+
+    # --- Random files and options against the csv module ---
+    rng = random.Random(25)
+    pieces = ["a", "b", "é", "\U0001F600", ",", '""', "\n", "\r\n", " "]
+    values = ["", "a", "b", "ab"]
+    lines = ["c0,c1,c2,c3,c4,c5"]
+    for _ in range(60000):
+        fields = []
+        for _ in range(rng.randrange(0, 8)):
+            if rng.random() < 0.3:
+                fields.append('"' + "".join(rng.choice(pieces) for _ in range(rng.randrange(5))) + '"')
+            else:
+                fields.append(rng.choice(values))
+        lines.append(",".join(fields))
+    write("\n".join(lines) + "\n")
+    for trial in range(40):
+        options = {}
+        if rng.random() < 0.7:
+            options["usecols"] = [rng.choice([rng.randrange(8), f"c{rng.randrange(6)}"]) for _ in range(rng.randrange(4))]
+        if rng.random() < 0.5:
+            options["skiprows"] = rng.randrange(100)
+        if rng.random() < 0.5:
+            options["nrows"] = rng.randrange(40000)
+        if rng.random() < 0.6:
+            options["where"] = {rng.choice([rng.randrange(8), f"c{rng.randrange(6)}"]): rng.choice(values)
+                                for _ in range(rng.randrange(1, 3))}
+        expected = reference(**options)
+        for threads in (1, 3):
+            assert native(threads=threads, **options) == expected, (options, threads)
+    print("from_csv() selections agree with the csv module on random files")
+
+    # --- Errors ---
+    for kwargs, error in (({"usecols": ["nope"]}, ValueError), ({"usecols": [-1]}, ValueError),
+                          ({"usecols": "c0"}, TypeError), ({"usecols": [1.5]}, TypeError),
+                          ({"header": False, "usecols": ["c0"]}, ValueError), ({"skiprows": -1}, ValueError),
+                          ({"nrows": -1}, ValueError), ({"where": [("c0", "a")]}, TypeError),
+                          ({"where": {"c0": 1}}, TypeError), ({"where": {"zz": "a"}}, ValueError)):
+        try:
+            BString.from_csv(PATH, **kwargs)
+            assert False, f"{kwargs!r} must raise"
+        except error:
+            pass
+    print("from_csv() selection errors passed")
+
+    # --- 3 of 80 columns ---
+    header = ",".join(f"col{i}" for i in range(80))
+    row = ",".join(f"value{i}" for i in range(80))
+    write(header + "\n" + (row + "\n") * 40000)
+    megabytes = os.path.getsize(PATH) / 1e6
+    start = time.perf_counter()
+    names, rows = BString.from_csv(PATH)
+    full = time.perf_counter() - start
+    picked = [[row[3], row[40], row[77]] for row in rows]
+    del rows
+    start = time.perf_counter()
+    names, rows = BString.from_csv(PATH, usecols=["col3", "col40", "col77"])
+    selected = time.perf_counter() - start
+    assert list(names) == ["col3", "col40", "col77"] and [list(r) for r in rows] == picked
+    start = time.perf_counter()
+    names, rows = BString.from_csv(PATH, usecols=[3], nrows=10)
+    limited = time.perf_counter() - start
+    assert len(rows) == 10
+    print(f"{megabytes:.0f} MB, 80 columns: all {full * 1000:.0f} ms, usecols of 3 {selected * 1000:.0f} ms, "
+          f"nrows=10 {limited * 1000:.1f} ms")
+finally:
+    if os.path.exists(PATH):
+        os.remove(PATH)
+print("from_csv() selection tests passed.")
@@ -0,0 +1,103 @@
+import random
+import time
+from BeautifulString import BString, BStringExpr
+
+# --- Basic usage ---
+logs = BString("ERROR: disk full on /dev/sda1", "ERR short", "INFO: all good",
+               "ERROR: debug dump follows, see attached", "warning: Disk almost full")
+assert list(logs.filter_expr("startswith('ERR') and len > 20 and not contains('debug')")) == [
+    "ERROR: disk full on /dev/sda1"]
+assert list(logs.filter_expr("icontains('DISK') or equals('ERR short')")) == [
+    "ERROR: disk full on /dev/sda1", "ERR short", "warning: Disk almost full"]
+assert list(logs.filter_expr("not (startswith(\"ERR\") or startswith('INFO'))")) == ["warning: Disk almost full"]
+assert list(BString("123", "12a", "", "abc", "ABC").filter_expr("isdigit or isupper()")) == ["123", "ABC"]
+assert list(BString("a'b", 'a"b', "a\\b").filter_expr("contains('\\'') or contains(\"\\\\\")")) == ["a'b", "a\\b"]
+
+compiled = BStringExpr("len <= 9")
+assert compiled.expression == "len <= 9" and repr(compiled) == "BStringExpr('len <= 9')"
+assert list(logs.filter_expr(compiled)) == ["ERR short"]
+
+for bad in ("", "startswith('x'", "contains(x)", "len >", "len ~ 3", "frobnicate('x')", "isdigit('x')",
+            "startswith('a') and", "(len > 2", "len > 2 extra", "'unterminated", "not " * 300 + "isdigit"):
+    try:
+        logs.filter_expr(bad)
+        assert False, f"{bad!r} must be rejected"
+    except ValueError:
+        pass
+try:
+    logs.filter_expr(42)
+    assert False, "non-string expressions must be rejected"
+except TypeError:
+    pass
+print("filter_expr() basics passed")
+
+# --- Random expressions against Python ---
+rng = random.Random(17)
+alphabet = "abAB12 é€ΣİK\U0001F600"
+items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(10))) for _ in range(1500)]
+words = ["a", "ab", "B", "1", "é€", "\U0001F600", "Σ", "k", ""]
+
+
+def random_test():
+    kind = rng.randrange(6)
+    word = rng.choice(words)
+    if kind == 0:
+        return f"contains('{word}')", lambda s, w=word: w in s
+    if kind == 1:
+        return f"icontains('{word}')", lambda s, w=word: w.lower() in s.lower()
+    if kind == 2:
+        return f"startswith('{word}')", lambda s, w=word: s.startswith(w)
+    if kind == 3:
+        return f"endswith('{word}')", lambda s, w=word: s.endswith(w)
+    if kind == 4:
+        n, op = rng.randrange(8), rng.choice(["<", "<=", ">", ">=", "==", "!="])
+        return f"len {op} {n}", eval(f"lambda s: len(s) {op} {n}")
+    name = rng.choice(["isdigit", "isalpha", "isalnum", "isspace", "islower", "isupper", "isascii"])
+    return name, lambda s, m=name: getattr(s, m)()
+
+
+def random_expr(depth=0):
+    if depth > 2 or rng.random() < 0.4:
+        return random_test()
+    kind = rng.randrange(3)
+    if kind == 0:
+        text, check = random_expr(depth + 1)
+        return f"not ({text})", lambda s: not check(s)
+    parts = [random_expr(depth + 1) for _ in range(rng.randrange(2, 4))]
+    word = " and " if kind == 1 else " or "
+    combine = all if kind == 1 else any
+    return word.join(f"({t})" for t, _ in parts), lambda s: combine(c(s) for _, c in parts)
+
+
+for compact in (False, True):
+    b = BString.from_list(items)
+    if compact:
+        b.compact()
+    for _ in range(150):
+        text, check = random_expr()
+        kept = b.filter_expr(text)
+        assert list(kept) == [s for s in items if check(s)], text
+        assert kept.is_compact == compact
+long_chain = " or ".join(f"equals('{i}')" for i in range(5000))
+assert list(BString("17", "x", "4999").filter_expr(long_chain)) == ["17", "4999"]
+print("filter_expr() agrees with Python on random expressions (object and compact storage)")
+
+# --- Benchmark ---
+levels = ["ERROR", "WARN", "INFO", "DEBUG"]
+lines = [f"{levels[i % 4]} 2024-05-01 request {i} {'debug trace ' if i % 7 == 0 else ''}took {i % 997} ms"
+         for i in range(1000000)]
+expression = "startswith('ERR') and len > 40 and not contains('debug')"
+for compact in (False, True):
+    b = BString.from_list(lines)
+    if compact:
+        b.compact()
+    start = time.perf_counter()
+    kept = b.filter_expr(expression)
+    expr_time = time.perf_counter() - start
+    start = time.perf_counter()
+    expected = b.filter(lambda s: s.startswith("ERR") and len(s) > 40 and "debug" not in s)
+    lambda_time = time.perf_counter() - start
+    assert list(kept) == list(expected)
+    print(f"{'compact ' if compact else ''}{len(lines)} lines: filter_expr {expr_time * 1000:.1f} ms, "
+          f"filter(lambda) {lambda_time * 1000:.1f} ms ({len(kept)} kept)")
+print("filter_expr() tests passed.")
@@ -0,0 +1,77 @@
+import random
+import time
+from array import array
+from BeautifulString import BString
+
+
+def fold(text):
+    return "".join(c.lower() for c in text)
+
+
+def expected_indices(items, substring, case_sensitive=True, invert=False):
+    if case_sensitive:
+        return [i for i, item in enumerate(items) if (substring in item) != invert]
+    key = substring.lower()
+    return [i for i, item in enumerate(items) if (key in item.lower()) != invert]
+
+
+# --- Basic usage ---
+b = BString("error: disk full", "all good", "WARNING: disk almost full", "fatal error")
+hits = b.find_all("error")
+assert isinstance(hits, array) and hits.typecode == "q" and list(hits) == [0, 3]
+assert list(b.find_all("disk", invert=True)) == [1, 3]
+assert list(b.find_all("warning")) == [] and list(b.find_all("warning", case_sensitive=False)) == [2]
+assert list(b.find_all("")) == [0, 1, 2, 3] and list(BString().find_all("x")) == []
+assert memoryview(b.find_all("full")).tolist() == [0, 2]
+
+matched = b.grep("full")
+assert isinstance(matched, BString) and list(matched) == ["error: disk full", "WARNING: disk almost full"]
+assert list(b.grep("FULL", case_sensitive=False, invert=True)) == ["all good", "fatal error"]
+assert len(b.grep("nothing")) == 0
+try:
+    b.contains("x", invert=True)
+    assert False, "contains() takes no invert"
+except TypeError:
+    pass
+print("find_all() and grep() basics passed")
+
+# --- Random texts, non-ASCII, both storage modes ---
+rng = random.Random(14)
+alphabet = "abAB é€ΣσıİK\U0001F600"
+items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(40))) for _ in range(500)]
+substrings = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(1, 4))) for _ in range(60)]
+substrings += ["a", "ab", "é€", "\U0001F600", "Σσ", "k", "ab" * 10]
+for compact in (False, True):
+    bs = BString.from_list(items)
+    if compact:
+        bs.compact()
+    for substring in substrings:
+        for case_sensitive in (True, False):
+            for invert in (False, True):
+                expected = expected_indices(items, substring, case_sensitive, invert)
+                assert list(bs.find_all(substring, case_sensitive, invert)) == expected, (substring, case_sensitive, invert)
+            assert bs.contains(substring, case_sensitive) == bool(expected_indices(items, substring, case_sensitive))
+        grepped = bs.grep(substring)
+        assert list(grepped) == [s for s in items if substring in s]
+        assert grepped.is_compact == compact
+print("find_all() agrees with the in operator on random texts (object and compact storage)")
+
+# --- Filtering many lines ---
+lines = [f"2024-05-01 {'ERROR' if i % 97 == 0 else 'INFO'} request {i} took {i % 997} ms" for i in range(1000000)]
+log = BString.from_list(lines)
+start = time.perf_counter()
+flags = ["ERROR" in line for line in lines]
+expected = [i for i, flag in enumerate(flags) if flag]
+list_time = time.perf_counter() - start
+start = time.perf_counter()
+hits = log.find_all("ERROR")
+find_time = time.perf_counter() - start
+assert list(hits) == expected
+log.compact()
+start = time.perf_counter()
+compact_hits = log.find_all("ERROR")
+compact_time = time.perf_counter() - start
+assert compact_hits == hits
+print(f"{len(lines)} lines: list of booleans {list_time * 1000:.1f} ms, find_all {find_time * 1000:.1f} ms, "
+      f"compact find_all {compact_time * 1000:.1f} ms ({len(hits)} matches, {hits.itemsize * len(hits)} bytes)")
+print("find_all() tests passed.")
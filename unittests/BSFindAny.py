@@ -0,0 +1,91 @@
+import random
+import time
+from BeautifulString import BString, BStringPatterns
+
+
+def fold(text):
+    """str.lower() of the text, with the item offset of every lowered code point."""
+    return text.lower(), [i for i, c in enumerate(text) for _ in c.lower()]
+
+
+def expected_matches(items, patterns, case_sensitive=True):
+    """(index, pattern, offset) for every occurrence, by end position and longest first."""
+    keys = {}
+    for p in patterns:
+        keys.setdefault(p if case_sensitive else p.lower(), p)
+    found = []
+    for index, item in enumerate(items):
+        text, origin = (item, range(len(item))) if case_sensitive else fold(item)
+        hits = []
+        for key, pattern in keys.items():
+            start = text.find(key)
+            while start != -1:
+                hits.append((start + len(key), -len(key), index, pattern, origin[start]))
+                start = text.find(key, start + 1)
+        found.extend((i, p, o) for _, _, i, p, o in sorted(hits))
+    return found
+
+
+# --- Basic usage ---
+b = BString("error: disk full", "all good", "WARNING: disk almost full", "fatal error")
+assert b.find_any(["error", "full"]) == [0, 2, 3]
+assert b.find_any(["warning"]) == [] and b.find_any(["warning"], case_sensitive=False) == [2]
+assert b.find_any(["disk", "disk full", "full"], positions=True) == [
+    (0, "disk", 7), (0, "disk full", 7), (0, "full", 12), (2, "disk", 9), (2, "full", 21)]
+assert b.find_any([]) == [] and BString().find_any(["x"]) == []
+for bad in ("error", ["ok", ""], ["ok", 3]):
+    try:
+        b.find_any(bad)
+        assert False, f"{bad!r} must be rejected"
+    except (TypeError, ValueError):
+        pass
+
+compiled = BStringPatterns(["ERROR", "fatal"], case_sensitive=False)
+assert len(compiled) == 2 and compiled.patterns == ("ERROR", "fatal") and not compiled.case_sensitive
+assert b.find_any(compiled) == [0, 3]
+assert b.find_any(compiled, positions=True) == [(0, "ERROR", 0), (3, "fatal", 0), (3, "ERROR", 6)]
+
+# Ignoring case matches item.lower(), like contains() and find_all().
+assert BString("i").find_any(["\u0130"], case_sensitive=False) == list(BString("i").find_all("\u0130", case_sensitive=False)) == []
+odysseus = BString("ΟΔΥΣΣΕΎΣ", "x\u0130y")
+assert odysseus.find_any(["ς"], case_sensitive=False, positions=True) == [(0, "ς", 7)]
+assert odysseus.find_any(["i\u0307y", "Y"], case_sensitive=False, positions=True) == [(1, "i\u0307y", 1), (1, "Y", 2)]
+print("find_any() basics passed")
+
+# --- Random texts, overlapping patterns, non-ASCII, both storage modes ---
+rng = random.Random(11)
+alphabet = "abAB é€ΣσςK\u0130i\U0001F600"
+items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(30))) for _ in range(400)]
+patterns = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(1, 5))) for _ in range(60)]
+patterns += ["a", "aa", "aaa", "ab", "bab", "é€", "\U0001F600", "Σσ", "k", "ς", "\u0130", "i\u0307"]
+for compact in (False, True):
+    bs = BString.from_list(items)
+    if compact:
+        bs.compact()
+    for case_sensitive in (True, False):
+        compiled = BStringPatterns(patterns, case_sensitive=case_sensitive)
+        expected = expected_matches(items, patterns, case_sensitive)
+        assert bs.find_any(compiled, positions=True) == expected
+        assert bs.find_any(patterns, case_sensitive=case_sensitive) == sorted({i for i, _, _ in expected})
+print("find_any() agrees with str.find() on random texts (object and compact storage)")
+
+# --- Thousands of keywords against many lines ---
+keywords = [f"user{i:05d}" for i in range(0, 100000, 50)]
+lines = [f"2024-05-01 INFO request from user{rng.randrange(200000):05d} took {i % 997} ms" for i in range(50000)]
+log = BString.from_list(lines)
+sample = keywords[:100]
+start = time.perf_counter()
+for k in sample:
+    log.contains(k)
+contains_time = time.perf_counter() - start
+start = time.perf_counter()
+compiled = BStringPatterns(keywords)
+compile_time = time.perf_counter() - start
+start = time.perf_counter()
+hits = log.find_any(compiled)
+scan_time = time.perf_counter() - start
+assert hits == [i for i, line in enumerate(lines) if any(k in line for k in keywords)]
+print(f"{len(keywords)} keywords x {len(lines)} lines: compile {compile_time * 1000:.1f} ms, "
+      f"find_any {scan_time * 1000:.1f} ms ({len(hits)} matching lines); "
+      f"contains() per keyword would take ~{contains_time / len(sample) * len(keywords):.1f} s")
+print("find_any() tests passed.")
@@ -0,0 +1,104 @@
+import random
+import time
+from BeautifulString import BString
+
+# --- 'in', index() and count() follow list semantics, with or without an index ---
+words = ["alpha", "beta", "gamma", "beta", "delta", "beta", "Ünïcödé"]
+for indexed in (False, True):
+    b = BString(*words)
+    if indexed:
+        b.enable_index()
+    assert b.is_indexed is indexed
+    assert "beta" in b and "Ünïcödé" in b and "omega" not in b and 42 not in b
+    assert b.index("beta") == 1 and b.index("beta", 2) == 3 and b.index("beta", 4, 6) == 5
+    assert b.index("beta", -3) == 5 and b.index("alpha", -100) == 0
+    for start, stop in ((2, 3), (6, 100), (5, 2)):
+        try:
+            b.index("beta", start, stop)
+            assert False, "index() outside the range must fail"
+        except ValueError:
+            pass
+    assert b.count("beta") == 3 and b.count("omega") == 0 and b.count(None) == 0
+    b.remove("beta")
+    assert list(b) == ["alpha", "gamma", "beta", "delta", "beta", "Ünïcödé"] and b.index("beta") == 2
+    try:
+        b.remove("omega")
+        assert False, "remove() of a missing string must fail"
+    except ValueError:
+        pass
+print("Membership, index() and count() agree with list")
+
+# --- The index follows every kind of mutation ---
+rng = random.Random(7)
+vocabulary = [f"key-{i}" for i in range(40)] + ["Straße", "ΣΊΣΥΦΟΣ"]
+for compact in (False, True):
+    b = BString(*[rng.choice(vocabulary) for _ in range(300)])
+    model = list(b)
+    if compact:
+        b.compact()
+    b.enable_index()
+    for step in range(5000):
+        op = rng.randrange(9)
+        word = rng.choice(vocabulary)
+        if op == 0:
+            b.append(word); model.append(word)
+        elif op == 1 and model:
+            pos = rng.randrange(len(model) + 1)
+            b.insert(pos, word); model.insert(pos, word)
+        elif op == 2 and model:
+            pos = rng.randrange(len(model))
+            assert b.pop(pos) == model.pop(pos)
+        elif op == 3 and model:
+            pos = rng.randrange(len(model))
+            b[pos] = word; model[pos] = word
+        elif op == 4 and word in model:
+            b.remove(word); model.remove(word)
+        elif op == 5 and model:
+            lo = rng.randrange(len(model))
+            hi = lo + rng.randrange(5)
+            del b[lo:hi]; del model[lo:hi]
+        elif op == 6:
+            b.extend([word, word]); model.extend([word, word])
+        elif op == 7 and step % 50 == 0:
+            b.expand() if b.is_compact else b.compact()
+        assert (word in b) == (word in model)
+        assert b.count(word) == model.count(word)
+        if word in model:
+            assert b.index(word) == model.index(word)
+            start = rng.randrange(len(model))
+            expected = word in model[start:] and model.index(word, start)
+            assert (word in list(b)[start:] and b.index(word, start)) == expected
+    assert list(b) == model
+print("Index stays consistent through random edits (object and compact storage)")
+
+# --- Lookup table timing ---
+n = 200000
+keys = [f"user-{i:07d}" for i in range(n)]
+probes = [keys[rng.randrange(n)] for _ in range(2000)] + [f"missing-{i}" for i in range(2000)]
+
+plain = BString.from_list(keys)
+indexed = BString.from_list(keys)
+indexed.enable_index()
+t0 = time.perf_counter()
+plain_hits = sum(1 for p in probes[:200] if p in plain)
+scan_time = (time.perf_counter() - t0) / 200
+t0 = time.perf_counter()
+indexed_hits = sum(1 for p in probes if p in indexed)
+index_time = (time.perf_counter() - t0) / len(probes)
+assert indexed_hits == 2000
+t0 = time.perf_counter()
+for p in probes[:2000]:
+    assert keys[indexed.index(p)] == p
+lookup_time = (time.perf_counter() - t0) / 2000
+print(f"'in' over {n} strings: scan {scan_time * 1e6:.1f} us, indexed {index_time * 1e6:.2f} us (first call builds the index)")
+print(f"index() with the hash index: {lookup_time * 1e6:.2f} us per call")
+
+t0 = time.perf_counter()
+for p in probes[:500]:
+    if p in indexed:
+        indexed.remove(p)
+print(f"remove() of 500 random strings with the index: {(time.perf_counter() - t0) * 1e3:.1f} ms")
+assert len(indexed) == n - len(set(probes[:500]))
+indexed.disable_index()
+assert not indexed.is_indexed and probes[-1] not in indexed
+print("Hash index tests passed.")
@@ -0,0 +1,56 @@
+import random
+import time
+from BeautifulString import BString
+
+# --- Configuration ---
+NUM_ITEMS = 2_000_000
+NUM_OPS = 50_000
+
+
+def timed(label, func):
+    start = time.perf_counter()
+    func()
+    elapsed = time.perf_counter() - start
+    print(f"  {label:<40} {elapsed:8.4f} s  ({elapsed / NUM_OPS * 1e6:.2f} us/op)")
+
+
+def run_index_benchmark():
+    """
+    Exercises positional access interleaved with edits far away from the
+    accessed position, the pattern that used to force a directory rescan.
+    """
+    reference = [f"item-{i}" for i in range(NUM_ITEMS)]
+    b = BString(*reference)
+    random.seed(42)
+
+    print(f"--- Positional access on {NUM_ITEMS:,} items, {NUM_OPS:,} ops ---")
+
+    def insert_head_read_tail():
+        for k in range(NUM_OPS):
+            b.insert(100, "x")
+            b[-1]
+
+    def random_access():
+        for _ in range(NUM_OPS):
+            b[random.randrange(len(b))]
+
+    def pop_middle():
+        for _ in range(NUM_OPS):
+            b.pop(len(b) // 2)
+
+    timed("insert near head + read tail", insert_head_read_tail)
+    timed("random b[i]", random_access)
+    timed("pop(len // 2)", pop_middle)
+
+    # Verify the results are still correct
+    reference[100:100] = ["x"] * NUM_OPS
+    for _ in range(NUM_OPS):
+        reference.pop(len(reference) // 2)
+    assert len(b) == len(reference)
+    for i in random.sample(range(len(reference)), 1000):
+        assert b[i] == reference[i]
+    print("\nVerification successful!")
+
+
+if __name__ == "__main__":
+    run_index_benchmark()
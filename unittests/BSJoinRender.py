@@ -0,0 +1,70 @@
+import random
+import time
+from BeautifulString import BString
+
+QUOTE_MINIMAL, QUOTE_ALL, QUOTE_NONE = 0, 1, 3
+
+
+def render(items, delimiter=",", quotechar='"', quoting=QUOTE_MINIMAL):
+    fields = []
+    for s in items:
+        quote = quoting == QUOTE_ALL or (quoting == QUOTE_MINIMAL and (delimiter in s or quotechar in s))
+        fields.append(quotechar + s.replace(quotechar, quotechar * 2) + quotechar if quote else s)
+    return delimiter.join(fields)
+
+
+# --- Random items of every str width, both storage modes ---
+rng = random.Random(19)
+alphabets = ["ab,\"; x", "ab é,\"ÿ", "aΣ€,\"'", "a\U0001F600,\"é"]
+for compact in (False, True):
+    for _ in range(300):
+        alphabet = rng.choice(alphabets) + rng.choice(alphabets)
+        items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(12))) for _ in range(rng.randrange(6))]
+        b = BString.from_list(items)
+        if compact:
+            b.compact()
+        for sep in ("", ",", " - ", "€", "\U0001F600"):
+            joined = b.join(sep)
+            assert joined == sep.join(items) and hash(joined) == hash(sep.join(items))
+        for delimiter, quotechar in ((",", '"'), (";", "'")):
+            for quoting in (QUOTE_MINIMAL, QUOTE_ALL, QUOTE_NONE):
+                row = b(container="csv", delimiter=delimiter, quotechar=quotechar, quoting=quoting)
+                expected = render(items, delimiter, quotechar, quoting)
+                assert row == expected and hash(row) == hash(expected), (items, delimiter, quoting)
+single = "only"
+assert BString(single).join(", ") is single
+assert BString().join(", ") == "" and BString()(container="csv") == ""
+view = BString("a", "b", "c", "d", "e").view(0, 5, 2)
+assert view.join("+") == "a+c+e"
+try:
+    BString("a").join(3)
+    assert False, "non-string separators must be rejected"
+except TypeError:
+    pass
+# The renderers read every item as a str, so a non-str never gets stored.
+b = BString("a", "b")
+try:
+    b[0:1] = [1]
+    assert False, "non-string items must be rejected"
+except TypeError:
+    pass
+assert b.join("-") == "a-b" and b(container="csv") == "a,b"
+print("join() and CSV rendering agree with Python (all str widths, object and compact storage)")
+
+# --- Benchmark ---
+fields = [f"field {i}" if i % 10 else f'say "hi", {i}' for i in range(1000000)]
+b = BString.from_list(fields)
+start = time.perf_counter()
+joined = b.join(",")
+join_time = time.perf_counter() - start
+start = time.perf_counter()
+expected = ",".join(fields)
+list_join_time = time.perf_counter() - start
+assert joined == expected
+start = time.perf_counter()
+row = b(container="csv")
+csv_time = time.perf_counter() - start
+assert row == render(fields)
+print(f"{len(fields)} fields: join {join_time * 1000:.1f} ms (str.join on a list {list_join_time * 1000:.1f} ms), "
+      f"CSV row {csv_time * 1000:.1f} ms")
+print("join() and CSV rendering tests passed.")
@@ -0,0 +1,71 @@
+import random
+import time
+from BeautifulString import BString
+
+
+class Tagged(str):
+    def strip(self, chars=None):
+        return "tagged"
+
+
+def expected(items, method, *args):
+    return [getattr(s, method)(*args) for s in items]
+
+
+# --- Native kernels agree with the str methods ---
+rng = random.Random(15)
+alphabet = "aZ09 \t\n  xX-+._éÉßİΣ\U0001F600"
+items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(12))) for _ in range(2000)]
+items += ["", "   ", "-42", "+7", "-", "0", "ALLCAPS", "lower", "Mixed Case 123", "  wide  "]
+calls = [
+    ("strip",), ("lstrip",), ("rstrip",), ("strip", None), ("strip", " a"), ("rstrip", "Z0"),
+    ("lstrip", "é\U0001F600 "), ("strip", ""), ("lower",), ("upper",), ("casefold",),
+    ("replace", "a", "AA"), ("replace", " ", ""), ("replace", "", "|"), ("replace", "x", "é", 1),
+    ("replace", "Z", "z", 0), ("replace", "9", "", -1), ("zfill", 8), ("zfill", 0), ("zfill", -3),
+    ("removeprefix", "a"), ("removeprefix", ""), ("removesuffix", "0"), ("removesuffix", "\U0001F600"),
+]
+for compact in (False, True):
+    b = BString.from_list(items)
+    if compact:
+        b.compact()
+    for call in calls:
+        mapped = b.map(*call)
+        assert list(mapped) == expected(items, *call), call
+        assert mapped.is_compact == compact and b.is_compact == compact
+print("map() kernels agree with the str methods (object and compact storage)")
+
+# --- Fallbacks: str subclasses, other methods and bad arguments ---
+b = BString("  x  ", Tagged("  y  "))
+assert list(b.map("strip")) == ["x", "tagged"]
+assert list(b.map("title")) == ["  X  ", "  Y  "]
+assert list(b.map("center", 7, "*")) == ["*  x  *", "*  y  *"]
+for bad in (("lower", 1), ("strip", 5), ("replace", "a"), ("replace", "a", "b", "c"), ("zfill", "5"),
+            ("zfill", 10 ** 30), ("removeprefix", None), ("nosuchmethod",)):
+    try:
+        b.map(*bad)
+        assert False, f"{bad!r} must raise"
+    except (TypeError, AttributeError, OverflowError):
+        pass
+print("map() fallbacks passed")
+
+# --- Benchmark ---
+lines = [f"  Record {i:07d} : Value {i * 7 % 1000}  " for i in range(1000000)]
+b = BString.from_list(lines)
+for call in (("strip",), ("lower",), ("upper",), ("replace", "Value", "V"), ("zfill", 40), ("removeprefix", "  Rec")):
+    start = time.perf_counter()
+    native = b.map(*call)
+    native_time = time.perf_counter() - start
+    method = getattr(str, call[0])
+    start = time.perf_counter()
+    python = [method(s, *call[1:]) for s in lines]
+    python_time = time.perf_counter() - start
+    assert native[0] == python[0] and native[-1] == python[-1]
+    compact = BString.from_list(lines)
+    compact.compact()
+    start = time.perf_counter()
+    compact_mapped = compact.map(*call)
+    compact_time = time.perf_counter() - start
+    assert compact_mapped[0] == python[0] and compact_mapped.is_compact
+    print(f"map{call}: {native_time * 1000:.1f} ms, compact {compact_time * 1000:.1f} ms, "
+          f"list comprehension {python_time * 1000:.1f} ms")
+print("map() kernel tests passed.")
@@ -0,0 +1,114 @@
+import csv
+import os
+import random
+import time
+from BeautifulString import BString
+
+PATH = "parallel_load_test.txt"
+csv.field_size_limit(1 << 30)
+
+
+def write(data):
+    with open(PATH, "wb") as f:
+        f.write(data.encode("utf-8") if isinstance(data, str) else data)
+
+
+def python_rows():
+    with open(PATH, "r", encoding="utf-8") as f:
+        return list(csv.reader(f))
+
+
+def python_lines():
+    with open(PATH, "r", encoding="utf-8") as f:
+        return [line.rstrip("\n") for line in f]
+
+
+def native_rows(threads):
+    return [list(row) for row in BString.from_csv(PATH, header=False, threads=threads)]
+
+
+def random_csv(rng, records, multiline):
+    pieces = ["a", "bc", "ÄÖ", "€", "\U0001F600", ",", '""', " "]
+    if multiline:
+        pieces += ["\n", "\r\n", "\r"]
+    lines = []
+    for _ in range(records):
+        fields = []
+        for _ in range(rng.randrange(1, 6)):
+            text = "".join(rng.choice(pieces) for _ in range(rng.randrange(8)))
+            fields.append('"' + text + '"' if rng.random() < 0.3 else text.replace(",", "").replace('""', "x"))
+        lines.append(",".join(fields))
+    return "".join(line + rng.choice(["\n", "\r\n", "\r"]) for line in lines)
+
+
+try:
+    # --- Threaded from_csv() agrees with the csv module, across ranges and blocks ---
+    rng = random.Random(23)
+    for records, multiline in ((50, True), (300000, False), (300000, True)):
+        write(random_csv(rng, records, multiline))
+        expected = python_rows()
+        for threads in (1, 2, 3, 8):
+            assert native_rows(threads) == expected, (records, multiline, threads)
+
+    # Line breaks inside quotes where the ranges are guessed to start.
+    big = '"' + "x\n" * 3000000 + '",end\n' + "a,b\n" * 100000 + '"tail\n'
+    write(big)
+    for threads in (1, 4):
+        assert native_rows(threads) == python_rows()
+    header, rows = BString.from_csv(PATH, threads=4)
+    assert header[1] == "end" and len(rows) == 100001
+    print("threaded from_csv() agrees with the csv module")
+
+    # --- from_file() reads \n, \r\n and \r lines, with and without threads ---
+    cases = ["", "\n", "a", "a\n", "a\r\nb\rc\n\n", "\r\r\n\n", "é€\n\U0001F600", "x" * 10000 + "\ny"]
+    for data in cases:
+        write(data)
+        for threads in (1, 4):
+            for compact in (False, True):
+                b = BString.from_file(PATH, compact=compact, threads=threads)
+                assert list(b) == python_lines(), (data, threads, compact)
+                assert b.is_compact == compact
+    lines = ["".join(rng.choice("ab é€\U0001F600") for _ in range(rng.randrange(40))) for _ in range(400000)]
+    write("".join(line + rng.choice(["\n", "\r\n", "\r"]) for line in lines))
+    expected = python_lines()
+    for threads in (1, 2, 8):
+        for compact in (False, True):
+            assert list(BString.from_file(PATH, compact=compact, threads=threads)) == expected
+    write(b"ok\n\xff\xfe\n")
+    for compact in (False, True):
+        try:
+            BString.from_file(PATH, compact=compact, threads=2)
+            assert False, "invalid UTF-8 must raise"
+        except UnicodeDecodeError:
+            pass
+    for call in (BString.from_file, BString.from_csv):
+        for bad in (0, 1025):
+            try:
+                call(PATH, threads=bad)
+                assert False, "threads out of range must raise"
+            except ValueError:
+                pass
+    print("threaded from_file() passed")
+
+    # --- Timing: one thread against four ---
+    row = "2024-05-01,alpha,1234,\"quoted, text\",beta\n"
+    write("a,b,c,d,e\n" + row * 1000000)
+    megabytes = os.path.getsize(PATH) / 1e6
+    for threads in (1, 4):
+        start = time.perf_counter()
+        header, rows = BString.from_csv(PATH, threads=threads)
+        elapsed = time.perf_counter() - start
+        assert len(rows) == 1000000
+        del header, rows
+        print(f"from_csv threads={threads}: {megabytes:.0f} MB in {elapsed * 1000:.0f} ms")
+    for threads in (1, 4):
+        start = time.perf_counter()
+        b = BString.from_file(PATH, compact=True, threads=threads)
+        elapsed = time.perf_counter() - start
+        assert len(b) == 1000001
+        del b
+        print(f"from_file(compact=True) threads={threads}: {megabytes:.0f} MB in {elapsed * 1000:.0f} ms")
+finally:
+    if os.path.exists(PATH):
+        os.remove(PATH)
+print("Parallel loading tests passed.")
@@ -0,0 +1,64 @@
+import random
+import sys
+from BeautifulString import BString
+
+# Concatenation and repetition share storage with their operands; every
+# BString must still behave as an independent copy afterwards.
+random.seed(99)
+
+
+def mutate(b, ref, step):
+    op = random.randrange(5)
+    if op == 0:
+        index = random.randint(0, len(ref))
+        b.insert(index, f"i{step}")
+        ref.insert(index, f"i{step}")
+    elif op == 1 and ref:
+        index = random.randrange(len(ref))
+        assert b.pop(index) == ref.pop(index)
+    elif op == 2 and ref:
+        index = random.randrange(len(ref))
+        b[index] = ref[index] = f"s{step}"
+    elif op == 3:
+        start = random.randint(0, len(ref))
+        stop = random.randint(start, min(len(ref), start + 100))
+        del b[start:stop]
+        del ref[start:stop]
+    else:
+        b.append(f"a{step}")
+        ref.append(f"a{step}")
+
+
+pool = []
+for round_ in range(40):
+    a_ref = [f"a{round_}-{i}" for i in range(random.randrange(300))]
+    b_ref = [f"b{round_}-{i}" for i in range(random.randrange(300))]
+    a, b = BString(*a_ref), BString(*b_ref)
+    pool += [(a, a_ref), (b, b_ref)]
+    pool.append((a + b, a_ref + b_ref))
+    n = random.randrange(5)
+    pool.append((a * n, a_ref * n))
+    pool.append(((a + b) * 2 + a, (a_ref + b_ref) * 2 + a_ref))
+
+    for step in range(200):
+        target, ref = random.choice(pool)
+        mutate(target, ref, step)
+
+    # Drop some BStrings so shared chunks outlive the BString that allocated them.
+    random.shuffle(pool)
+    del pool[: len(pool) // 3]
+    for target, ref in pool:
+        assert list(target) == ref
+
+# References held by shared chunks are released exactly once.
+marker = "".join(["refcount", "-marker"])
+before = sys.getrefcount(marker)
+x = BString(*([marker] * 200))
+y = x * 3 + x
+z = y[10:300]
+y[5] = "changed"
+del x[0:150]
+del x, y, z
+assert sys.getrefcount(marker) == before
+
+print("All shared chunk assertions passed.")
@@ -0,0 +1,50 @@
+import random
+import time
+from BeautifulString import BString
+
+# --- Random text of every str width against str.split() ---
+rng = random.Random(20)
+alphabets = ["ab;,  \t\n", "ab;é ,\xa0\x85", "aΣ;€,  ", "a\U0001F600;,é　"]
+delimiters = [";", ",", ";;", "ab", "é", "€;", "\U0001F600", "a\U0001F600", "Σ"]
+for _ in range(1500):
+    text = "".join(rng.choice(rng.choice(alphabets)) for _ in range(rng.randrange(40)))
+    for maxsplit in (-1, 0, 1, 2, 5):
+        assert list(BString.split(text, maxsplit=maxsplit)) == text.split(None, maxsplit), (text, maxsplit)
+        for delimiter in delimiters:
+            expected = text.split(delimiter, maxsplit)
+            assert list(BString.split(text, delimiter, maxsplit)) == expected, (text, delimiter, maxsplit)
+            assert list(BString.split(text, delimiter=delimiter, maxsplit=maxsplit, keep_empty=False)) == [
+                p for p in expected if p]
+print("split() agrees with str.split() (all str widths, whitespace and multi-character delimiters)")
+
+assert list(BString.split("a,,b,", ",")) == ["a", "", "b", ""]
+assert list(BString.split("a,,b,", ",", keep_empty=False)) == ["a", "b"]
+assert list(BString.split("  x  y  ")) == ["x", "y"] and list(BString.split("")) == []
+assert list(BString.split("", ",")) == [""] and list(BString.split("", ",", keep_empty=False)) == []
+whole = "no delimiter here"
+assert BString.split(whole, ";")[0] is whole
+for bad, error in (((",", ""), ValueError), ((",", 3), TypeError), ((3, ","), TypeError)):
+    try:
+        BString.split(*bad)
+        assert False, f"{bad!r} must be rejected"
+    except error:
+        pass
+print("split() options and argument checks passed")
+
+# --- Benchmark ---
+text = ";".join(f"field{i}" for i in range(2000000))
+start = time.perf_counter()
+b = BString.split(text, ";")
+native_time = time.perf_counter() - start
+start = time.perf_counter()
+pieces = text.split(";")
+str_time = time.perf_counter() - start
+assert len(b) == len(pieces) and b[12345] == pieces[12345]
+text = "::".join(f"field{i}" for i in range(2000000))
+start = time.perf_counter()
+b = BString.split(text, "::")
+multi_time = time.perf_counter() - start
+assert len(b) == 2000000
+print(f"{len(pieces)} fields: split {native_time * 1000:.1f} ms (str.split {str_time * 1000:.1f} ms), "
+      f"two-character delimiter {multi_time * 1000:.1f} ms")
+print("split() tests passed.")
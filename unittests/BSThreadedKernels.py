@@ -0,0 +1,98 @@
+import random
+import threading
+import time
+from BeautifulString import BString
+
+
+class Tagged(str):
+    def strip(self, chars=None):
+        return "tagged"
+
+    def isdigit(self):
+        return True
+
+
+# --- Threaded map() and filter() agree with the str methods ---
+rng = random.Random(16)
+alphabet = "aZ09 \t  xX-+._éÉİΣ\U0001F600"
+items = ["".join(rng.choice(alphabet) for _ in range(rng.randrange(12))) for _ in range(60000)]
+items += ["", "   ", "-42", "123", "abc", "ABC", "a1", "A1", "\x1c\x1f", "Tagged"]
+maps = [("strip",), ("rstrip", " a"), ("lower",), ("upper",), ("casefold",), ("replace", "a", "é"),
+        ("replace", "", "|"), ("zfill", 9), ("removeprefix", "a"), ("removesuffix", "\U0001F600")]
+filters = [("startswith", "a"), ("endswith", "\U0001F600"), ("isdigit",), ("isdecimal",), ("isnumeric",),
+           ("isalpha",), ("isalnum",), ("isspace",), ("islower",), ("isupper",), ("isascii",)]
+for compact in (False, True):
+    b = BString.from_list(items)
+    if compact:
+        b.compact()
+    for threads in (1, 2, 3, 8):
+        for call in maps:
+            mapped = b.map(*call, threads=threads)
+            assert list(mapped) == [getattr(s, call[0])(*call[1:]) for s in items], (call, threads)
+            assert mapped.is_compact == compact
+        for call in filters:
+            kept = b.filter(*call, threads=threads)
+            assert list(kept) == [s for s in items if getattr(s, call[0])(*call[1:])], (call, threads)
+            assert kept.is_compact == compact
+    assert b.is_compact == compact
+print("threaded map() and filter() agree with the str methods (object and compact storage)")
+
+# --- Subclasses, callables, unknown methods and bad arguments ---
+b = BString.from_list([" 1 ", Tagged(" x ")] * 20000)
+assert list(b.map("strip", threads=4)[:2]) == ["1", "tagged"]
+assert len(b.filter("isdigit", threads=4)) == 20000
+assert len(b.filter(lambda s: "1" in s, threads=4)) == 20000
+assert list(b.map("title", threads=4)[:2]) == [" 1 ", " X "]
+for bad in ({"threads": 0}, {"threads": "2"}, {"workers": 2}):
+    try:
+        b.map("strip", **bad)
+        assert False, f"{bad!r} must raise"
+    except (TypeError, ValueError):
+        pass
+print("threaded fallbacks passed")
+
+# --- Other threads may change the BString while the workers run ---
+for compact in (False, True):
+    b = BString.from_list([f" line {i} " for i in range(400000)])
+    if compact:
+        b.compact()
+    done = threading.Event()
+
+    def mutate():
+        while not done.is_set():
+            b.append(" extra ")
+            if not compact:
+                b[0] = " first "
+                del b[-1]
+
+    worker = threading.Thread(target=mutate)
+    worker.start()
+    for _ in range(5):
+        mapped = b.map("strip", threads=4)
+        assert mapped[1] == "line 1" and mapped[len(mapped) - 1] in ("extra", "line 399999")
+    done.set()
+    worker.join()
+print("concurrent changes during threaded map() passed")
+
+# --- Benchmark ---
+lines = [f"  Record {i:07d} : Value {i * 7 % 1000}  " for i in range(2000000)]
+for compact in (False, True):
+    b = BString.from_list(lines)
+    if compact:
+        b.compact()
+    for call in (("strip",), ("lower",), ("replace", "Value", "V")):
+        timings = []
+        for threads in (1, 4):
+            start = time.perf_counter()
+            b.map(*call, threads=threads)
+            timings.append(time.perf_counter() - start)
+        print(f"{'compact ' if compact else ''}map{call}: 1 thread {timings[0] * 1000:.1f} ms, "
+              f"4 threads {timings[1] * 1000:.1f} ms")
+    timings = []
+    for threads in (1, 4):
+        start = time.perf_counter()
+        b.filter("startswith", "  Record 00", threads=threads)
+        timings.append(time.perf_counter() - start)
+    print(f"{'compact ' if compact else ''}filter('startswith'): 1 thread {timings[0] * 1000:.1f} ms, "
+          f"4 threads {timings[1] * 1000:.1f} ms")
+print("threaded kernel tests passed.")
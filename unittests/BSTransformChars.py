@@ -0,0 +1,84 @@
+import random
+import time
+from BeautifulString import BString
+
+
+def reference(items, characters, mode):
+    chars = set(characters)
+    if mode == "remove":
+        return ["".join(c for c in s if c not in chars) for s in items]
+    return ["".join(c for c in s if c in chars) for s in items]
+
+
+# --- Random text of every str width, both modes, both storage modes ---
+rng = random.Random(18)
+alphabets = ["abcXYZ 019.,-\t", "abc é€ÿ\xa0", "abΣσ€ K", "ab\U0001F600\U00010348é "]
+items = []
+for alphabet in alphabets:
+    for _ in range(200):
+        items.append("".join(rng.choice(alphabet) for _ in range(rng.randrange(60))))
+char_sets = ["", "a", "aeiou ", " \t", "0123456789", "é€", "ÿ\xa0a", "Σ€\U0001F600", "\U00010348b",
+             "".join(chr(c) for c in range(32, 127)), "".join(alphabets)]
+for compact in (False, True):
+    for characters in char_sets:
+        for mode in ("remove", "keep"):
+            b = BString.from_list(items)
+            if compact:
+                b.compact()
+            expected = reference(items, characters, mode)
+            result = b.transform_chars(characters, mode=mode)
+            assert list(result) == expected, (characters, mode)
+            assert result.is_compact == compact
+            assert list(b) == items
+            # Results are canonical str objects: equal strings hash alike.
+            assert all(hash(r) == hash(e) for r, e in zip(result, expected))
+            b.transform_chars(characters, mode=mode, inplace=True)
+            assert list(b) == expected and b.is_compact == compact
+print("transform_chars() agrees with Python (all str widths, object and compact storage)")
+
+# --- Edits keep the hash index and the items that did not change ---
+b = BString("a-b", "ab", "c-d")
+b.enable_index()
+assert "ab" in b and b.index("c-d") == 2
+kept = b[1]
+b.transform_chars("-", inplace=True)
+assert list(b) == ["ab", "ab", "cd"] and b[1] is kept
+assert b.index("cd") == 2 and b.count("ab") == 2 and "c-d" not in b
+c = BString("a-b", "c-d")
+c.compact()
+c.enable_index()
+assert "a-b" in c
+c.transform_chars("-", inplace=True)
+assert list(c) == ["ab", "cd"] and "ab" in c and "a-b" not in c and c.is_compact
+
+class Sub(str):
+    pass
+
+s = BString(Sub("x-y"), Sub("xy")).transform_chars("-")
+assert list(s) == ["xy", "xy"] and all(type(x) is str for x in s)
+for bad_mode in ("drop", ""):
+    try:
+        BString("x").transform_chars("x", mode=bad_mode)
+        assert False, "bad modes must be rejected"
+    except ValueError:
+        pass
+print("transform_chars() inplace, index and argument checks passed")
+
+# --- Benchmark ---
+lines = [f"2024-05-01 12:{i % 60:02d}:{i % 7:02d} INFO user{i} fetched /api/v1/items/{i % 997}?page={i % 13}"
+         for i in range(300000)]
+table = str.maketrans("", "", ":-/?=")
+for compact in (False, True):
+    b = BString.from_list(lines)
+    if compact:
+        b.compact()
+    start = time.perf_counter()
+    result = b.transform_chars(":-/?=")
+    native_time = time.perf_counter() - start
+    start = time.perf_counter()
+    expected = [line.translate(table) for line in lines]
+    translate_time = time.perf_counter() - start
+    assert list(result) == expected
+    print(f"{'compact ' if compact else ''}{len(lines)} lines: transform_chars {native_time * 1000:.1f} ms, "
+          f"str.translate {translate_time * 1000:.1f} ms")
+print("transform_chars() tests passed.")
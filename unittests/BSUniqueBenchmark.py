@@ -0,0 +1,44 @@
+import time
+from BeautifulString import BString
+
+# --- Configuration ---
+NUM_LINES = 10_000_000
+DISTINCT = 50_000
+REPEATS = 3
+
+
+def best_of(label, func, setup=None):
+    """Runs func REPEATS times and prints the fastest time and the throughput."""
+    best = None
+    result = None
+    for _ in range(REPEATS):
+        arg = setup() if setup else None
+        start = time.perf_counter()
+        result = func(arg) if setup else func()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"  {label:<34} {best * 1000:9.1f} ms  {NUM_LINES / best / 1e6:7.1f} M lines/s")
+    return result
+
+
+def run_unique_benchmark():
+    """
+    Deduplicates a long log-like sequence where every line repeats many
+    times, which is the case unique() is meant for.
+    """
+    vocabulary = [f"2024-05-01 host-{i:05d} status=ok" for i in range(DISTINCT)]
+    lines = [vocabulary[(i * 7919) % DISTINCT] for i in range(NUM_LINES)]
+    b = BString.from_list(lines)
+    expected = list(dict.fromkeys(lines))
+
+    print(f"--- unique() on {NUM_LINES:,} lines, {DISTINCT:,} distinct (best of {REPEATS}) ---")
+    first = best_of("list(dict.fromkeys(list))", lambda: list(dict.fromkeys(lines)))
+    first = best_of("b.unique()", lambda: b.unique())
+    assert list(first) == expected
+    last = best_of("b.unique(keep='last')", lambda: b.unique(keep="last"))
+    assert len(last) == DISTINCT and last[-1] == lines[-1]
+    best_of("copy.unique(inplace=True)", lambda c: c.unique(inplace=True), setup=lambda: b[:])
+
+
+if __name__ == "__main__":
+    run_unique_benchmark()
@@ -0,0 +1,55 @@
+import os
+from BeautifulString import BString, BStringView
+
+b = BString(*[f"line {i}" for i in range(1000)])
+reference = list(b)
+
+# --- Views share storage and behave like read-only sequences ---
+v = b.view(100, 900)
+assert isinstance(v, BStringView)
+assert len(v) == 800
+assert v[0] == "line 100" and v[-1] == "line 899"
+assert list(v) == reference[100:900]
+assert list(b.view()) == reference
+assert list(b.view(-10)) == reference[-10:]
+assert list(b.view(900, 100, -7)) == reference[900:100:-7]
+print(f"View of 800 items: first={v[0]!r}, last={v[-1]!r}")
+
+# --- Slicing a view returns another view ---
+page = v[50:60]
+assert isinstance(page, BStringView)
+assert list(page) == reference[150:160]
+assert list(v[::-100]) == reference[100:900][::-100]
+
+# --- join, contains, to_file and materialize work on the window only ---
+assert page.join("|") == "|".join(reference[150:160])
+assert page.contains("line 155") is True
+assert page.contains("line 999") is False
+assert page.contains("LINE 155", case_sensitive=False) is True
+
+path = "bstring_view_test.txt"
+try:
+    page.to_file(path)
+    assert list(BString.from_file(path)) == reference[150:160]
+finally:
+    if os.path.exists(path):
+        os.remove(path)
+
+copy = page.materialize()
+assert isinstance(copy, BString)
+assert list(copy) == reference[150:160]
+
+# --- Appending to the parent keeps views valid ---
+b.append("extra")
+assert list(page) == reference[150:160]
+
+# --- Any other modification invalidates them ---
+b[155] = "changed"
+try:
+    page[0]
+    raise AssertionError("stale view was readable")
+except RuntimeError as e:
+    print(f"Correctly caught error: {e}")
+
+assert list(b.view(150, 160))[5] == "changed"
+print("\nAll view assertions passed.")